@@ -0,0 +1,121 @@
+//
+// AdmissionController.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "AdmissionController.h"
+#include <cmath>
+
+
+AdmissionController::AdmissionController(Poco::Timespan target, Poco::Timespan interval, int maxInFlight, int maxSiteInFlight):
+	_target(target),
+	_interval(interval),
+	_maxInFlight(maxInFlight),
+	_maxSiteInFlight(maxSiteInFlight)
+{
+}
+
+
+AdmissionController::~AdmissionController()
+{
+}
+
+
+bool AdmissionController::admit(const std::string& site, bool mayReject)
+{
+	if (_dropping && mayReject)
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		Poco::Timestamp now;
+		if (_dropping && now >= _dropNext)
+		{
+			++_dropCount;
+			_dropNext = now + controlLaw(_dropCount);
+			++_rejected;
+			return false;
+		}
+	}
+
+	if (++_inFlight > _maxInFlight && _maxInFlight > 0)
+	{
+		--_inFlight;
+		++_rejected;
+		return false;
+	}
+
+	if (_maxSiteInFlight > 0)
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		int& siteInFlight = _siteInFlight[site];
+		if (siteInFlight >= _maxSiteInFlight)
+		{
+			--_inFlight;
+			++_rejected;
+			return false;
+		}
+		++siteInFlight;
+	}
+	return true;
+}
+
+
+void AdmissionController::leave(const std::string& site)
+{
+	if (_maxSiteInFlight > 0)
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		auto it = _siteInFlight.find(site);
+		if (it != _siteInFlight.end() && --it->second == 0)
+		{
+			_siteInFlight.erase(it);
+		}
+	}
+	--_inFlight;
+}
+
+
+void AdmissionController::sample(Poco::Timespan latency)
+{
+	if (_target.totalMicroseconds() <= 0) return;
+
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	Poco::Timestamp now;
+
+	// A single upload in progress cannot have been delayed by
+	// a backlog, however long it took.
+	if (latency < _target || _inFlight <= 1)
+	{
+		_aboveTarget = false;
+		_dropping = false;
+		return;
+	}
+
+	if (!_aboveTarget)
+	{
+		_aboveTarget = true;
+		_firstAboveTime = now + _interval.totalMicroseconds();
+	}
+	else if (!_dropping && now >= _firstAboveTime)
+	{
+		// If the last dropping state ended only recently, the rejection
+		// rate that controlled the backlog then is likely still needed.
+		if (_dropCount > 2 && now - _dropNext < 16*_interval.totalMicroseconds())
+			_dropCount -= 2;
+		else
+			_dropCount = 0;
+		_dropNext = now;
+		_dropping = true;
+	}
+}
+
+
+Poco::Timestamp::TimeDiff AdmissionController::controlLaw(int count) const
+{
+	return static_cast<Poco::Timestamp::TimeDiff>(_interval.totalMicroseconds()/std::sqrt(static_cast<double>(count)));
+}
@@ -0,0 +1,114 @@
+//
+// AdmissionController.h
+//
+// Definition of the AdmissionController class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef AdmissionController_INCLUDED
+#define AdmissionController_INCLUDED
+
+
+#include "Poco/Timespan.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Mutex.h"
+#include <unordered_map>
+#include <atomic>
+#include <string>
+
+
+class AdmissionController
+	/// AdmissionController decides whether new uploads are accepted,
+	/// based on the measured latency of storing images, using the
+	/// CoDel (controlled delay) algorithm.
+	///
+	/// As long as storing an image takes less than the target
+	/// latency at least once per interval, every upload is admitted.
+	/// Once the latency has stayed above the target for a whole
+	/// interval, the storage backlog is considered persistent, and
+	/// uploads are rejected at an increasing rate (one at interval,
+	/// interval/sqrt(2), interval/sqrt(3), ...) until the latency
+	/// drops below the target again. Rejected uploads fail fast,
+	/// before the camera sends the image, instead of timing out
+	/// after sending it.
+	///
+	/// Additionally, no more than a fixed number of uploads are
+	/// admitted at the same time, both in total and per site, so
+	/// that a single large site cannot occupy all request handlers.
+{
+public:
+	AdmissionController(Poco::Timespan target, Poco::Timespan interval, int maxInFlight, int maxSiteInFlight);
+		/// Creates the AdmissionController. A zero target disables
+		/// latency-based rejection. If maxInFlight (or
+		/// maxSiteInFlight) is zero, the number of concurrent uploads
+		/// (from a single site) is not limited.
+
+	~AdmissionController();
+		/// Destroys the AdmissionController.
+
+	bool admit(const std::string& site, bool mayReject = true);
+		/// Returns true if a new upload from the given site is admitted.
+		/// Every admitted upload must be completed with leave().
+		///
+		/// If mayReject is false (e.g., for high-priority uploads),
+		/// the upload is only subject to the in-flight limits.
+
+	void leave(const std::string& site);
+		/// Completes an upload admitted with admit().
+
+	void sample(Poco::Timespan latency);
+		/// Records the time taken to store an image.
+
+	int inFlight() const;
+		/// Returns the number of admitted uploads in progress.
+
+	bool dropping() const;
+		/// Returns true if uploads are currently being rejected.
+
+	int rejected() const;
+		/// Returns the total number of rejected uploads.
+
+protected:
+	Poco::Timestamp::TimeDiff controlLaw(int count) const;
+
+private:
+	const Poco::Timespan _target;
+	const Poco::Timespan _interval;
+	const int _maxInFlight;
+	const int _maxSiteInFlight;
+	std::atomic<int> _inFlight{0};
+	std::atomic<int> _rejected{0};
+	Poco::Timestamp _firstAboveTime{0};
+	Poco::Timestamp _dropNext{0};
+	bool _aboveTarget = false;
+	std::atomic<bool> _dropping{false};
+	int _dropCount = 0;
+	std::unordered_map<std::string, int> _siteInFlight;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+//
+// inlines
+//
+inline int AdmissionController::inFlight() const
+{
+	return _inFlight;
+}
+
+
+inline bool AdmissionController::dropping() const
+{
+	return _dropping;
+}
+
+
+inline int AdmissionController::rejected() const
+{
+	return _rejected;
+}
+
+
+#endif // AdmissionController_INCLUDED
@@ -0,0 +1,84 @@
+//
+// AlignedBufferPool.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "AlignedBufferPool.h"
+#include "Poco/Exception.h"
+#include <cstdlib>
+
+
+AlignedBufferPool::AlignedBufferPool(std::size_t blockSize, std::size_t alignment, int maxPooled):
+	_blockSize((blockSize + alignment - 1) & ~(alignment - 1)),
+	_alignment(alignment),
+	_maxPooled(maxPooled > 0 ? maxPooled : 0)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+		throw Poco::InvalidArgumentException("Buffer alignment must be a power of two");
+	if (_blockSize == 0)
+		throw Poco::InvalidArgumentException("Buffer size must not be zero");
+
+	_blocks.reserve(_maxPooled);
+}
+
+
+AlignedBufferPool::~AlignedBufferPool()
+{
+	for (auto pBlock: _blocks)
+	{
+		std::free(pBlock);
+	}
+}
+
+
+char* AlignedBufferPool::get()
+{
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		if (!_blocks.empty())
+		{
+			char* pBlock = _blocks.back();
+			_blocks.pop_back();
+			return pBlock;
+		}
+		++_allocated;
+	}
+
+	void* pBlock = nullptr;
+	if (posix_memalign(&pBlock, _alignment, _blockSize) != 0)
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		--_allocated;
+		throw Poco::OutOfMemoryException("Cannot allocate aligned buffer");
+	}
+	return static_cast<char*>(pBlock);
+}
+
+
+void AlignedBufferPool::release(char* pBlock)
+{
+	if (!pBlock) return;
+
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		if (_blocks.size() < _maxPooled)
+		{
+			_blocks.push_back(pBlock);
+			return;
+		}
+		--_allocated;
+	}
+	std::free(pBlock);
+}
+
+
+int AlignedBufferPool::allocated() const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	return _allocated;
+}
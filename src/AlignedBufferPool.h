@@ -0,0 +1,116 @@
+//
+// AlignedBufferPool.h
+//
+// Definition of the AlignedBufferPool class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef AlignedBufferPool_INCLUDED
+#define AlignedBufferPool_INCLUDED
+
+
+#include "Poco/Mutex.h"
+#include <vector>
+#include <cstddef>
+
+
+class AlignedBufferPool
+	/// A thread-safe pool of fixed-size memory blocks, aligned
+	/// suitably for direct (O_DIRECT) I/O.
+	///
+	/// Released blocks are kept for reuse, up to the given
+	/// maximum number of pooled blocks. Additional blocks
+	/// are freed when released.
+{
+public:
+	class Buffer
+		/// Holds a block obtained from an AlignedBufferPool
+		/// and returns it to the pool upon destruction.
+	{
+	public:
+		explicit Buffer(AlignedBufferPool& pool):
+			_pool(pool),
+			_pBlock(pool.get())
+		{
+		}
+
+		~Buffer()
+		{
+			_pool.release(_pBlock);
+		}
+
+		char* begin()
+		{
+			return _pBlock;
+		}
+
+		std::size_t size() const
+		{
+			return _pool.blockSize();
+		}
+
+	private:
+		Buffer(const Buffer&) = delete;
+		Buffer& operator = (const Buffer&) = delete;
+
+		AlignedBufferPool& _pool;
+		char* _pBlock;
+	};
+
+	AlignedBufferPool(std::size_t blockSize, std::size_t alignment, int maxPooled);
+		/// Creates the AlignedBufferPool.
+		///
+		/// The blockSize is rounded up to a multiple of alignment,
+		/// which must be a power of two.
+
+	~AlignedBufferPool();
+		/// Destroys the AlignedBufferPool and frees all pooled blocks.
+
+	char* get();
+		/// Returns a block from the pool, or allocates a new one
+		/// if the pool is empty.
+
+	void release(char* pBlock);
+		/// Returns a block to the pool.
+
+	std::size_t blockSize() const;
+		/// Returns the size of a block.
+
+	std::size_t alignment() const;
+		/// Returns the alignment of blocks.
+
+	int allocated() const;
+		/// Returns the number of blocks currently allocated,
+		/// both pooled and in use.
+
+private:
+	AlignedBufferPool(const AlignedBufferPool&) = delete;
+	AlignedBufferPool& operator = (const AlignedBufferPool&) = delete;
+
+	std::size_t _blockSize;
+	std::size_t _alignment;
+	std::size_t _maxPooled;
+	int _allocated = 0;
+	std::vector<char*> _blocks;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+//
+// inlines
+//
+inline std::size_t AlignedBufferPool::blockSize() const
+{
+	return _blockSize;
+}
+
+
+inline std::size_t AlignedBufferPool::alignment() const
+{
+	return _alignment;
+}
+
+
+#endif // AlignedBufferPool_INCLUDED
@@ -0,0 +1,92 @@
+//
+// ArchiveCache.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ArchiveCache.h"
+#include "Poco/Exception.h"
+
+
+ArchiveCache::ArchiveCache(const std::string& root, std::size_t capacity):
+	_root(root),
+	_capacity(capacity)
+{
+}
+
+
+ArchiveCache::~ArchiveCache()
+{
+}
+
+
+HourArchive::Ptr ArchiveCache::find(const std::string& directory)
+{
+	Poco::UInt64 generation;
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		auto it = _archives.find(directory);
+		if (it != _archives.end())
+		{
+			_lru.splice(_lru.begin(), _lru, it->second);
+			return it->second->second;
+		}
+		generation = _generation;
+	}
+
+	HourArchive::Ptr pArchive;
+	try
+	{
+		pArchive = std::make_shared<HourArchive>(path(directory));
+	}
+	catch (Poco::FileNotFoundException&)
+	{
+		return nullptr;
+	}
+
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	// An archive opened before it was replaced must
+	// not be cached.
+	if (_capacity == 0 || _generation != generation) return pArchive;
+
+	auto it = _archives.find(directory);
+	if (it != _archives.end())
+	{
+		_lru.splice(_lru.begin(), _lru, it->second);
+		return it->second->second;
+	}
+
+	_lru.emplace_front(directory, pArchive);
+	_archives[directory] = _lru.begin();
+	if (_lru.size() > _capacity)
+	{
+		_archives.erase(_lru.back().first);
+		_lru.pop_back();
+	}
+	return pArchive;
+}
+
+
+void ArchiveCache::evict(const std::string& directory)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	_generation++;
+	auto it = _archives.find(directory);
+	if (it != _archives.end())
+	{
+		_lru.erase(it->second);
+		_archives.erase(it);
+	}
+}
+
+
+std::size_t ArchiveCache::size() const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	return _lru.size();
+}
@@ -0,0 +1,82 @@
+//
+// ArchiveCache.h
+//
+// Definition of the ArchiveCache class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ArchiveCache_INCLUDED
+#define ArchiveCache_INCLUDED
+
+
+#include "HourArchive.h"
+#include "Poco/Mutex.h"
+#include "Poco/Types.h"
+#include <list>
+#include <string>
+#include <unordered_map>
+
+
+class ArchiveCache
+	/// ArchiveCache keeps recently used hour archives below
+	/// a root directory open, together with their index.
+	///
+	/// Up to capacity archives are kept open; the least recently
+	/// used archive is closed first. Archives are shared, so an
+	/// archive evicted from the cache remains usable while images
+	/// are still being read from it.
+{
+public:
+	ArchiveCache(const std::string& root, std::size_t capacity);
+		/// Creates the ArchiveCache for the given root directory
+		/// (with a trailing path separator), keeping up to capacity
+		/// archives open.
+
+	~ArchiveCache();
+		/// Destroys the ArchiveCache.
+
+	HourArchive::Ptr find(const std::string& directory);
+		/// Returns the archive of the given hour directory, or a null
+		/// pointer if the directory has not been archived.
+		///
+		/// Throws a Poco::DataFormatException if the archive is
+		/// damaged.
+
+	void evict(const std::string& directory);
+		/// Removes the archive of the given hour directory from the
+		/// cache. Must be called after the archive has been replaced.
+
+	std::string path(const std::string& directory) const;
+		/// Returns the path of the archive of the given hour directory.
+
+	std::size_t size() const;
+		/// Returns the number of cached archives.
+
+protected:
+	using LRUList = std::list<std::pair<std::string, HourArchive::Ptr>>;
+
+private:
+	const std::string _root;
+	const std::size_t _capacity;
+	LRUList _lru;
+	std::unordered_map<std::string, LRUList::iterator> _archives;
+	Poco::UInt64 _generation = 0;
+	mutable Poco::FastMutex _mutex;
+
+	ArchiveCache(const ArchiveCache&) = delete;
+	ArchiveCache& operator = (const ArchiveCache&) = delete;
+};
+
+
+//
+// inlines
+//
+inline std::string ArchiveCache::path(const std::string& directory) const
+{
+	return _root + directory + HourArchive::SUFFIX;
+}
+
+
+#endif // ArchiveCache_INCLUDED
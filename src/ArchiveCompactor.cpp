@@ -0,0 +1,193 @@
+//
+// ArchiveCompactor.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ArchiveCompactor.h"
+#include "ArchiveWriter.h"
+#include "ImageKey.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/LocalDateTime.h"
+#include "Poco/Timestamp.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include <set>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+using namespace std::string_literals;
+
+
+ArchiveCompactor::ArchiveCompactor(FileImageStore& files, ArchiveCache& archives, Poco::Timespan delay, Poco::Timespan scanInterval):
+	_files(files),
+	_archives(archives),
+	_delay(delay),
+	_scanInterval(scanInterval),
+	_thread("ArchiveCompactor"s),
+	_stopped(Poco::Event::EVENT_MANUALRESET),
+	_logger(Poco::Logger::get("ArchiveCompactor"s))
+{
+}
+
+
+ArchiveCompactor::~ArchiveCompactor()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+void ArchiveCompactor::start()
+{
+	_stopped.reset();
+	_thread.start(*this);
+	_running = true;
+}
+
+
+void ArchiveCompactor::stop()
+{
+	if (!_running) return;
+
+	_stopped.set();
+	_thread.join();
+	_running = false;
+}
+
+
+void ArchiveCompactor::run()
+{
+	do
+	{
+		try
+		{
+			scan(std::string(), 0);
+		}
+		catch (Poco::Exception& exc)
+		{
+			_logger.log(exc);
+		}
+	}
+	while (!_stopped.tryWait(static_cast<long>(_scanInterval.totalMilliseconds())));
+}
+
+
+void ArchiveCompactor::scan(const std::string& directory, int depth)
+{
+	// site/camera/YYYY/MM/DD/HH
+	const int HOUR_DEPTH = 6;
+
+	if (depth == HOUR_DEPTH)
+	{
+		Poco::LocalDateTime hour;
+		if (ImageKey::parseDirectory(directory, hour)
+			&& hour.timestamp() + Poco::Timespan::HOURS + _delay.totalMicroseconds() <= Poco::Timestamp())
+		{
+			compact(directory);
+		}
+		return;
+	}
+
+	Poco::File dir(_files.root() + directory);
+	if (!dir.exists()) return;
+
+	// Collect the subdirectories first, so that no directory
+	// handle is held open while compacting.
+	std::vector<std::string> directories;
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(dir); it != end; ++it)
+	{
+		if (it->isDirectory())
+		{
+			directories.push_back(directory.empty() ? it.name() : directory + '/' + it.name());
+		}
+	}
+	for (const auto& subdirectory: directories)
+	{
+		if (_stopped.tryWait(0)) return;
+		scan(subdirectory, depth + 1);
+	}
+}
+
+
+void ArchiveCompactor::compact(const std::string& directory)
+{
+	try
+	{
+		const Poco::Timestamp settled = Poco::Timestamp() - _delay.totalMicroseconds();
+
+		std::vector<std::string> names;
+		_files.list(directory, names);
+		std::set<std::string> images;
+		for (const auto& name: names)
+		{
+			struct stat st;
+			if (ImageKey::isValid(directory + '/' + name)
+				&& ::stat(_files.path(directory + '/' + name).c_str(), &st) == 0
+				&& S_ISREG(st.st_mode)
+				&& Poco::Timestamp::fromEpochTime(st.st_mtime) <= settled)
+			{
+				images.insert(name);
+			}
+		}
+		if (images.empty())
+		{
+			if (names.empty()) ::rmdir((_files.root() + directory).c_str());
+			return;
+		}
+
+		// Images already archived are copied to the new archive,
+		// unless replaced by an image written later.
+		ArchiveWriter writer(_archives.path(directory));
+		HourArchive::Ptr pArchive = _archives.find(directory);
+		if (pArchive)
+		{
+			for (const auto& p: pArchive->entries())
+			{
+				if (images.count(p.first) == 0)
+				{
+					Poco::UInt64 size;
+					auto pStream = HourArchive::open(pArchive, p.first, size);
+					writer.add(p.first, *pStream);
+				}
+			}
+			pArchive.reset();
+		}
+		for (const auto& name: images)
+		{
+			if (_stopped.tryWait(0)) return;
+
+			Poco::UInt64 size;
+			auto pStream = _files.open(directory + '/' + name, size);
+			if (!pStream || writer.add(name, *pStream) != size)
+			{
+				throw Poco::IOException("Image modified while archiving"s, directory + '/' + name);
+			}
+		}
+		writer.commit();
+		_archives.evict(directory);
+
+		for (const auto& name: images)
+		{
+			_files.remove(directory + '/' + name);
+		}
+		::rmdir((_files.root() + directory).c_str());
+
+		_archivedDirectories++;
+		_archivedImages += images.size();
+		_logger.information("Archived %s (%z images, %z total)."s, directory, images.size(), writer.count());
+	}
+	catch (Poco::Exception& exc)
+	{
+		_logger.error("Failed to archive %s: %s"s, directory, exc.displayText());
+	}
+}
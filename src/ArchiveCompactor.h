@@ -0,0 +1,91 @@
+//
+// ArchiveCompactor.h
+//
+// Definition of the ArchiveCompactor class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ArchiveCompactor_INCLUDED
+#define ArchiveCompactor_INCLUDED
+
+
+#include "FileImageStore.h"
+#include "ArchiveCache.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/Timespan.h"
+#include "Poco/Logger.h"
+#include <atomic>
+
+
+class ArchiveCompactor: public Poco::Runnable
+	/// ArchiveCompactor packs the images of completed hour
+	/// directories of a FileImageStore into hour archives
+	/// (see HourArchive), and removes the original files.
+	///
+	/// A background thread scans the store every scanInterval.
+	/// An hour directory is archived delay after the end of the
+	/// hour. Images written to an archived hour later (e.g.,
+	/// by spool migration or replication) are merged into the
+	/// archive on a later scan. Only images not modified for
+	/// delay are archived, so that images still being written
+	/// are left alone.
+{
+public:
+	ArchiveCompactor(FileImageStore& files, ArchiveCache& archives, Poco::Timespan delay, Poco::Timespan scanInterval);
+		/// Creates the ArchiveCompactor.
+
+	~ArchiveCompactor();
+		/// Destroys the ArchiveCompactor, stopping it if necessary.
+
+	void start();
+		/// Starts the background thread.
+
+	void stop();
+		/// Stops the background thread. An archive being
+		/// written is discarded.
+
+	Poco::UInt64 archivedDirectories() const;
+		/// Returns the number of hour directories archived.
+
+	Poco::UInt64 archivedImages() const;
+		/// Returns the number of images archived.
+
+protected:
+	void run();
+	void scan(const std::string& directory, int depth);
+	void compact(const std::string& directory);
+
+private:
+	FileImageStore& _files;
+	ArchiveCache& _archives;
+	const Poco::Timespan _delay;
+	const Poco::Timespan _scanInterval;
+	std::atomic<Poco::UInt64> _archivedDirectories{0};
+	std::atomic<Poco::UInt64> _archivedImages{0};
+	Poco::Thread _thread;
+	Poco::Event _stopped;
+	bool _running = false;
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline Poco::UInt64 ArchiveCompactor::archivedDirectories() const
+{
+	return _archivedDirectories.load(std::memory_order_relaxed);
+}
+
+
+inline Poco::UInt64 ArchiveCompactor::archivedImages() const
+{
+	return _archivedImages.load(std::memory_order_relaxed);
+}
+
+
+#endif // ArchiveCompactor_INCLUDED
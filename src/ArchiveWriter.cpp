@@ -0,0 +1,129 @@
+//
+// ArchiveWriter.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ArchiveWriter.h"
+#include "Poco/Checksum.h"
+#include "Poco/Path.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+using namespace std::string_literals;
+
+
+ArchiveWriter::ArchiveWriter(const std::string& path):
+	_path(path),
+	_tempPath(path + ".tmp"s),
+	_fd(::open(_tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+{
+	if (_fd < 0)
+	{
+		throw Poco::CreateFileException(_tempPath, Poco::Error::getMessage(errno));
+	}
+}
+
+
+ArchiveWriter::~ArchiveWriter()
+{
+	if (_fd >= 0) ::close(_fd);
+	if (!_committed) ::unlink(_tempPath.c_str());
+}
+
+
+Poco::UInt64 ArchiveWriter::add(const std::string& name, std::istream& istr)
+{
+	HourArchive::Entry entry;
+	entry.offset = _offset;
+
+	char buffer[65536];
+	while (istr)
+	{
+		istr.read(buffer, sizeof(buffer));
+		const std::size_t n = static_cast<std::size_t>(istr.gcount());
+		if (n == 0) break;
+		writeAll(buffer, n);
+		entry.size += n;
+	}
+	if (istr.bad()) throw Poco::ReadFileException("Error reading image data"s, name);
+
+	_index.emplace_back(name, entry);
+	return entry.size;
+}
+
+
+void ArchiveWriter::commit()
+{
+	std::string index;
+	for (const auto& p: _index)
+	{
+		HourArchive::IndexEntry record;
+		record.offset = p.second.offset;
+		record.size = p.second.size;
+		record.nameLength = static_cast<Poco::UInt32>(p.first.size());
+		record.reserved = 0;
+		index.append(reinterpret_cast<const char*>(&record), sizeof(record));
+		index.append(p.first);
+	}
+
+	Poco::Checksum checksum(Poco::Checksum::TYPE_CRC32);
+	checksum.update(index);
+
+	HourArchive::Trailer trailer;
+	trailer.magic = HourArchive::MAGIC;
+	trailer.checksum = checksum.checksum();
+	trailer.count = static_cast<Poco::UInt32>(_index.size());
+	trailer.reserved = 0;
+	trailer.indexOffset = _offset;
+	trailer.indexLength = index.size();
+
+	writeAll(index.data(), index.size());
+	writeAll(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+
+	if (::fsync(_fd) != 0)
+	{
+		throw Poco::WriteFileException(_tempPath, Poco::Error::getMessage(errno));
+	}
+	::close(_fd);
+	_fd = -1;
+
+	if (::rename(_tempPath.c_str(), _path.c_str()) != 0)
+	{
+		throw Poco::FileException("Cannot rename "s + _tempPath, Poco::Error::getMessage(errno));
+	}
+	_committed = true;
+
+	// Make the rename durable before the caller removes
+	// the archived images.
+	const std::string parent = Poco::Path(_path).parent().toString();
+	int dirfd = ::open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirfd >= 0)
+	{
+		::fsync(dirfd);
+		::close(dirfd);
+	}
+}
+
+
+void ArchiveWriter::writeAll(const char* buffer, std::size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t n = ::write(_fd, buffer, length);
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			throw Poco::WriteFileException(_tempPath, Poco::Error::getMessage(errno));
+		}
+		buffer += n;
+		length -= static_cast<std::size_t>(n);
+		_offset += static_cast<Poco::UInt64>(n);
+	}
+}
@@ -0,0 +1,74 @@
+//
+// ArchiveWriter.h
+//
+// Definition of the ArchiveWriter class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ArchiveWriter_INCLUDED
+#define ArchiveWriter_INCLUDED
+
+
+#include "HourArchive.h"
+#include <istream>
+#include <string>
+#include <vector>
+
+
+class ArchiveWriter
+	/// ArchiveWriter creates an archive file that can be read
+	/// with HourArchive.
+	///
+	/// Images are appended to a temporary file next to the archive.
+	/// commit() appends the index, syncs the file to stable storage
+	/// and renames it to the archive path, atomically replacing any
+	/// previous archive. If the ArchiveWriter is destroyed without
+	/// commit(), the temporary file is removed.
+{
+public:
+	explicit ArchiveWriter(const std::string& path);
+		/// Creates the ArchiveWriter for an archive at the given path.
+		/// Throws a Poco::CreateFileException if the temporary file
+		/// cannot be created.
+
+	~ArchiveWriter();
+		/// Destroys the ArchiveWriter.
+
+	Poco::UInt64 add(const std::string& name, std::istream& istr);
+		/// Appends all data read from istr to the archive, as the
+		/// image with the given name. Returns the size of the image.
+
+	std::size_t count() const;
+		/// Returns the number of images added.
+
+	void commit();
+		/// Writes the index and replaces the archive.
+
+protected:
+	void writeAll(const char* buffer, std::size_t length);
+
+private:
+	std::string _path;
+	std::string _tempPath;
+	int _fd;
+	Poco::UInt64 _offset = 0;
+	std::vector<std::pair<std::string, HourArchive::Entry>> _index;
+	bool _committed = false;
+
+	ArchiveWriter(const ArchiveWriter&) = delete;
+	ArchiveWriter& operator = (const ArchiveWriter&) = delete;
+};
+
+
+//
+// inlines
+//
+inline std::size_t ArchiveWriter::count() const
+{
+	return _index.size();
+}
+
+
+#endif // ArchiveWriter_INCLUDED
@@ -0,0 +1,87 @@
+//
+// ArchivingImageStore.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ArchivingImageStore.h"
+#include "ImageKey.h"
+
+
+ArchivingImageStore::ArchivingImageStore(FileImageStore::Ptr pFiles, Poco::Timespan delay, Poco::Timespan scanInterval, std::size_t cachedArchives):
+	_pFiles(pFiles),
+	_archives(_pFiles->root(), cachedArchives),
+	_compactor(*_pFiles, _archives, delay, scanInterval)
+{
+}
+
+
+ArchivingImageStore::~ArchivingImageStore()
+{
+}
+
+
+std::string ArchivingImageStore::store(const std::string& key, std::istream& istr)
+{
+	return _pFiles->store(key, istr);
+}
+
+
+std::unique_ptr<std::istream> ArchivingImageStore::open(const std::string& key, Poco::UInt64& size)
+{
+	// An image is removed only after the archive containing
+	// it has been written, so it is always found in one place.
+	auto pStream = _pFiles->open(key, size);
+	if (pStream) return pStream;
+
+	HourArchive::Ptr pArchive = _archives.find(ImageKey::directory(key));
+	if (pArchive) return HourArchive::open(pArchive, ImageKey::fileName(key), size);
+	return nullptr;
+}
+
+
+bool ArchivingImageStore::exists(const std::string& key)
+{
+	if (_pFiles->exists(key)) return true;
+
+	HourArchive::Ptr pArchive = _archives.find(ImageKey::directory(key));
+	HourArchive::Entry entry;
+	return pArchive && pArchive->find(ImageKey::fileName(key), entry);
+}
+
+
+void ArchivingImageStore::list(const std::string& directory, std::vector<std::string>& names)
+{
+	_pFiles->list(directory, names);
+	HourArchive::Ptr pArchive = _archives.find(directory);
+	if (pArchive)
+	{
+		for (const auto& p: pArchive->entries())
+		{
+			names.push_back(p.first);
+		}
+	}
+}
+
+
+void ArchivingImageStore::sync()
+{
+	// Archives are synced by the compactor before
+	// the files they contain are removed.
+	_pFiles->sync();
+}
+
+
+void ArchivingImageStore::start()
+{
+	_pFiles->start();
+	_compactor.start();
+}
+
+
+void ArchivingImageStore::stop()
+{
+	_compactor.stop();
+	_pFiles->stop();
+}
@@ -0,0 +1,71 @@
+//
+// ArchivingImageStore.h
+//
+// Definition of the ArchivingImageStore class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ArchivingImageStore_INCLUDED
+#define ArchivingImageStore_INCLUDED
+
+
+#include "ImageStore.h"
+#include "FileImageStore.h"
+#include "ArchiveCache.h"
+#include "ArchiveCompactor.h"
+
+
+class ArchivingImageStore: public ImageStore
+	/// An ImageStore keeping older images in hour archives.
+	///
+	/// Images are stored as individual files in a FileImageStore.
+	/// Completed hour directories are packed into a single archive
+	/// file per hour by an ArchiveCompactor, so that they can be
+	/// listed and backed up quickly.
+	///
+	/// Lookups try the individual files first, then the archive of
+	/// the image's hour directory. Archived images are read directly
+	/// from the archive, without extracting them.
+{
+public:
+	using Ptr = Poco::SharedPtr<ArchivingImageStore>;
+
+	ArchivingImageStore(FileImageStore::Ptr pFiles, Poco::Timespan delay, Poco::Timespan scanInterval, std::size_t cachedArchives);
+		/// Creates the ArchivingImageStore, archiving hour
+		/// directories delay after the end of the hour, and
+		/// keeping up to cachedArchives archives open.
+
+	~ArchivingImageStore();
+		/// Destroys the ArchivingImageStore.
+
+	const ArchiveCompactor& compactor() const;
+		/// Returns the ArchiveCompactor.
+
+	// ImageStore
+	std::string store(const std::string& key, std::istream& istr) override;
+	std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size) override;
+	bool exists(const std::string& key) override;
+	void list(const std::string& directory, std::vector<std::string>& names) override;
+	void sync() override;
+	void start() override;
+	void stop() override;
+
+private:
+	FileImageStore::Ptr _pFiles;
+	ArchiveCache _archives;
+	ArchiveCompactor _compactor;
+};
+
+
+//
+// inlines
+//
+inline const ArchiveCompactor& ArchivingImageStore::compactor() const
+{
+	return _compactor;
+}
+
+
+#endif // ArchivingImageStore_INCLUDED
@@ -0,0 +1,133 @@
+//
+// AtomicTable.h
+//
+// Definition of the AtomicTable class template.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef AtomicTable_INCLUDED
+#define AtomicTable_INCLUDED
+
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+
+template <class T>
+class AtomicTable
+	/// AtomicTable maps strings (e.g., site names) to objects of type T,
+	/// which are created on first use and kept until the table
+	/// is destroyed.
+	///
+	/// Lookups and insertions are lock-free: the table is an array
+	/// of atomic pointers with open addressing (linear probing), and
+	/// new entries are installed with compare-and-swap. The number of
+	/// slots is fixed; once the table is three quarters full, no more
+	/// entries are created.
+	///
+	/// T is default-constructed and must itself be safe for concurrent
+	/// use (e.g., consist of atomic counters).
+{
+public:
+	explicit AtomicTable(std::size_t capacity):
+		_mask(slotCount(capacity) - 1),
+		_slots(new std::atomic<Entry*>[_mask + 1])
+	{
+		for (std::size_t i = 0; i <= _mask; i++) _slots[i].store(nullptr, std::memory_order_relaxed);
+	}
+
+	~AtomicTable()
+	{
+		for (std::size_t i = 0; i <= _mask; i++) delete _slots[i].load(std::memory_order_relaxed);
+	}
+
+	T* find(const std::string& key) const
+		/// Returns the object for the given key, or nullptr
+		/// if there is none.
+	{
+		std::size_t i = std::hash<std::string>()(key) & _mask;
+		for (std::size_t n = 0; n <= _mask; n++, i = (i + 1) & _mask)
+		{
+			Entry* pEntry = _slots[i].load(std::memory_order_acquire);
+			if (!pEntry) return nullptr;
+			if (pEntry->key == key) return &pEntry->value;
+		}
+		return nullptr;
+	}
+
+	T* get(const std::string& key)
+		/// Returns the object for the given key, creating it if
+		/// necessary. Returns nullptr if the table is full.
+	{
+		std::size_t i = std::hash<std::string>()(key) & _mask;
+		std::unique_ptr<Entry> pNew;
+		for (std::size_t n = 0; n <= _mask; n++, i = (i + 1) & _mask)
+		{
+			Entry* pEntry = _slots[i].load(std::memory_order_acquire);
+			if (!pEntry)
+			{
+				if (_size.load(std::memory_order_relaxed) >= (_mask + 1)/4*3) return nullptr;
+				if (!pNew) pNew = std::make_unique<Entry>(key);
+				if (_slots[i].compare_exchange_strong(pEntry, pNew.get(), std::memory_order_acq_rel))
+				{
+					_size++;
+					return &pNew.release()->value;
+				}
+				// another thread has taken the slot; pEntry is its entry
+			}
+			if (pEntry->key == key) return &pEntry->value;
+		}
+		return nullptr;
+	}
+
+	template <class F>
+	void forEach(F&& f) const
+		/// Calls f(key, value) for every entry.
+	{
+		for (std::size_t i = 0; i <= _mask; i++)
+		{
+			Entry* pEntry = _slots[i].load(std::memory_order_acquire);
+			if (pEntry) f(pEntry->key, pEntry->value);
+		}
+	}
+
+	std::size_t size() const
+		/// Returns the number of entries.
+	{
+		return _size;
+	}
+
+private:
+	struct Entry
+	{
+		explicit Entry(const std::string& k):
+			key(k)
+		{
+		}
+
+		const std::string key;
+		T value;
+	};
+
+	static std::size_t slotCount(std::size_t capacity)
+	{
+		// power of two, with room for capacity entries at 3/4 load
+		std::size_t n = 16;
+		while (n/4*3 < capacity) n *= 2;
+		return n;
+	}
+
+	AtomicTable(const AtomicTable&) = delete;
+	AtomicTable& operator = (const AtomicTable&) = delete;
+
+	const std::size_t _mask;
+	std::unique_ptr<std::atomic<Entry*>[]> _slots;
+	std::atomic<std::size_t> _size{0};
+};
+
+
+#endif // AtomicTable_INCLUDED
@@ -0,0 +1,281 @@
+//
+// AviWriter.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "AviWriter.h"
+#include "JpegScanner.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <unistd.h>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	constexpr Poco::UInt32 fourcc(const char (&s)[5])
+	{
+		return static_cast<Poco::UInt32>(static_cast<unsigned char>(s[0]))
+			| static_cast<Poco::UInt32>(static_cast<unsigned char>(s[1])) << 8
+			| static_cast<Poco::UInt32>(static_cast<unsigned char>(s[2])) << 16
+			| static_cast<Poco::UInt32>(static_cast<unsigned char>(s[3])) << 24;
+	}
+
+	const Poco::UInt64 MAX_FILE_SIZE = 0xFFFFFFFF;
+	const Poco::UInt32 AVIF_HASINDEX = 0x00000010;
+	const Poco::UInt32 AVIIF_KEYFRAME = 0x00000010;
+
+	struct ChunkHeader
+	{
+		Poco::UInt32 id;
+		Poco::UInt32 size;
+	};
+
+	struct ListHeader
+	{
+		Poco::UInt32 id;
+		Poco::UInt32 size;
+		Poco::UInt32 type;
+	};
+
+	struct MainHeader
+	{
+		Poco::UInt32 microSecPerFrame;
+		Poco::UInt32 maxBytesPerSec;
+		Poco::UInt32 paddingGranularity;
+		Poco::UInt32 flags;
+		Poco::UInt32 totalFrames;
+		Poco::UInt32 initialFrames;
+		Poco::UInt32 streams;
+		Poco::UInt32 suggestedBufferSize;
+		Poco::UInt32 width;
+		Poco::UInt32 height;
+		Poco::UInt32 reserved[4];
+	};
+
+	struct StreamHeader
+	{
+		Poco::UInt32 type;
+		Poco::UInt32 handler;
+		Poco::UInt32 flags;
+		Poco::UInt16 priority;
+		Poco::UInt16 language;
+		Poco::UInt32 initialFrames;
+		Poco::UInt32 scale;
+		Poco::UInt32 rate;
+		Poco::UInt32 start;
+		Poco::UInt32 length;
+		Poco::UInt32 suggestedBufferSize;
+		Poco::UInt32 quality;
+		Poco::UInt32 sampleSize;
+		Poco::Int16 frame[4];
+	};
+
+	struct BitmapInfoHeader
+	{
+		Poco::UInt32 size;
+		Poco::Int32 width;
+		Poco::Int32 height;
+		Poco::UInt16 planes;
+		Poco::UInt16 bitCount;
+		Poco::UInt32 compression;
+		Poco::UInt32 sizeImage;
+		Poco::Int32 xPelsPerMeter;
+		Poco::Int32 yPelsPerMeter;
+		Poco::UInt32 colorsUsed;
+		Poco::UInt32 colorsImportant;
+	};
+
+	struct Headers
+		/// Everything up to the first frame.
+	{
+		ListHeader riff;
+		ListHeader hdrl;
+		ChunkHeader avihChunk;
+		MainHeader avih;
+		ListHeader strl;
+		ChunkHeader strhChunk;
+		StreamHeader strh;
+		ChunkHeader strfChunk;
+		BitmapInfoHeader strf;
+		ListHeader movi;
+	};
+
+	static_assert(sizeof(Headers) == 224, "unexpected padding in AVI headers");
+
+	struct IndexEntry
+	{
+		Poco::UInt32 id;
+		Poco::UInt32 flags;
+		Poco::UInt32 offset;
+		Poco::UInt32 size;
+	};
+
+	// Offset of the movi list type, to which index offsets are relative.
+	const Poco::UInt64 MOVI_OFFSET = sizeof(Headers) - 4;
+}
+
+
+AviWriter::AviWriter(const std::string& path, int framesPerSecond):
+	_path(path),
+	_indexPath(path + ".idx"s),
+	_framesPerSecond(framesPerSecond > 0 ? framesPerSecond : 1),
+	_ostr(path),
+	_pIndex(std::make_unique<Poco::FileOutputStream>(_indexPath))
+{
+}
+
+
+AviWriter::~AviWriter()
+{
+	if (!_closed)
+	{
+		try
+		{
+			_pIndex.reset();
+			_ostr.close();
+		}
+		catch (...)
+		{
+		}
+		::unlink(_path.c_str());
+	}
+	::unlink(_indexPath.c_str());
+}
+
+
+bool AviWriter::addFrame(const char* data, std::size_t size)
+{
+	if (_frames == 0)
+	{
+		if (!JpegScanner::frameSize(data, size, _width, _height))
+		{
+			throw Poco::DataFormatException("No JPEG frame header in first frame"s, _path);
+		}
+		writeHeaders();
+	}
+
+	// Chunks are padded to an even size.
+	const Poco::UInt64 padded = size + (size & 1);
+	if (MOVI_OFFSET + _moviSize + sizeof(ChunkHeader) + padded + sizeof(ChunkHeader) + sizeof(IndexEntry)*(_frames + 1) > MAX_FILE_SIZE)
+	{
+		return false;
+	}
+
+	ChunkHeader chunk;
+	chunk.id = fourcc("00dc");
+	chunk.size = static_cast<Poco::UInt32>(size);
+	_ostr.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+	_ostr.write(data, static_cast<std::streamsize>(size));
+	if (size & 1) _ostr.put('\0');
+
+	IndexEntry entry;
+	entry.id = chunk.id;
+	entry.flags = AVIIF_KEYFRAME;
+	entry.offset = static_cast<Poco::UInt32>(_moviSize);
+	entry.size = chunk.size;
+	_pIndex->write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+
+	if (!_ostr.good() || !_pIndex->good())
+	{
+		throw Poco::WriteFileException(_path);
+	}
+
+	_moviSize += sizeof(chunk) + padded;
+	_maxFrameSize = std::max(_maxFrameSize, chunk.size);
+	_frames++;
+	return true;
+}
+
+
+void AviWriter::close()
+{
+	if (_frames == 0) writeHeaders();
+
+	_pIndex->close();
+	_pIndex.reset();
+
+	ChunkHeader idx1;
+	idx1.id = fourcc("idx1");
+	idx1.size = static_cast<Poco::UInt32>(sizeof(IndexEntry)*_frames);
+	_ostr.write(reinterpret_cast<const char*>(&idx1), sizeof(idx1));
+	{
+		Poco::FileInputStream istr(_indexPath);
+		Poco::StreamCopier::copyStream(istr, _ostr);
+	}
+	_fileSize = MOVI_OFFSET + _moviSize + sizeof(idx1) + idx1.size;
+
+	_ostr.seekp(0);
+	writeHeaders();
+	_ostr.close();
+	if (!_ostr.good())
+	{
+		throw Poco::WriteFileException(_path);
+	}
+	_closed = true;
+}
+
+
+void AviWriter::writeHeaders()
+{
+	Headers headers;
+	std::memset(&headers, 0, sizeof(headers));
+
+	headers.riff.id = fourcc("RIFF");
+	headers.riff.size = static_cast<Poco::UInt32>(_fileSize > 8 ? _fileSize - 8 : 0);
+	headers.riff.type = fourcc("AVI ");
+
+	headers.hdrl.id = fourcc("LIST");
+	headers.hdrl.size = static_cast<Poco::UInt32>(offsetof(Headers, movi) - offsetof(Headers, hdrl.type));
+	headers.hdrl.type = fourcc("hdrl");
+
+	headers.avihChunk.id = fourcc("avih");
+	headers.avihChunk.size = sizeof(MainHeader);
+	headers.avih.microSecPerFrame = static_cast<Poco::UInt32>(1000000/_framesPerSecond);
+	headers.avih.maxBytesPerSec = _maxFrameSize*static_cast<Poco::UInt32>(_framesPerSecond);
+	headers.avih.flags = AVIF_HASINDEX;
+	headers.avih.totalFrames = _frames;
+	headers.avih.streams = 1;
+	headers.avih.suggestedBufferSize = _maxFrameSize + sizeof(ChunkHeader);
+	headers.avih.width = static_cast<Poco::UInt32>(_width);
+	headers.avih.height = static_cast<Poco::UInt32>(_height);
+
+	headers.strl.id = fourcc("LIST");
+	headers.strl.size = static_cast<Poco::UInt32>(offsetof(Headers, movi) - offsetof(Headers, strl.type));
+	headers.strl.type = fourcc("strl");
+
+	headers.strhChunk.id = fourcc("strh");
+	headers.strhChunk.size = sizeof(StreamHeader);
+	headers.strh.type = fourcc("vids");
+	headers.strh.handler = fourcc("MJPG");
+	headers.strh.scale = 1;
+	headers.strh.rate = static_cast<Poco::UInt32>(_framesPerSecond);
+	headers.strh.length = _frames;
+	headers.strh.suggestedBufferSize = headers.avih.suggestedBufferSize;
+	headers.strh.quality = 0xFFFFFFFF;
+	headers.strh.frame[2] = static_cast<Poco::Int16>(_width);
+	headers.strh.frame[3] = static_cast<Poco::Int16>(_height);
+
+	headers.strfChunk.id = fourcc("strf");
+	headers.strfChunk.size = sizeof(BitmapInfoHeader);
+	headers.strf.size = sizeof(BitmapInfoHeader);
+	headers.strf.width = _width;
+	headers.strf.height = _height;
+	headers.strf.planes = 1;
+	headers.strf.bitCount = 24;
+	headers.strf.compression = fourcc("MJPG");
+	headers.strf.sizeImage = static_cast<Poco::UInt32>(_width*_height*3);
+
+	headers.movi.id = fourcc("LIST");
+	headers.movi.size = static_cast<Poco::UInt32>(_moviSize);
+	headers.movi.type = fourcc("movi");
+
+	_ostr.write(reinterpret_cast<const char*>(&headers), sizeof(headers));
+}
@@ -0,0 +1,85 @@
+//
+// AviWriter.h
+//
+// Definition of the AviWriter class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef AviWriter_INCLUDED
+#define AviWriter_INCLUDED
+
+
+#include "Poco/FileStream.h"
+#include "Poco/Types.h"
+#include <memory>
+#include <string>
+
+
+class AviWriter
+	/// AviWriter writes a Motion JPEG video in an AVI file, using
+	/// JPEG images as frames without decoding or re-encoding them.
+	///
+	/// Frames are written to the file as they are added. The index
+	/// of the frames (16 bytes per frame) is collected in a temporary
+	/// file and appended by close(), which then completes the headers.
+	/// Memory use therefore does not depend on the number of frames.
+	///
+	/// The video has the size of the first frame. AVI files are
+	/// limited to 4 GB; frames that would exceed this are refused.
+{
+public:
+	AviWriter(const std::string& path, int framesPerSecond);
+		/// Creates the AviWriter, writing a video with the given
+		/// frame rate to a new file at path.
+
+	~AviWriter();
+		/// Destroys the AviWriter. If close() has not been called,
+		/// the incomplete video is removed.
+
+	bool addFrame(const char* data, std::size_t size);
+		/// Appends a JPEG image as the next frame. Returns false if
+		/// the frame would exceed the size limit of AVI files.
+		///
+		/// Throws a Poco::DataFormatException if the first frame has
+		/// no valid JPEG frame header.
+
+	Poco::UInt32 frames() const;
+		/// Returns the number of frames added.
+
+	void close();
+		/// Appends the index and completes the headers.
+
+protected:
+	void writeHeaders();
+
+private:
+	std::string _path;
+	std::string _indexPath;
+	int _framesPerSecond;
+	Poco::FileOutputStream _ostr;
+	std::unique_ptr<Poco::FileOutputStream> _pIndex;
+	int _width = 0;
+	int _height = 0;
+	Poco::UInt32 _frames = 0;
+	Poco::UInt32 _maxFrameSize = 0;
+	Poco::UInt64 _moviSize = 4;
+	Poco::UInt64 _fileSize = 0;
+	bool _closed = false;
+
+	AviWriter(const AviWriter&) = delete;
+	AviWriter& operator = (const AviWriter&) = delete;
+};
+
+
+//
+// inlines
+//
+inline Poco::UInt32 AviWriter::frames() const
+{
+	return _frames;
+}
+
+
+#endif // AviWriter_INCLUDED
@@ -8,215 +8,399 @@
 
 
 #include "Poco/Net/HTTPServer.h"
-#include "Poco/Net/HTTPRequestHandler.h"
-#include "Poco/Net/HTTPRequestHandlerFactory.h"
 #include "Poco/Net/HTTPServerParams.h"
-#include "Poco/Net/HTTPServerRequest.h"
-#include "Poco/Net/HTTPServerResponse.h"
-#include "Poco/Net/HTTPServerParams.h"
-#include "Poco/Net/HTMLForm.h"
 #include "Poco/Net/ServerSocket.h"
 #include "Poco/Util/ServerApplication.h"
 #include "Poco/Util/Option.h"
 #include "Poco/Util/OptionSet.h"
 #include "Poco/Util/HelpFormatter.h"
-#include "Poco/NumberFormatter.h"
-#include "Poco/StreamCopier.h"
-#include "Poco/NullStream.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Thread.h"
 #include "Poco/Exception.h"
-#include "Poco/LocalDateTime.h"
-#include "Poco/DateTimeFormatter.h"
-#include "Poco/FileStream.h"
 #include "Poco/Path.h"
 #include "Poco/File.h"
 #include "Poco/URI.h"
-#include <sstream>
+#include "AlignedBufferPool.h"
+#include "ImageStore.h"
+#include "FileImageStore.h"
+#include "SpoolingImageStore.h"
+#include "ArchivingImageStore.h"
+#include "S3ImageStore.h"
+#include "ReplicatingImageStore.h"
+#include "JournalingImageStore.h"
+#include "ChecksummingImageStore.h"
+#include "ShardRing.h"
+#include "AdmissionController.h"
+#include "StorageScheduler.h"
+#include "ImageUploadRequestHandlerFactory.h"
+#include "SocketHandoff.h"
+#include "StorageBenchmark.h"
+#include "StorageStrategyBenchmark.h"
+#include "HandlerBenchmark.h"
+#include "SoakTest.h"
+#include "TrafficCapture.h"
+#include "ServerStatistics.h"
+#include "TimingWheel.h"
+#include "CameraRegistry.h"
+#include "CameraHealth.h"
+#include "TimeLapseGenerator.h"
+#include "ImageIndex.h"
+#include "TrafficReplay.h"
+#include <memory>
 #include <iostream>
 
 
 using namespace std::string_literals;
 
 
-class ImageUploadRequestHandler: public Poco::Net::HTTPRequestHandler
+class ImageUploadServer: public Poco::Util::ServerApplication
 {
-public:
-	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+protected:
+	void initialize(Poco::Util::Application& self)
 	{
-		auto& app = Poco::Util::Application::instance();
-		const auto& config = app.config();
+		loadConfiguration(); // load default configuration files, if present
+		Poco::Util::ServerApplication::initialize(self);
 
-		try
+		if (!_showHelp && _benchmark.empty())
 		{
-			if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_POST)
-			{
-				if (authorize(request, config.getString("upload.token"s, ""s)))
-				{
-					if (request.getContentType() == "image/jpeg")
-					{
-						std::string path = storeImage(request, config.getString("upload.path"s, Poco::Path::current()));
-						app.logger().information("Image stored to '%s'."s, path);
-						return sendResponse(request, Poco::Net::HTTPResponse::HTTP_OK, "Image accepted"s);
-					}
-					else
-					{
-						app.logger().warning("Invalid or missing content type '%s' for request from %s: %s %s"s, request.getContentType(), request.clientAddress().toString(), request.getMethod(), request.getURI());
-						ignoreContent(request);
-						return sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Unexpected content type"s);
-					}
-				}
-				else
-				{
-					app.logger().warning("Invalid or missing token for request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
-					ignoreContent(request);
-					return sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing or invalid upload token"s);
-				}
-			}
-			else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET)
-			{
-				return sendResponse(request, Poco::Net::HTTPResponse::HTTP_OK, "Image upload server ready"s);
-			}
-			else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_HEAD)
+			// A running server must have released the storage
+			// before the image store is created.
+			takeOverSocket();
+			createImageStore();
+			createShardRing();
+			createAdmissionController();
+			createStorageScheduler();
+			createTrafficCapture();
+			createStatistics();
+			createCameraRegistry();
+			createTimers();
+			createCameraHealth();
+			createImageIndex();
+			createTimeLapseGenerator();
+		}
+	}
+
+	void uninitialize()
+	{
+		if (_pTimers) _pTimers->stop();
+		_pTimeLapse.reset();
+		_pIndex.reset();
+		_pHealth.reset();
+		_pTimers.reset();
+		_pRegistry.reset();
+		_pStatistics.reset();
+		_pCapture.reset();
+		_pShardRing.reset();
+		if (_pStore)
+		{
+			_pStore->stop();
+			_pStore.reset();
+			_pReplicaStore.reset();
+			_pArchivingStore.reset();
+			_pChecksummingStore.reset();
+			_pReplicatingStore.reset();
+			_pJournalingStore.reset();
+		}
+		if (_pHandoff)
+		{
+			_pHandoff->release();
+			_pHandoff.reset();
+		}
+		Poco::Util::ServerApplication::uninitialize();
+	}
+
+	void createImageStore()
+	{
+		_pBufferPool = std::make_unique<AlignedBufferPool>(
+			config().getUInt("upload.bufferSize"s, 262144),
+			config().getUInt("upload.directAlignment"s, 4096),
+			config().getInt("upload.pooledBuffers"s, 32));
+
+		ImageStore::Ptr pBulk;
+		const std::string backend = config().getString("upload.backend"s, "filesystem"s);
+		if (backend == "filesystem")
+		{
+			FileImageStore::Ptr pFiles = new FileImageStore(
+				config().getString("upload.path"s, Poco::Path::current()),
+				ImageWriter::parseWriteMode(config().getString("upload.writeMode"s, "buffered"s)),
+				*_pBufferPool,
+				config().getUInt("upload.directoryCache"s, 256));
+
+			if (config().getBool("upload.archive.enable"s, false))
 			{
-				response.send();
-				return;
+				_pArchivingStore = new ArchivingImageStore(
+					pFiles,
+					Poco::Timespan(config().getInt("upload.archive.delay"s, 3600), 0),
+					Poco::Timespan(config().getInt("upload.archive.scanInterval"s, 600), 0),
+					config().getUInt("upload.archive.cachedArchives"s, 64));
+				pBulk = _pArchivingStore;
 			}
 			else
 			{
-				return sendResponse(request, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Request method not allowed"s);
+				pBulk = pFiles;
 			}
 		}
-		catch (Poco::Exception& exc)
+		else if (backend == "s3")
+		{
+			pBulk = createS3ImageStore();
+		}
+		else throw Poco::InvalidArgumentException("Invalid storage backend"s, backend);
+
+		const std::string spoolPath = config().getString("upload.spool.path"s, ""s);
+		if (!spoolPath.empty())
+		{
+			FileImageStore::Ptr pSpool = new FileImageStore(
+				spoolPath,
+				ImageWriter::parseWriteMode(config().getString("upload.spool.writeMode"s, "buffered"s)),
+				*_pBufferPool,
+				config().getUInt("upload.directoryCache"s, 256));
+
+			_pStore = new SpoolingImageStore(
+				pSpool,
+				pBulk,
+				config().getInt("upload.spool.migrationThreads"s, 2),
+				Poco::Timespan(config().getInt("upload.spool.migrationDelay"s, 60), 0),
+				Poco::Timespan(config().getInt("upload.spool.retryDelay"s, 30), 0));
+		}
+		else
+		{
+			_pStore = pBulk;
+		}
+
+		const std::string integrityPath = config().getString("upload.integrity.path"s, ""s);
+		if (!integrityPath.empty())
 		{
-			app.logger().log(exc);
-			if (!response.sent())
+			_pChecksummingStore = new ChecksummingImageStore(
+				_pStore,
+				integrityPath,
+				config().getUInt("upload.integrity.batchSize"s, 64),
+				Poco::Timespan(config().getInt("upload.integrity.flushInterval"s, 5), 0),
+				config().getUInt64("upload.integrity.scrubRate"s, 10485760),
+				Poco::Timespan(config().getInt("upload.integrity.scrubInterval"s, 86400), 0));
+			_pStore = _pChecksummingStore;
+		}
+
+		// Images received from a peer are stored without being
+		// replicated back.
+		_pReplicaStore = _pStore;
+		const std::string peer = config().getString("upload.replication.peer"s, ""s);
+		if (!peer.empty())
+		{
+			FileImageStore::Ptr pOutbox = new FileImageStore(
+				config().getString("upload.replication.outbox.path"s, Poco::Path(Poco::Path::current()).pushDirectory("outbox"s).toString()),
+				ImageWriter::parseWriteMode(config().getString("upload.replication.outbox.writeMode"s, "buffered"s)),
+				*_pBufferPool,
+				config().getUInt("upload.directoryCache"s, 256));
+
+			_pReplicatingStore = new ReplicatingImageStore(
+				_pReplicaStore,
+				Poco::URI(peer),
+				config().getString("upload.replication.token"s, config().getString("upload.token"s, ""s)),
+				pOutbox,
+				config().getInt("upload.replication.connections"s, 2),
+				Poco::Timespan(config().getInt("upload.replication.timeout"s, 30), 0),
+				Poco::Timespan(config().getInt("upload.replication.retryDelay"s, 5), 0),
+				Poco::Timespan(config().getInt("upload.replication.maxRetryDelay"s, 300), 0));
+			_pStore = _pReplicatingStore;
+		}
+
+		const std::string journalPath = config().getString("upload.journal.path"s, ""s);
+		if (!journalPath.empty())
+		{
+			_pJournalingStore = new JournalingImageStore(
+				_pStore,
+				journalPath,
+				config().getUInt64("upload.journal.segmentSize"s, 64*1024*1024),
+				config().getInt("upload.journal.threads"s, 2),
+				Poco::Timespan(config().getInt("upload.journal.retryDelay"s, 5), 0),
+				config().getUInt("upload.journal.maxPending"s, 1000),
+				config().getUInt("upload.fairness.quantum"s, 262144),
+				Poco::Timespan(0, 1000*config().getInt("upload.journal.syncInterval"s, 1000)));
+			_pStore = _pJournalingStore;
+		}
+
+		// Replays the journal, if any, before the server accepts requests.
+		_pStore->start();
+	}
+
+	void takeOverSocket()
+	{
+		const std::string handoffPath = config().getString("http.handoff.path"s, ""s);
+		if (!handoffPath.empty())
+		{
+			_inheritedSocket = SocketHandoff::takeOver(handoffPath, Poco::Timespan(config().getInt("http.handoff.timeout"s, 120), 0));
+			if (_inheritedSocket >= 0)
 			{
-				sendResponse(request, Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "error uploading file");
+				logger().information("Took over listening socket from running server."s);
 			}
 		}
 	}
 
-	bool authorize(Poco::Net::HTTPServerRequest& request, const std::string& token)
+	void createShardRing()
 	{
-		Poco::URI uri(request.getURI());
-		Poco::Net::HTMLForm params;
-		params.read(uri.getRawQuery());
-		return params.get("token"s, ""s) == token;
+		const std::string nodes = config().getString("cluster.nodes"s, ""s);
+		if (!nodes.empty())
+		{
+			Poco::StringTokenizer tok(nodes, ","s, Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+			std::vector<std::string> addresses(tok.begin(), tok.end());
+
+			_pShardRing = std::make_unique<ShardRing>(
+				addresses,
+				config().getString("cluster.self"s),
+				config().getInt("cluster.virtualNodes"s, 64),
+				ShardRing::parseMode(config().getString("cluster.mode"s, "redirect"s)),
+				Poco::Timespan(config().getInt("cluster.timeout"s, 30), 0),
+				config().getInt("cluster.connections"s, 4));
+		}
 	}
 
-	std::string storeImage(Poco::Net::HTTPServerRequest& request, const std::string& uploadPath)
+	void createAdmissionController()
 	{
-		Poco::Path p(uploadPath);
-		p.makeDirectory();
-		p.pushDirectory(uploadSite(request));
-		p.pushDirectory(uploadCamera(request));
-
-		Poco::LocalDateTime now;
-		p.pushDirectory(Poco::NumberFormatter::format(now.year()));
-		p.pushDirectory(Poco::NumberFormatter::format0(now.month(), 2));
-		p.pushDirectory(Poco::NumberFormatter::format0(now.day(), 2));
-		p.pushDirectory(Poco::NumberFormatter::format0(now.hour(), 2));
-
-		Poco::File dir(p.toString());
-		dir.createDirectories();
-
-		p.setFileName(Poco::DateTimeFormatter::format(now, "%Y%m%d-%H%M%S-%F.jpg"s));
-
-		Poco::FileOutputStream fileStream(p.toString());
-		Poco::StreamCopier::copyStream(request.stream(), fileStream);
-
-		return p.toString();
+		const int target = config().getInt("upload.admission.target"s, 500);
+		const int maxInFlight = config().getInt("upload.admission.maxInFlight"s, 0);
+		const int maxSiteInFlight = config().getInt("upload.fairness.maxSiteInFlight"s, 0);
+		if (target > 0 || maxInFlight > 0 || maxSiteInFlight > 0)
+		{
+			_pAdmission = std::make_unique<AdmissionController>(
+				Poco::Timespan(static_cast<Poco::Timespan::TimeDiff>(target)*Poco::Timespan::MILLISECONDS),
+				Poco::Timespan(static_cast<Poco::Timespan::TimeDiff>(config().getInt("upload.admission.interval"s, 1000))*Poco::Timespan::MILLISECONDS),
+				maxInFlight,
+				maxSiteInFlight);
+		}
 	}
 
-	std::string uploadSite(const Poco::Net::HTTPServerRequest& request) const
+	void createStorageScheduler()
 	{
-		Poco::URI uri(request.getURI());
-		Poco::Path p(uri.getPath(), Poco::Path::PATH_UNIX);
-		p.makeDirectory();
-		if (p.depth() >= 2)
+		const int slots = config().getInt("upload.scheduler.slots"s, 0);
+		if (slots > 0)
 		{
-			return p[1];
+			_pScheduler = std::make_unique<StorageScheduler>(
+				slots,
+				config().getInt("upload.priority.eventWeight"s, 4),
+				config().getInt("upload.priority.periodicWeight"s, 1),
+				config().getUInt("upload.fairness.quantum"s, 262144),
+				config().getInt("upload.fairness.maxSiteSlots"s, 0));
 		}
-		else
+	}
+
+	void createTrafficCapture()
+	{
+		const std::string capturePath = config().getString("upload.capture.path"s, ""s);
+		if (!capturePath.empty())
 		{
-			return "defaultSite";
+			_pCapture = std::make_unique<TrafficCapture>(
+				capturePath,
+				config().getBool("upload.capture.bodies"s, false));
+			logger().information("Capturing requests to %s."s, capturePath);
 		}
 	}
 
-	std::string uploadCamera(const Poco::Net::HTTPServerRequest& request) const
+	void createStatistics()
 	{
-		Poco::URI uri(request.getURI());
-		Poco::Path p(uri.getPath(), Poco::Path::PATH_UNIX);
-		p.makeDirectory();
-		if (p.depth() >= 3)
+		_pStatistics = std::make_unique<ServerStatistics>(
+			config().getString("upload.path"s, Poco::Path::current()),
+			config().getUInt("status.maxSites"s, 4096),
+			config().getUInt("status.slowRequests"s, 10));
+
+		if (_pAdmission)
 		{
-			return p[2];
+			_pStatistics->addGauge("admission.inFlight"s, [this]() { return static_cast<Poco::Int64>(_pAdmission->inFlight()); });
+			_pStatistics->addGauge("admission.rejected"s, [this]() { return static_cast<Poco::Int64>(_pAdmission->rejected()); });
 		}
-		else
+		if (_pScheduler)
+		{
+			_pStatistics->addGauge("scheduler.waiting.event"s, [this]() { return static_cast<Poco::Int64>(_pScheduler->waiting(StorageScheduler::PRIORITY_EVENT)); });
+			_pStatistics->addGauge("scheduler.waiting.periodic"s, [this]() { return static_cast<Poco::Int64>(_pScheduler->waiting(StorageScheduler::PRIORITY_PERIODIC)); });
+		}
+		if (_pJournalingStore)
+		{
+			_pStatistics->addGauge("journal.pending"s, [this]() { return static_cast<Poco::Int64>(_pJournalingStore->pending()); });
+		}
+		if (_pReplicatingStore)
+		{
+			_pStatistics->addGauge("replication.pending"s, [this]() { return static_cast<Poco::Int64>(_pReplicatingStore->pending()); });
+		}
+		if (_pArchivingStore)
 		{
-			return "defaultCamera";
+			_pStatistics->addGauge("archive.directories"s, [this]() { return static_cast<Poco::Int64>(_pArchivingStore->compactor().archivedDirectories()); });
+			_pStatistics->addGauge("archive.images"s, [this]() { return static_cast<Poco::Int64>(_pArchivingStore->compactor().archivedImages()); });
 		}
+		if (_pChecksummingStore && _pChecksummingStore->scrubber())
+		{
+			_pStatistics->addGauge("integrity.verified"s, [this]() { return static_cast<Poco::Int64>(_pChecksummingStore->scrubber()->verified()); });
+			_pStatistics->addGauge("integrity.corrupted"s, [this]() { return static_cast<Poco::Int64>(_pChecksummingStore->scrubber()->corrupted()); });
+			_pStatistics->addGauge("integrity.missing"s, [this]() { return static_cast<Poco::Int64>(_pChecksummingStore->scrubber()->missing()); });
+		}
+		_pStatistics->addGauge("registry.cameras"s, [this]() { return _pRegistry ? static_cast<Poco::Int64>(_pRegistry->size()) : 0; });
+		_pStatistics->addGauge("timers.pending"s, [this]() { return _pTimers ? static_cast<Poco::Int64>(_pTimers->size()) : 0; });
+		_pStatistics->addGauge("index.images"s, [this]() { return _pIndex ? static_cast<Poco::Int64>(_pIndex->size()) : 0; });
 	}
 
-	void ignoreContent(Poco::Net::HTTPServerRequest& request)
+	void createCameraRegistry()
 	{
-		Poco::NullOutputStream nullStream;
-		Poco::StreamCopier::copyStream(request.stream(), nullStream);
+		_pRegistry = std::make_unique<CameraRegistry>(config().getUInt("registry.maxCameras"s, 65536));
 	}
 
-	static void sendResponse(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPResponse::HTTPStatus status, const std::string& message)
+	void createTimers()
 	{
-		request.response().setContentType("text/html"s);
-		request.response().setStatusAndReason(status);
-
-		std::string html("<!DOCTYPE html>\n<html><head><title>");
-		html += Poco::NumberFormatter::format(static_cast<int>(status));
-		html += " - ";
-		html += request.response().getReasonForStatus(status);
-		html += "</title></head><body><header><h1>"s;
-		html += Poco::NumberFormatter::format(static_cast<int>(status));
-		html += " - ";
-		html += request.response().getReasonForStatus(status);
-		html += "</h1></header><section><p>"s;
-		html += Poco::Net::htmlize(message);
-		html += "</p></section>"s;
-		html += "</body></html>"s;
-		request.response().sendBuffer(html.data(), html.size());
+		_pTimers = std::make_unique<TimingWheel>(Poco::Timespan(0, 1000*config().getInt("timers.tick"s, 100)));
 	}
-};
 
-
-class ImageUploadRequestHandlerFactory: public Poco::Net::HTTPRequestHandlerFactory
-{
-public:
-	Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& request)
+	void createCameraHealth()
 	{
-		auto& app = Poco::Util::Application::instance();
-
-		app.logger().information("Request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
-		if (app.logger().debug())
-		{
-			std::ostringstream sstr;
-			request.write(sstr);
-			app.logger().debug("Request details: %s"s, sstr.str());
-		}
-
-		return new ImageUploadRequestHandler;
+		_pHealth = std::make_unique<CameraHealth>(
+			*_pRegistry,
+			*_pTimers,
+			config().getDouble("health.silenceFactor"s, 3.0),
+			Poco::Timespan(config().getInt("health.minSilence"s, 300), 0));
 	}
-};
 
+	void createImageIndex()
+	{
+		_pIndex = std::make_unique<ImageIndex>(
+			*_pRegistry,
+			Poco::Timespan(config().getInt("index.retention"s, 86400), 0));
+	}
 
-class ImageUploadServer: public Poco::Util::ServerApplication
-{
-protected:
-	void initialize(Poco::Util::Application& self)
+	void createTimeLapseGenerator()
 	{
-		loadConfiguration(); // load default configuration files, if present
-		Poco::Util::ServerApplication::initialize(self);
+		const std::string timeLapsePath = config().getString("timelapse.path"s, ""s);
+		if (!timeLapsePath.empty())
+		{
+			_pTimeLapse = std::make_unique<TimeLapseGenerator>(
+				*_pStore,
+				timeLapsePath,
+				config().getUInt("timelapse.maxJobs"s, 100));
+		}
 	}
 
-	void uninitialize()
+	ImageStore::Ptr createS3ImageStore()
 	{
-		Poco::Util::ServerApplication::uninitialize();
+		S3Client::Params params;
+		params.endpoint = config().getString("upload.s3.endpoint"s);
+		params.region = config().getString("upload.s3.region"s, params.region);
+		params.bucket = config().getString("upload.s3.bucket"s);
+		params.accessKey = config().getString("upload.s3.accessKey"s, ""s);
+		params.secretKey = config().getString("upload.s3.secretKey"s, ""s);
+		params.timeout = Poco::Timespan(config().getInt("upload.s3.timeout"s, 30), 0);
+
+		const int connections = config().getInt("upload.s3.connections"s, 4);
+		params.maxIdleConnections = connections;
+
+		FileImageStore::Ptr pBuffer = new FileImageStore(
+			config().getString("upload.s3.buffer.path"s, Poco::Path(Poco::Path::current()).pushDirectory("s3buffer"s).toString()),
+			ImageWriter::parseWriteMode(config().getString("upload.s3.buffer.writeMode"s, "buffered"s)),
+			*_pBufferPool,
+			config().getUInt("upload.directoryCache"s, 256));
+
+		return new S3ImageStore(
+			params,
+			config().getString("upload.s3.prefix"s, ""s),
+			pBuffer,
+			connections,
+			Poco::Timespan(config().getInt("upload.s3.retryDelay"s, 5), 0),
+			Poco::Timespan(config().getInt("upload.s3.maxRetryDelay"s, 300), 0));
 	}
 
 	void defineOptions(Poco::Util::OptionSet& options)
@@ -235,6 +419,13 @@ protected:
 				.repeatable(true)
 				.argument("file")
 				.callback(Poco::Util::OptionCallback<ImageUploadServer>(this, &ImageUploadServer::handleConfig)));
+
+		options.addOption(
+			Poco::Util::Option("benchmark", "b", "Run the given benchmark suite (storage, strategies, handler), the soak test (soak) or a traffic replay (replay) and exit.")
+				.required(false)
+				.repeatable(false)
+				.argument("suite")
+				.callback(Poco::Util::OptionCallback<ImageUploadServer>(this, &ImageUploadServer::handleBenchmark)));
 	}
 
 	void handleHelp(const std::string& name, const std::string& value)
@@ -249,6 +440,11 @@ protected:
 		loadConfiguration(value);
 	}
 
+	void handleBenchmark(const std::string& name, const std::string& value)
+	{
+		_benchmark = value;
+	}
+
 	void displayHelp()
 	{
 		Poco::Util::HelpFormatter helpFormatter(options());
@@ -260,20 +456,136 @@ protected:
 
 	int main(const std::vector<std::string>& args)
 	{
-		if (!_showHelp)
+		if (!_showHelp && !_benchmark.empty())
 		{
-			Poco::UInt16 port = static_cast<Poco::UInt16>(config().getInt("http.port"s, 9980));
-			Poco::Net::ServerSocket svs(port);
-			Poco::Net::HTTPServer srv(new ImageUploadRequestHandlerFactory, svs, new Poco::Net::HTTPServerParams);
+			return runBenchmark(_benchmark);
+		}
+		else if (!_showHelp)
+		{
+			Poco::Net::ServerSocket svs;
+			if (_inheritedSocket >= 0)
+			{
+				svs = SocketHandoff::HandoffServerSocket(_inheritedSocket);
+			}
+			else
+			{
+				Poco::UInt16 port = static_cast<Poco::UInt16>(config().getInt("http.port"s, 9980));
+				svs = Poco::Net::ServerSocket(port, config().getInt("http.backlog"s, 64));
+			}
+			Poco::Net::HTTPServer srv(new ImageUploadRequestHandlerFactory(*_pStore, *_pReplicaStore, _pShardRing.get(), _pAdmission.get(), _pScheduler.get(), _pCapture.get(), _pStatistics.get(), _pRegistry.get(), _pHealth.get(), _pTimeLapse.get(), _pIndex.get()), svs, createServerParams());
 			srv.start();
+			_pStatistics->setServer(&srv);
+			_pStatistics->start();
+			_pTimers->start();
+			if (_pTimeLapse) _pTimeLapse->start();
+
+			const std::string handoffPath = config().getString("http.handoff.path"s, ""s);
+			if (!handoffPath.empty())
+			{
+				_pHandoff = std::make_unique<SocketHandoff>(handoffPath);
+				_pHandoff->start(svs);
+			}
+
 			waitForTerminationRequest();
-			srv.stop();
+			if (_pHandoff) _pHandoff->stop();
+			drain(srv);
+			if (_pTimeLapse) _pTimeLapse->stop();
+			_pTimers->stop();
+			_pStatistics->stop();
+			_pStatistics->setServer(nullptr);
 		}
 		return Application::EXIT_OK;
 	}
 
+	Poco::Net::HTTPServerParams::Ptr createServerParams()
+	{
+		Poco::Net::HTTPServerParams::Ptr pParams = new Poco::Net::HTTPServerParams;
+		pParams->setMaxThreads(config().getInt("http.maxThreads"s, 16));
+		pParams->setMaxQueued(config().getInt("http.maxQueued"s, 64));
+		return pParams;
+	}
+
+	void drain(Poco::Net::HTTPServer& srv)
+	{
+		// Stop accepting connections and let keep-alive connections
+		// close after their current request. Requests still running
+		// after the drain timeout are aborted.
+		const Poco::Timespan timeout(config().getInt("http.drainTimeout"s, 30), 0);
+		logger().information("Draining %d connections."s, srv.currentConnections());
+		srv.stopAll(false);
+
+		Poco::Timestamp start;
+		while (srv.currentConnections() > 0 && !start.isElapsed(timeout.totalMicroseconds()))
+		{
+			Poco::Thread::sleep(100);
+		}
+		if (srv.currentConnections() > 0)
+		{
+			logger().warning("Aborting %d connections after drain timeout."s, srv.currentConnections());
+			srv.stopAll(true);
+		}
+	}
+
+	int runBenchmark(const std::string& suite)
+	{
+		if (suite == "storage")
+		{
+			StorageBenchmark benchmark(config());
+			benchmark.run(std::cout);
+			return Application::EXIT_OK;
+		}
+		else if (suite == "strategies")
+		{
+			StorageStrategyBenchmark benchmark(config());
+			benchmark.run(std::cout);
+			return Application::EXIT_OK;
+		}
+		else if (suite == "handler")
+		{
+			HandlerBenchmark benchmark(config());
+			benchmark.run(std::cout);
+			return Application::EXIT_OK;
+		}
+		else if (suite == "soak")
+		{
+			SoakTest soakTest(config());
+			return soakTest.run(std::cout) ? Application::EXIT_OK : Application::EXIT_SOFTWARE;
+		}
+		else if (suite == "replay")
+		{
+			TrafficReplay replay(config());
+			replay.run(std::cout);
+			return Application::EXIT_OK;
+		}
+		else
+		{
+			logger().error("Unknown benchmark suite '%s'."s, suite);
+			return Application::EXIT_USAGE;
+		}
+	}
+
 private:
 	bool _showHelp = false;
+	std::string _benchmark;
+	std::unique_ptr<AlignedBufferPool> _pBufferPool;
+	ImageStore::Ptr _pStore;
+	ImageStore::Ptr _pReplicaStore;
+	ArchivingImageStore::Ptr _pArchivingStore;
+	ChecksummingImageStore::Ptr _pChecksummingStore;
+	ReplicatingImageStore::Ptr _pReplicatingStore;
+	JournalingImageStore::Ptr _pJournalingStore;
+	std::unique_ptr<ShardRing> _pShardRing;
+	std::unique_ptr<AdmissionController> _pAdmission;
+	std::unique_ptr<StorageScheduler> _pScheduler;
+	std::unique_ptr<TrafficCapture> _pCapture;
+	std::unique_ptr<ServerStatistics> _pStatistics;
+	std::unique_ptr<CameraRegistry> _pRegistry;
+	std::unique_ptr<TimingWheel> _pTimers;
+	std::unique_ptr<CameraHealth> _pHealth;
+	std::unique_ptr<ImageIndex> _pIndex;
+	std::unique_ptr<TimeLapseGenerator> _pTimeLapse;
+	int _inheritedSocket = -1;
+	std::unique_ptr<SocketHandoff> _pHandoff;
 };
 
 
@@ -0,0 +1,173 @@
+//
+// CameraHealth.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "CameraHealth.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeFormat.h"
+#include <map>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	template <class T>
+	void updateAverage(std::atomic<T>& average, T sample)
+		/// Moves the average 1/8 towards the sample.
+	{
+		T current = average.load(std::memory_order_relaxed);
+		T next;
+		do
+		{
+			next = current == 0 ? sample : current - current/8 + sample/8;
+		}
+		while (!average.compare_exchange_weak(current, next, std::memory_order_relaxed));
+	}
+}
+
+
+CameraHealth::CameraHealth(const CameraRegistry& registry, TimingWheel& timers, double silenceFactor, Poco::Timespan minSilence):
+	_registry(registry),
+	_timers(timers),
+	_cameras(new Camera[registry.capacity()]),
+	_silenceFactor(silenceFactor),
+	_minSilence(minSilence),
+	_logger(Poco::Logger::get("CameraHealth"s))
+{
+}
+
+
+CameraHealth::~CameraHealth()
+{
+	const std::size_t n = _registry.size();
+	for (std::size_t id = 0; id < n; id++)
+	{
+		const TimingWheel::TimerId timer = _cameras[id].timer.exchange(0);
+		if (timer) _timers.cancel(timer);
+	}
+}
+
+
+void CameraHealth::upload(CameraRegistry::CameraId id, Poco::UInt64 size, bool periodic)
+{
+	if (id == CameraRegistry::INVALID_ID) return;
+
+	Camera& camera = _cameras[id];
+	const Poco::Timestamp::TimeVal now = Poco::Timestamp().epochMicroseconds();
+	camera.lastUpload.store(now, std::memory_order_relaxed);
+	camera.uploads.fetch_add(1, std::memory_order_relaxed);
+	if (size > 0) updateAverage<Poco::UInt64>(camera.averageSize, size);
+	if (periodic)
+	{
+		const Poco::Timestamp::TimeVal previous = camera.lastPeriodicUpload.exchange(now, std::memory_order_relaxed);
+		if (previous > 0 && now > previous)
+		{
+			updateAverage<Poco::Timestamp::TimeDiff>(camera.interval, now - previous);
+		}
+	}
+	if (camera.stale.exchange(false, std::memory_order_relaxed))
+	{
+		_logger.notice("Camera %s is uploading again."s, name(id));
+	}
+
+	// Only the first upload, and the first upload of a stale
+	// camera, schedule the timer of the camera.
+	if (!camera.armed.exchange(true))
+	{
+		arm(id, _minSilence.totalMicroseconds());
+	}
+}
+
+
+void CameraHealth::arm(CameraRegistry::CameraId id, Poco::Timestamp::TimeDiff delay)
+{
+	_cameras[id].timer.store(_timers.schedule(Poco::Timespan(delay), [this, id]()
+		{
+			check(id);
+		}));
+}
+
+
+void CameraHealth::check(CameraRegistry::CameraId id)
+{
+	Camera& camera = _cameras[id];
+	const Poco::Timestamp::TimeVal now = Poco::Timestamp().epochMicroseconds();
+	const Poco::Timestamp::TimeVal lastUpload = camera.lastUpload.load(std::memory_order_relaxed);
+	const Poco::Timestamp::TimeDiff limit = silenceLimit(camera);
+	if (limit == 0)
+	{
+		arm(id, _minSilence.totalMicroseconds());
+	}
+	else if (now - lastUpload > limit)
+	{
+		camera.timer.store(0);
+		camera.armed.store(false);
+		if (!camera.stale.exchange(true, std::memory_order_relaxed))
+		{
+			_logger.warning("Camera %s has not uploaded an image for %d seconds (usual interval: %d seconds)."s,
+				name(id),
+				static_cast<int>((now - lastUpload)/Poco::Timespan::SECONDS),
+				static_cast<int>(camera.interval.load(std::memory_order_relaxed)/Poco::Timespan::SECONDS));
+		}
+	}
+	else
+	{
+		// An upload racing with a previous check may have
+		// left the camera flagged.
+		if (camera.stale.exchange(false, std::memory_order_relaxed))
+		{
+			_logger.notice("Camera %s is uploading again."s, name(id));
+		}
+		arm(id, lastUpload + limit - now);
+	}
+}
+
+
+Poco::Timestamp::TimeDiff CameraHealth::silenceLimit(const Camera& camera) const
+{
+	// Without a usual interval, a camera cannot be considered silent.
+	const Poco::Timestamp::TimeDiff interval = camera.interval.load(std::memory_order_relaxed);
+	if (interval == 0) return 0;
+
+	const Poco::Timestamp::TimeDiff limit = static_cast<Poco::Timestamp::TimeDiff>(interval*_silenceFactor);
+	return limit > _minSilence.totalMicroseconds() ? limit : _minSilence.totalMicroseconds();
+}
+
+
+Poco::JSON::Array::Ptr CameraHealth::toJSON(bool staleOnly) const
+{
+	std::map<std::string, CameraRegistry::CameraId> cameras;
+	const std::size_t n = _registry.size();
+	for (CameraRegistry::CameraId id = 0; id < n; id++)
+	{
+		const Camera& camera = _cameras[id];
+		if (camera.uploads.load(std::memory_order_relaxed) == 0) continue;
+		if (!staleOnly || camera.stale.load(std::memory_order_relaxed)) cameras[name(id)] = id;
+	}
+
+	const Poco::Timestamp::TimeVal now = Poco::Timestamp().epochMicroseconds();
+	Poco::JSON::Array::Ptr pCameras = new Poco::JSON::Array;
+	for (const auto& entry: cameras)
+	{
+		const Camera& camera = _cameras[entry.second];
+		const Poco::Timestamp::TimeVal lastUpload = camera.lastUpload.load(std::memory_order_relaxed);
+
+		Poco::JSON::Object::Ptr pCamera = new Poco::JSON::Object;
+		pCamera->set("site"s, _registry.site(entry.second));
+		pCamera->set("camera"s, _registry.camera(entry.second));
+		pCamera->set("lastUpload"s, Poco::DateTimeFormatter::format(Poco::Timestamp(lastUpload), Poco::DateTimeFormat::ISO8601_FORMAT));
+		pCamera->set("silence"s, (now - lastUpload)/Poco::Timespan::SECONDS);
+		pCamera->set("uploads"s, camera.uploads.load(std::memory_order_relaxed));
+		pCamera->set("interval"s, camera.interval.load(std::memory_order_relaxed)/1000000.0);
+		pCamera->set("averageSize"s, camera.averageSize.load(std::memory_order_relaxed));
+		pCamera->set("stale"s, camera.stale.load(std::memory_order_relaxed));
+		pCameras->add(pCamera);
+	}
+	return pCameras;
+}
@@ -0,0 +1,102 @@
+//
+// CameraHealth.h
+//
+// Definition of the CameraHealth class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef CameraHealth_INCLUDED
+#define CameraHealth_INCLUDED
+
+
+#include "CameraRegistry.h"
+#include "TimingWheel.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/Logger.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include <atomic>
+#include <string>
+
+
+class CameraHealth
+	/// CameraHealth keeps track of the uploads of every camera
+	/// registered in a CameraRegistry
+	/// (time of the last upload, number of uploads, usual interval
+	/// between periodic uploads and average image size) and detects
+	/// cameras that have stopped uploading.
+	///
+	/// Uploads update the state of their camera with atomic operations
+	/// only. Every camera has a timer in a TimingWheel, which expires
+	/// when the camera would become silent for longer than a given
+	/// multiple of its usual interval, but at least a minimum silence
+	/// period. If the camera has uploaded an image in the meantime, the
+	/// timer is scheduled again, otherwise the camera is flagged as
+	/// stale (logging a warning), and its timer is scheduled again with
+	/// the next upload. Only periodic uploads are used to estimate the
+	/// usual interval, as event images arrive irregularly.
+{
+public:
+	struct Camera
+	{
+		std::atomic<Poco::Timestamp::TimeVal> lastUpload{0};
+			/// Time of the last upload (epoch microseconds).
+		std::atomic<Poco::Timestamp::TimeVal> lastPeriodicUpload{0};
+			/// Time of the last periodic upload (epoch microseconds).
+		std::atomic<Poco::Timestamp::TimeDiff> interval{0};
+			/// Moving average of the interval between periodic uploads.
+		std::atomic<Poco::UInt64> uploads{0};
+		std::atomic<Poco::UInt64> averageSize{0};
+			/// Moving average of the image size.
+		std::atomic<bool> stale{false};
+		std::atomic<bool> armed{false};
+			/// True if the camera's timer is scheduled.
+		std::atomic<TimingWheel::TimerId> timer{0};
+	};
+
+	CameraHealth(const CameraRegistry& registry, TimingWheel& timers, double silenceFactor, Poco::Timespan minSilence);
+		/// Creates the CameraHealth for the cameras in the given
+		/// registry, using the given TimingWheel for its timers.
+		///
+		/// A camera becomes stale if it has been silent for longer than
+		/// silenceFactor times its usual interval and minSilence.
+
+	~CameraHealth();
+		/// Destroys the CameraHealth and cancels its timers.
+		/// The TimingWheel must be stopped first.
+
+	void upload(CameraRegistry::CameraId id, Poco::UInt64 size, bool periodic);
+		/// Records an image upload from the camera with the given ID.
+
+	Poco::JSON::Array::Ptr toJSON(bool staleOnly) const;
+		/// Returns the state of all cameras (or only the stale ones)
+		/// as JSON array, ordered by site and camera name.
+
+protected:
+	void arm(CameraRegistry::CameraId id, Poco::Timestamp::TimeDiff delay);
+	void check(CameraRegistry::CameraId id);
+	std::string name(CameraRegistry::CameraId id) const;
+	Poco::Timestamp::TimeDiff silenceLimit(const Camera& camera) const;
+
+private:
+	const CameraRegistry& _registry;
+	TimingWheel& _timers;
+	std::unique_ptr<Camera[]> _cameras;
+	const double _silenceFactor;
+	const Poco::Timespan _minSilence;
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline std::string CameraHealth::name(CameraRegistry::CameraId id) const
+{
+	return _registry.site(id) + '/' + _registry.camera(id);
+}
+
+
+#endif // CameraHealth_INCLUDED
@@ -0,0 +1,55 @@
+//
+// CameraHealthRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "CameraHealthRequestHandler.h"
+#include "ImageUploadRequestHandler.h"
+#include "Poco/Net/HTMLForm.h"
+#include "Poco/Util/Application.h"
+#include "Poco/URI.h"
+#include <sstream>
+
+
+using namespace std::string_literals;
+
+
+const std::string CameraHealthRequestHandler::PATH("/cameras");
+
+
+CameraHealthRequestHandler::CameraHealthRequestHandler(const CameraHealth& health):
+	_health(health)
+{
+}
+
+
+CameraHealthRequestHandler::~CameraHealthRequestHandler()
+{
+}
+
+
+void CameraHealthRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	auto& app = Poco::Util::Application::instance();
+
+	if (!ImageUploadRequestHandler::authorize(request, app.config().getString("upload.token"s, ""s)))
+	{
+		app.logger().warning("Invalid or missing token for request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing or invalid upload token"s);
+	}
+
+	Poco::URI uri(request.getURI());
+	Poco::Net::HTMLForm params;
+	params.read(uri.getRawQuery());
+	const std::string stale = params.get("stale"s, ""s);
+	const bool staleOnly = stale == "1" || stale == "true";
+
+	std::ostringstream ostr;
+	_health.toJSON(staleOnly)->stringify(ostr, 2);
+	const std::string json = ostr.str();
+	response.set("Cache-Control"s, "no-cache"s);
+	response.setContentType("application/json"s);
+	response.sendBuffer(json.data(), json.size());
+}
@@ -0,0 +1,42 @@
+//
+// CameraHealthRequestHandler.h
+//
+// Definition of the CameraHealthRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef CameraHealthRequestHandler_INCLUDED
+#define CameraHealthRequestHandler_INCLUDED
+
+
+#include "CameraHealth.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include <string>
+
+
+class CameraHealthRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Sends the upload state of all cameras as JSON, or only
+	/// of the stale cameras if requested with stale=1.
+{
+public:
+	CameraHealthRequestHandler(const CameraHealth& health);
+		/// Creates the CameraHealthRequestHandler.
+
+	~CameraHealthRequestHandler();
+		/// Destroys the CameraHealthRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+	static const std::string PATH;
+		/// The path of the camera list ("/cameras").
+
+private:
+	const CameraHealth& _health;
+};
+
+
+#endif // CameraHealthRequestHandler_INCLUDED
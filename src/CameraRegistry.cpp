@@ -0,0 +1,68 @@
+//
+// CameraRegistry.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "CameraRegistry.h"
+
+
+const CameraRegistry::CameraId CameraRegistry::INVALID_ID(~CameraRegistry::CameraId(0));
+
+
+CameraRegistry::CameraRegistry(std::size_t capacity):
+	_capacity(capacity < INVALID_ID ? capacity : INVALID_ID - 1),
+	_names(new Names[_capacity]),
+	_shards(new Shard[SHARDS])
+{
+}
+
+
+CameraRegistry::~CameraRegistry()
+{
+}
+
+
+CameraRegistry::CameraId CameraRegistry::id(const std::string& site, const std::string& camera)
+{
+	const std::string k = key(site, camera);
+	Shard& s = shard(k);
+	{
+		Poco::RWLock::ScopedReadLock lock(s.lock);
+
+		auto it = s.ids.find(k);
+		if (it != s.ids.end()) return it->second;
+	}
+
+	// Registering is rare (once per camera), so IDs are assigned
+	// under a single mutex. The names of a new camera are written
+	// before its ID becomes visible in size() or the shard.
+	Poco::FastMutex::ScopedLock registerLock(_registerMutex);
+	Poco::RWLock::ScopedWriteLock lock(s.lock);
+
+	auto it = s.ids.find(k);
+	if (it != s.ids.end()) return it->second;
+
+	const std::size_t n = _size.load(std::memory_order_relaxed);
+	if (n >= _capacity) return INVALID_ID;
+
+	const CameraId newId = static_cast<CameraId>(n);
+	_names[newId].site = site;
+	_names[newId].camera = camera;
+	_names[newId].directory = k + '/';
+	s.ids.emplace(k, newId);
+	_size.store(n + 1, std::memory_order_release);
+	return newId;
+}
+
+
+CameraRegistry::CameraId CameraRegistry::find(const std::string& site, const std::string& camera) const
+{
+	const std::string k = key(site, camera);
+	Shard& s = shard(k);
+	Poco::RWLock::ScopedReadLock lock(s.lock);
+
+	auto it = s.ids.find(k);
+	return it != s.ids.end() ? it->second : INVALID_ID;
+}
@@ -0,0 +1,154 @@
+//
+// CameraRegistry.h
+//
+// Definition of the CameraRegistry class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef CameraRegistry_INCLUDED
+#define CameraRegistry_INCLUDED
+
+
+#include "Poco/RWLock.h"
+#include "Poco/Mutex.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+class CameraRegistry
+	/// CameraRegistry assigns a compact ID (0, 1, 2, ...) to every
+	/// camera (site and camera name), so that per-camera state can be
+	/// kept in arrays indexed by camera ID, instead of maps keyed by
+	/// site and camera name.
+	///
+	/// Names are mapped to IDs with a hash map split into SHARDS shards,
+	/// each protected by its own read/write lock, so that concurrent
+	/// lookups of different cameras rarely contend. A camera keeps its
+	/// ID until the registry is destroyed. At most capacity() cameras
+	/// are registered.
+{
+public:
+	using CameraId = Poco::UInt32;
+
+	static const CameraId INVALID_ID;
+		/// Returned if a camera is not registered and cannot be
+		/// registered because the registry is full.
+
+	enum
+	{
+		SHARDS = 64
+	};
+
+	explicit CameraRegistry(std::size_t capacity);
+		/// Creates the CameraRegistry for up to capacity cameras.
+
+	~CameraRegistry();
+		/// Destroys the CameraRegistry.
+
+	CameraId id(const std::string& site, const std::string& camera);
+		/// Returns the ID of the given camera, registering the camera
+		/// if necessary. Returns INVALID_ID if the registry is full.
+
+	CameraId find(const std::string& site, const std::string& camera) const;
+		/// Returns the ID of the given camera, or INVALID_ID
+		/// if the camera is not registered.
+
+	const std::string& site(CameraId id) const;
+		/// Returns the site name of the camera with the given ID,
+		/// which must be less than size().
+
+	const std::string& camera(CameraId id) const;
+		/// Returns the camera name of the camera with the given ID,
+		/// which must be less than size().
+
+	const std::string& directory(CameraId id) const;
+		/// Returns the directory of the images of the camera with
+		/// the given ID ("<site>/<camera>/"), relative to the root
+		/// of a storage volume. See ImageKey.
+
+	std::size_t size() const;
+		/// Returns the number of registered cameras. All IDs
+		/// less than size() are valid.
+
+	std::size_t capacity() const;
+		/// Returns the maximum number of cameras.
+
+protected:
+	struct Names
+	{
+		std::string site;
+		std::string camera;
+		std::string directory;
+	};
+
+	struct Shard
+	{
+		mutable Poco::RWLock lock;
+		std::unordered_map<std::string, CameraId> ids;
+	};
+
+	static std::string key(const std::string& site, const std::string& camera);
+	Shard& shard(const std::string& key) const;
+
+private:
+	const std::size_t _capacity;
+	std::unique_ptr<Names[]> _names;
+	std::unique_ptr<Shard[]> _shards;
+	std::atomic<std::size_t> _size{0};
+	Poco::FastMutex _registerMutex;
+
+	CameraRegistry(const CameraRegistry&) = delete;
+	CameraRegistry& operator = (const CameraRegistry&) = delete;
+};
+
+
+//
+// inlines
+//
+inline const std::string& CameraRegistry::site(CameraId id) const
+{
+	return _names[id].site;
+}
+
+
+inline const std::string& CameraRegistry::camera(CameraId id) const
+{
+	return _names[id].camera;
+}
+
+
+inline const std::string& CameraRegistry::directory(CameraId id) const
+{
+	return _names[id].directory;
+}
+
+
+inline std::size_t CameraRegistry::size() const
+{
+	return _size.load(std::memory_order_acquire);
+}
+
+
+inline std::size_t CameraRegistry::capacity() const
+{
+	return _capacity;
+}
+
+
+inline std::string CameraRegistry::key(const std::string& site, const std::string& camera)
+{
+	return site + '/' + camera;
+}
+
+
+inline CameraRegistry::Shard& CameraRegistry::shard(const std::string& key) const
+{
+	return _shards[std::hash<std::string>()(key) % SHARDS];
+}
+
+
+#endif // CameraRegistry_INCLUDED
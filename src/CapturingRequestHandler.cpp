@@ -0,0 +1,199 @@
+//
+// CapturingRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "CapturingRequestHandler.h"
+#include "ImageUploadRequestHandler.h"
+#include "Poco/Util/Application.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	class CountingStreamBuf: public std::streambuf
+		/// Reads from another stream, counting the bytes read.
+	{
+	public:
+		explicit CountingStreamBuf(std::istream& istr):
+			_istr(istr),
+			_buffer(8192)
+		{
+		}
+
+		Poco::UInt64 size() const
+		{
+			return _size;
+		}
+
+	protected:
+		int_type underflow() override
+		{
+			if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+			_istr.read(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+			const std::size_t n = static_cast<std::size_t>(_istr.gcount());
+			if (_istr.bad()) throw Poco::IOException("Error reading request body"s);
+			if (n == 0) return traits_type::eof();
+
+			_size += n;
+			setg(_buffer.data(), _buffer.data(), _buffer.data() + n);
+			return traits_type::to_int_type(*gptr());
+		}
+
+	private:
+		std::istream& _istr;
+		std::vector<char> _buffer;
+		Poco::UInt64 _size = 0;
+	};
+
+	class ForwardedServerRequest: public Poco::Net::HTTPServerRequest
+		/// A request whose body is read from another stream.
+	{
+	public:
+		ForwardedServerRequest(Poco::Net::HTTPServerRequest& request, std::istream& body):
+			_request(request),
+			_stream(body)
+		{
+			setMethod(request.getMethod());
+			setURI(request.getURI());
+			setVersion(request.getVersion());
+			for (const auto& header: request)
+			{
+				add(header.first, header.second);
+			}
+		}
+
+		std::istream& stream()
+		{
+			return _stream;
+		}
+
+		const Poco::Net::SocketAddress& clientAddress() const
+		{
+			return _request.clientAddress();
+		}
+
+		const Poco::Net::SocketAddress& serverAddress() const
+		{
+			return _request.serverAddress();
+		}
+
+		const Poco::Net::HTTPServerParams& serverParams() const
+		{
+			return _request.serverParams();
+		}
+
+		Poco::Net::HTTPServerResponse& response() const
+		{
+			return _request.response();
+		}
+
+		bool secure() const
+		{
+			return _request.secure();
+		}
+
+	private:
+		Poco::Net::HTTPServerRequest& _request;
+		std::istream& _stream;
+	};
+
+	bool receive(std::istream& istr, std::string& body, Poco::UInt64 maxSize)
+		/// Reads the body up to maxSize bytes. Returns false
+		/// if the body is larger.
+	{
+		char buffer[8192];
+		while (istr.good())
+		{
+			istr.read(buffer, sizeof(buffer));
+			const std::size_t n = static_cast<std::size_t>(istr.gcount());
+			if (body.size() + n > maxSize) return false;
+			body.append(buffer, n);
+		}
+		if (istr.bad()) throw Poco::IOException("Error reading request body"s);
+		return true;
+	}
+}
+
+
+CapturingRequestHandler::CapturingRequestHandler(Poco::Net::HTTPRequestHandler* pHandler, TrafficCapture& capture, Poco::Timestamp::TimeDiff offset):
+	_pHandler(pHandler),
+	_capture(capture),
+	_offset(offset)
+{
+}
+
+
+CapturingRequestHandler::~CapturingRequestHandler()
+{
+}
+
+
+void CapturingRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	TrafficCapture::Request captured = capturedRequest(request, _offset);
+	if (_capture.captureBodies())
+	{
+		// The body is received before the wrapped handler
+		// checks the request, so it must be bounded.
+		const Poco::UInt64 maxSize = Poco::Util::Application::instance().config().getUInt64("upload.maxBufferedSize"s, 16*1024*1024);
+		std::string body;
+		if (!receive(request.stream(), body, maxSize))
+		{
+			response.setKeepAlive(false);
+			return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Request body too large"s);
+		}
+		captured.bodySize = body.size();
+		captured.hasBody = !body.empty();
+		_capture.write(captured, body);
+
+		Poco::MemoryInputStream bodyStream(body.data(), body.size());
+		ForwardedServerRequest forwardedRequest(request, bodyStream);
+		_pHandler->handleRequest(forwardedRequest, response);
+	}
+	else
+	{
+		// Only the size is recorded, so the body is passed through.
+		// Without Content-Length, the size is known after the request
+		// has been handled; replay orders requests by arrival time.
+		CountingStreamBuf streamBuf(request.stream());
+		std::istream bodyStream(&streamBuf);
+		ForwardedServerRequest forwardedRequest(request, bodyStream);
+		try
+		{
+			_pHandler->handleRequest(forwardedRequest, response);
+		}
+		catch (...)
+		{
+			if (!request.hasContentLength()) captured.bodySize = streamBuf.size();
+			_capture.write(captured, std::string());
+			throw;
+		}
+		if (!request.hasContentLength()) captured.bodySize = streamBuf.size();
+		_capture.write(captured, std::string());
+	}
+}
+
+
+TrafficCapture::Request CapturingRequestHandler::capturedRequest(const Poco::Net::HTTPServerRequest& request, Poco::Timestamp::TimeDiff offset)
+{
+	TrafficCapture::Request captured;
+	captured.offset = offset;
+	captured.client = request.clientAddress().toString();
+	captured.method = request.getMethod();
+	captured.uri = request.getURI();
+	for (const auto& header: request)
+	{
+		captured.headers.emplace_back(header.first, header.second);
+	}
+	if (request.hasContentLength()) captured.bodySize = static_cast<Poco::UInt64>(request.getContentLength64());
+	return captured;
+}
@@ -0,0 +1,51 @@
+//
+// CapturingRequestHandler.h
+//
+// Definition of the CapturingRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef CapturingRequestHandler_INCLUDED
+#define CapturingRequestHandler_INCLUDED
+
+
+#include "TrafficCapture.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include <memory>
+
+
+class CapturingRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// CapturingRequestHandler records requests to a TrafficCapture
+	/// and passes them on to another handler.
+	///
+	/// If bodies are captured, the body is received first (up to
+	/// upload.maxBufferedSize bytes; larger requests are rejected
+	/// with 400 Bad Request). Otherwise, the body is streamed to the
+	/// other handler, and the request is recorded afterwards.
+{
+public:
+	CapturingRequestHandler(Poco::Net::HTTPRequestHandler* pHandler, TrafficCapture& capture, Poco::Timestamp::TimeDiff offset);
+		/// Creates the CapturingRequestHandler, taking ownership of
+		/// pHandler. offset is the arrival time of the request
+		/// (see TrafficCapture::offset()).
+
+	~CapturingRequestHandler();
+		/// Destroys the CapturingRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+	static TrafficCapture::Request capturedRequest(const Poco::Net::HTTPServerRequest& request, Poco::Timestamp::TimeDiff offset);
+		/// Returns the captured form of the request, without body.
+
+private:
+	std::unique_ptr<Poco::Net::HTTPRequestHandler> _pHandler;
+	TrafficCapture& _capture;
+	Poco::Timestamp::TimeDiff _offset;
+};
+
+
+#endif // CapturingRequestHandler_INCLUDED
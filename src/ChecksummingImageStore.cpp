@@ -0,0 +1,171 @@
+//
+// ChecksummingImageStore.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ChecksummingImageStore.h"
+#include "Crc32c.h"
+#include "Poco/Path.h"
+#include "Poco/Exception.h"
+#include <streambuf>
+#include <vector>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	class ChecksumStreamBuf: public std::streambuf
+		/// Reads from another stream, computing the
+		/// checksum and size of the data read.
+	{
+	public:
+		explicit ChecksumStreamBuf(std::istream& istr):
+			_istr(istr),
+			_buffer(65536)
+		{
+		}
+
+		Poco::UInt32 checksum() const
+		{
+			return _crc.checksum();
+		}
+
+		Poco::UInt64 size() const
+		{
+			return _size;
+		}
+
+	protected:
+		int_type underflow() override
+		{
+			if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+			_istr.read(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+			const std::size_t n = static_cast<std::size_t>(_istr.gcount());
+			if (_istr.bad()) throw Poco::IOException("Error reading image data"s);
+			if (n == 0) return traits_type::eof();
+
+			_crc.update(_buffer.data(), n);
+			_size += n;
+			setg(_buffer.data(), _buffer.data(), _buffer.data() + n);
+			return traits_type::to_int_type(*gptr());
+		}
+
+	private:
+		std::istream& _istr;
+		std::vector<char> _buffer;
+		Crc32c _crc;
+		Poco::UInt64 _size = 0;
+	};
+}
+
+
+ChecksummingImageStore::ChecksummingImageStore(ImageStore::Ptr pTarget, const std::string& manifestPath, std::size_t batchSize, Poco::Timespan flushInterval, Poco::UInt64 scrubRate, Poco::Timespan scrubInterval):
+	_pTarget(pTarget),
+	_manifest(Poco::Path(manifestPath).makeDirectory().toString(), batchSize),
+	_flushInterval(flushInterval),
+	_thread("ManifestFlusher"s),
+	_logger(Poco::Logger::get("ChecksummingImageStore"s))
+{
+	if (scrubRate > 0)
+	{
+		_pScrubber = std::make_unique<ImageScrubber>(*_pTarget, _manifest, scrubRate, scrubInterval);
+	}
+}
+
+
+ChecksummingImageStore::~ChecksummingImageStore()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+std::string ChecksummingImageStore::store(const std::string& key, std::istream& istr)
+{
+	ChecksumStreamBuf streamBuf(istr);
+	std::istream checksumStream(&streamBuf);
+	std::string location = _pTarget->store(key, checksumStream);
+	try
+	{
+		_manifest.add(key, streamBuf.size(), streamBuf.checksum());
+	}
+	catch (Poco::Exception& exc)
+	{
+		// The image has been stored, it just cannot be verified.
+		_logger.error("Failed to write manifest for %s: %s"s, key, exc.displayText());
+	}
+	return location;
+}
+
+
+std::unique_ptr<std::istream> ChecksummingImageStore::open(const std::string& key, Poco::UInt64& size)
+{
+	return _pTarget->open(key, size);
+}
+
+
+bool ChecksummingImageStore::exists(const std::string& key)
+{
+	return _pTarget->exists(key);
+}
+
+
+void ChecksummingImageStore::list(const std::string& directory, std::vector<std::string>& names)
+{
+	_pTarget->list(directory, names);
+}
+
+
+void ChecksummingImageStore::sync()
+{
+	_pTarget->sync();
+}
+
+
+void ChecksummingImageStore::start()
+{
+	_pTarget->start();
+	_stop.reset();
+	_thread.start(*this);
+	_running = true;
+	if (_pScrubber) _pScrubber->start();
+}
+
+
+void ChecksummingImageStore::stop()
+{
+	if (!_running) return;
+
+	if (_pScrubber) _pScrubber->stop();
+	_stop.set();
+	_thread.join();
+	_running = false;
+	_manifest.flush();
+	_pTarget->stop();
+}
+
+
+void ChecksummingImageStore::run()
+{
+	while (!_stop.tryWait(static_cast<long>(_flushInterval.totalMilliseconds())))
+	{
+		try
+		{
+			_manifest.flush();
+		}
+		catch (Poco::Exception& exc)
+		{
+			_logger.error("Failed to write manifests: %s"s, exc.displayText());
+		}
+	}
+}
@@ -0,0 +1,81 @@
+//
+// ChecksummingImageStore.h
+//
+// Definition of the ChecksummingImageStore class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ChecksummingImageStore_INCLUDED
+#define ChecksummingImageStore_INCLUDED
+
+
+#include "ImageStore.h"
+#include "IntegrityManifest.h"
+#include "ImageScrubber.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/Logger.h"
+#include <memory>
+
+
+class ChecksummingImageStore: public ImageStore, private Poco::Runnable
+	/// An ImageStore that computes the CRC-32C checksum of every
+	/// image while the target store reads it, and records size and
+	/// checksum in an IntegrityManifest.
+	///
+	/// A background thread flushes the manifest every flushInterval.
+	/// If scrubRate is not zero, an ImageScrubber verifies the images
+	/// in the target store against the manifest, reading at most
+	/// scrubRate bytes per second.
+{
+public:
+	using Ptr = Poco::SharedPtr<ChecksummingImageStore>;
+
+	ChecksummingImageStore(ImageStore::Ptr pTarget, const std::string& manifestPath, std::size_t batchSize, Poco::Timespan flushInterval, Poco::UInt64 scrubRate, Poco::Timespan scrubInterval);
+		/// Creates the ChecksummingImageStore, keeping the
+		/// manifests in the directory at manifestPath.
+
+	~ChecksummingImageStore();
+		/// Destroys the ChecksummingImageStore, stopping it if necessary.
+
+	const ImageScrubber* scrubber() const;
+		/// Returns the ImageScrubber, or nullptr if
+		/// scrubbing is disabled.
+
+	// ImageStore
+	std::string store(const std::string& key, std::istream& istr) override;
+	std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size) override;
+	bool exists(const std::string& key) override;
+	void list(const std::string& directory, std::vector<std::string>& names) override;
+	void sync() override;
+	void start() override;
+	void stop() override;
+
+protected:
+	void run() override;
+
+private:
+	ImageStore::Ptr _pTarget;
+	IntegrityManifest _manifest;
+	Poco::Timespan _flushInterval;
+	std::unique_ptr<ImageScrubber> _pScrubber;
+	Poco::Thread _thread;
+	Poco::Event _stop;
+	bool _running = false;
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline const ImageScrubber* ChecksummingImageStore::scrubber() const
+{
+	return _pScrubber.get();
+}
+
+
+#endif // ChecksummingImageStore_INCLUDED
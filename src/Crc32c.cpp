@@ -0,0 +1,107 @@
+//
+// Crc32c.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "Crc32c.h"
+#include <cstring>
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CRC32C_X86
+#include <nmmintrin.h>
+#endif
+
+
+namespace
+{
+	struct Table
+	{
+		Poco::UInt32 entries[256];
+
+		Table()
+		{
+			for (Poco::UInt32 i = 0; i < 256; i++)
+			{
+				Poco::UInt32 crc = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+				}
+				entries[i] = crc;
+			}
+		}
+	};
+
+	Poco::UInt32 updateTable(Poco::UInt32 crc, const unsigned char* p, std::size_t length)
+	{
+		static const Table table;
+		while (length-- > 0)
+		{
+			crc = table.entries[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+#ifdef CRC32C_X86
+	__attribute__((target("sse4.2")))
+	Poco::UInt32 updateSSE42(Poco::UInt32 crc, const unsigned char* p, std::size_t length)
+	{
+		Poco::UInt64 crc64 = crc;
+		while (length >= 8)
+		{
+			Poco::UInt64 value;
+			std::memcpy(&value, p, sizeof(value));
+			crc64 = _mm_crc32_u64(crc64, value);
+			p += 8;
+			length -= 8;
+		}
+		crc = static_cast<Poco::UInt32>(crc64);
+		while (length-- > 0)
+		{
+			crc = _mm_crc32_u8(crc, *p++);
+		}
+		return crc;
+	}
+#endif
+
+	using Update = Poco::UInt32 (*)(Poco::UInt32, const unsigned char*, std::size_t);
+
+	Update selectedUpdate()
+	{
+#ifdef CRC32C_X86
+		static const Update update = Crc32c::isHardwareAccelerated() ? updateSSE42 : updateTable;
+#else
+		static const Update update = updateTable;
+#endif
+		return update;
+	}
+}
+
+
+Crc32c::Crc32c():
+	_crc(0xFFFFFFFF)
+{
+}
+
+
+Crc32c::~Crc32c()
+{
+}
+
+
+void Crc32c::update(const char* data, std::size_t length)
+{
+	_crc = selectedUpdate()(_crc, reinterpret_cast<const unsigned char*>(data), length);
+}
+
+
+bool Crc32c::isHardwareAccelerated()
+{
+#ifdef CRC32C_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+#else
+	return false;
+#endif
+}
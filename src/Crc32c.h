@@ -0,0 +1,76 @@
+//
+// Crc32c.h
+//
+// Definition of the Crc32c class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef Crc32c_INCLUDED
+#define Crc32c_INCLUDED
+
+
+#include "Poco/Types.h"
+#include <cstddef>
+#include <string>
+
+
+class Crc32c
+	/// Computes CRC-32C (Castagnoli) checksums, as used by iSCSI,
+	/// ext4 and many storage systems.
+	///
+	/// Uses the SSE4.2 CRC32 instruction if supported by the CPU
+	/// (selected at run time), and a lookup table otherwise.
+	/// The interface follows Poco::Checksum.
+{
+public:
+	Crc32c();
+		/// Creates the Crc32c.
+
+	~Crc32c();
+		/// Destroys the Crc32c.
+
+	void update(const char* data, std::size_t length);
+		/// Updates the checksum with the given data.
+
+	void update(const std::string& data);
+		/// Updates the checksum with the given data.
+
+	Poco::UInt32 checksum() const;
+		/// Returns the checksum of all data so far.
+
+	void reset();
+		/// Resets the checksum.
+
+	static bool isHardwareAccelerated();
+		/// Returns true if the CPU supports the SSE4.2
+		/// CRC32 instruction.
+
+private:
+	Poco::UInt32 _crc;
+};
+
+
+//
+// inlines
+//
+inline void Crc32c::update(const std::string& data)
+{
+	update(data.data(), data.size());
+}
+
+
+inline Poco::UInt32 Crc32c::checksum() const
+{
+	return ~_crc;
+}
+
+
+inline void Crc32c::reset()
+{
+	_crc = 0xFFFFFFFF;
+}
+
+
+#endif // Crc32c_INCLUDED
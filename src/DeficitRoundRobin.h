@@ -0,0 +1,152 @@
+//
+// DeficitRoundRobin.h
+//
+// Definition of the DeficitRoundRobin class template.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef DeficitRoundRobin_INCLUDED
+#define DeficitRoundRobin_INCLUDED
+
+
+#include <functional>
+#include <unordered_map>
+#include <deque>
+#include <string>
+
+
+template <class T>
+class DeficitRoundRobin
+	/// DeficitRoundRobin is a queue of items belonging to flows
+	/// (e.g., the sites images are uploaded from), which are
+	/// dequeued fairly across flows using deficit round-robin.
+	///
+	/// Each flow has its own FIFO queue. Flows with queued items take
+	/// turns; on each turn a flow is credited with a fixed quantum
+	/// and may dequeue items as long as their total cost (e.g., the
+	/// image size) does not exceed its credit. A flow with many
+	/// queued items therefore gets no more than its share, however
+	/// many items it has queued.
+	///
+	/// DeficitRoundRobin is not thread-safe.
+{
+public:
+	using Eligible = std::function<bool(const std::string& flow)>;
+
+	explicit DeficitRoundRobin(std::size_t quantum):
+		_quantum(quantum > 0 ? quantum : 1)
+	{
+	}
+
+	void push(const std::string& flow, const T& item, std::size_t cost)
+		/// Appends an item with the given cost to the queue of the given flow.
+	{
+		auto it = _flows.find(flow);
+		if (it == _flows.end())
+		{
+			it = _flows.emplace(flow, Flow()).first;
+			_active.push_back(flow);
+		}
+		it->second.entries.push_back(Entry{item, cost});
+		_size++;
+	}
+
+	bool pop(T& item, const Eligible& eligible = Eligible())
+		/// Dequeues the next item. If eligible is given, flows for
+		/// which it returns false are skipped. Returns false if
+		/// there is no item to dequeue.
+	{
+		std::size_t skipped = 0;
+		while (!_active.empty() && skipped < _active.size())
+		{
+			const std::string name = _active.front();
+			Flow& flow = _flows[name];
+			if (eligible && !eligible(name))
+			{
+				flow.visited = false;
+				_active.pop_front();
+				_active.push_back(name);
+				skipped++;
+				continue;
+			}
+
+			if (!flow.visited)
+			{
+				flow.deficit += _quantum;
+				flow.visited = true;
+			}
+			Entry& entry = flow.entries.front();
+			if (entry.cost <= flow.deficit)
+			{
+				flow.deficit -= entry.cost;
+				item = entry.item;
+				flow.entries.pop_front();
+				_size--;
+				if (flow.entries.empty())
+				{
+					// idle flows do not keep their credit
+					_active.pop_front();
+					_flows.erase(name);
+				}
+				return true;
+			}
+
+			// The turn of this flow is over.
+			flow.visited = false;
+			_active.pop_front();
+			_active.push_back(name);
+			skipped = 0;
+		}
+		return false;
+	}
+
+	bool empty() const
+		/// Returns true if no items are queued.
+	{
+		return _size == 0;
+	}
+
+	std::size_t size() const
+		/// Returns the number of queued items.
+	{
+		return _size;
+	}
+
+	std::size_t flows() const
+		/// Returns the number of flows with queued items.
+	{
+		return _active.size();
+	}
+
+	void clear()
+		/// Removes all items.
+	{
+		_flows.clear();
+		_active.clear();
+		_size = 0;
+	}
+
+private:
+	struct Entry
+	{
+		T item;
+		std::size_t cost;
+	};
+
+	struct Flow
+	{
+		std::deque<Entry> entries;
+		std::size_t deficit = 0;
+		bool visited = false;
+	};
+
+	std::size_t _quantum;
+	std::unordered_map<std::string, Flow> _flows;
+	std::deque<std::string> _active;
+	std::size_t _size = 0;
+};
+
+
+#endif // DeficitRoundRobin_INCLUDED
@@ -0,0 +1,158 @@
+//
+// DirectoryCache.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "DirectoryCache.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include "Poco/File.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+
+using namespace std::string_literals;
+
+
+DirectoryCache::Directory::Directory(int fd):
+	_fd(fd)
+{
+}
+
+
+DirectoryCache::Directory::~Directory()
+{
+	::close(_fd);
+}
+
+
+DirectoryCache::DirectoryCache(const std::string& root, std::size_t capacity):
+	_root(root),
+	_capacity(capacity)
+{
+}
+
+
+DirectoryCache::~DirectoryCache()
+{
+	if (_rootFd >= 0) ::close(_rootFd);
+}
+
+
+DirectoryCache::DirectoryPtr DirectoryCache::open(const std::string& directory)
+{
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		auto it = _directories.find(directory);
+		if (it != _directories.end())
+		{
+			_lru.splice(_lru.begin(), _lru, it->second);
+			return it->second->second;
+		}
+		rootFd();
+	}
+
+	DirectoryPtr pDirectory = std::make_shared<Directory>(openDirectory(directory));
+
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	if (_capacity == 0) return pDirectory;
+
+	// Another thread may have opened the directory in the meantime.
+	auto it = _directories.find(directory);
+	if (it != _directories.end())
+	{
+		_lru.splice(_lru.begin(), _lru, it->second);
+		return it->second->second;
+	}
+
+	_lru.emplace_front(directory, pDirectory);
+	_directories[directory] = _lru.begin();
+	if (_lru.size() > _capacity)
+	{
+		_directories.erase(_lru.back().first);
+		_lru.pop_back();
+	}
+	return pDirectory;
+}
+
+
+void DirectoryCache::evict(const std::string& directory)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _directories.find(directory);
+	if (it != _directories.end())
+	{
+		_lru.erase(it->second);
+		_directories.erase(it);
+	}
+}
+
+
+std::size_t DirectoryCache::size() const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	return _lru.size();
+}
+
+
+int DirectoryCache::rootFd()
+{
+	if (_rootFd < 0)
+	{
+		Poco::File(_root).createDirectories();
+		_rootFd = ::open(_root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (_rootFd < 0)
+		{
+			throw Poco::OpenFileException(_root, Poco::Error::getMessage(errno));
+		}
+	}
+	return _rootFd;
+}
+
+
+int DirectoryCache::openDirectory(const std::string& directory)
+{
+	const int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+	int fd = ::openat(_rootFd, directory.c_str(), flags);
+	if (fd >= 0) return fd;
+	if (errno != ENOENT)
+	{
+		throw Poco::OpenFileException(_root + directory, Poco::Error::getMessage(errno));
+	}
+
+	// Create the missing directories one level at a time,
+	// each relative to its parent.
+	Poco::StringTokenizer tok(directory, "/"s, Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	std::string path = _root;
+	for (const auto& name: tok)
+	{
+		path += name;
+		path += '/';
+		const int parent = fd >= 0 ? fd : _rootFd;
+		if (::mkdirat(parent, name.c_str(), 0755) != 0 && errno != EEXIST)
+		{
+			const int err = errno;
+			if (fd >= 0) ::close(fd);
+			throw Poco::CreateFileException(path, Poco::Error::getMessage(err));
+		}
+		const int next = ::openat(parent, name.c_str(), flags);
+		const int err = errno;
+		if (fd >= 0) ::close(fd);
+		if (next < 0)
+		{
+			throw Poco::OpenFileException(path, Poco::Error::getMessage(err));
+		}
+		fd = next;
+	}
+	if (fd < 0) fd = ::dup(_rootFd);
+	return fd;
+}
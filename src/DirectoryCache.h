@@ -0,0 +1,105 @@
+//
+// DirectoryCache.h
+//
+// Definition of the DirectoryCache class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef DirectoryCache_INCLUDED
+#define DirectoryCache_INCLUDED
+
+
+#include "Poco/Mutex.h"
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+class DirectoryCache
+	/// DirectoryCache keeps file descriptors of recently used
+	/// directories below a root directory open, so that files can be
+	/// created in them with openat(), without the kernel resolving
+	/// the full path of every file.
+	///
+	/// Up to capacity directories are kept open; the least recently
+	/// used directory is closed first. Missing directories are
+	/// created one level at a time with mkdirat().
+	///
+	/// A directory removed while open stays open (but empty and
+	/// unusable) until evicted; callers creating a file in a cached
+	/// directory should evict() it and retry if that fails.
+{
+public:
+	class Directory
+		/// An open directory. The file descriptor is closed when
+		/// the last reference is released, so a directory evicted
+		/// from the cache remains usable while still referenced.
+	{
+	public:
+		explicit Directory(int fd);
+		~Directory();
+
+		int fd() const;
+
+	private:
+		int _fd;
+
+		Directory(const Directory&) = delete;
+		Directory& operator = (const Directory&) = delete;
+	};
+
+	using DirectoryPtr = std::shared_ptr<Directory>;
+
+	DirectoryCache(const std::string& root, std::size_t capacity);
+		/// Creates the DirectoryCache for the given root directory
+		/// (with a trailing path separator), keeping up to capacity
+		/// directories open.
+
+	~DirectoryCache();
+		/// Destroys the DirectoryCache and closes all directories
+		/// no longer referenced.
+
+	DirectoryPtr open(const std::string& directory);
+		/// Returns the directory with the given path relative to the
+		/// root directory, creating it (and the root directory) if
+		/// necessary. Throws a Poco::FileException if the directory
+		/// cannot be opened or created.
+
+	void evict(const std::string& directory);
+		/// Removes the given directory from the cache.
+
+	std::size_t size() const;
+		/// Returns the number of cached directories.
+
+protected:
+	using LRUList = std::list<std::pair<std::string, DirectoryPtr>>;
+
+	int rootFd();
+	int openDirectory(const std::string& directory);
+
+private:
+	const std::string _root;
+	const std::size_t _capacity;
+	int _rootFd = -1;
+	LRUList _lru;
+	std::unordered_map<std::string, LRUList::iterator> _directories;
+	mutable Poco::FastMutex _mutex;
+
+	DirectoryCache(const DirectoryCache&) = delete;
+	DirectoryCache& operator = (const DirectoryCache&) = delete;
+};
+
+
+//
+// inlines
+//
+inline int DirectoryCache::Directory::fd() const
+{
+	return _fd;
+}
+
+
+#endif // DirectoryCache_INCLUDED
@@ -0,0 +1,126 @@
+//
+// FileImageStore.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "FileImageStore.h"
+#include "ImageKey.h"
+#include "Poco/FileStream.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/Path.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+
+FileImageStore::FileImageStore(const std::string& root, ImageWriter::WriteMode mode, AlignedBufferPool& pool, std::size_t cachedDirectories):
+	_root(Poco::Path(root).makeDirectory().toString()),
+	_writer(mode, pool),
+	_directories(_root, cachedDirectories)
+{
+}
+
+
+FileImageStore::~FileImageStore()
+{
+}
+
+
+bool FileImageStore::exists(const std::string& key)
+{
+	struct stat st;
+	return ::stat(path(key).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+
+bool FileImageStore::remove(const std::string& key)
+{
+	return ::unlink(path(key).c_str()) == 0;
+}
+
+
+void FileImageStore::list(const std::string& directory, std::vector<std::string>& names)
+{
+	Poco::File dir(_root + directory);
+	if (dir.exists())
+	{
+		Poco::DirectoryIterator end;
+		for (Poco::DirectoryIterator it(dir); it != end; ++it)
+		{
+			names.push_back(it.name());
+		}
+	}
+}
+
+
+void FileImageStore::sync()
+{
+	const int fd = ::open(_root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		if (errno == ENOENT) return; // nothing stored yet
+		throw Poco::OpenFileException(_root, Poco::Error::getMessage(errno));
+	}
+	// A single syncfs() writes back all image files and the
+	// directories they have been created in, which is much
+	// cheaper than syncing every file and directory.
+#if defined(__linux__)
+	const int rc = ::syncfs(fd);
+#else
+	::sync();
+	const int rc = 0;
+#endif
+	const int err = errno;
+	::close(fd);
+	if (rc != 0)
+	{
+		throw Poco::WriteFileException(_root, Poco::Error::getMessage(err));
+	}
+}
+
+
+std::string FileImageStore::store(const std::string& key, std::istream& istr)
+{
+	const std::string directory = ImageKey::directory(key);
+	const std::string name = ImageKey::fileName(key);
+	std::string p = path(key);
+	try
+	{
+		_writer.write(istr, _directories.open(directory)->fd(), name, p);
+	}
+	catch (Poco::CreateFileException&)
+	{
+		// The directory may have been removed (e.g., after
+		// migration) since it was opened.
+		_directories.evict(directory);
+		_writer.write(istr, _directories.open(directory)->fd(), name, p);
+	}
+	return p;
+}
+
+
+std::unique_ptr<std::istream> FileImageStore::open(const std::string& key, Poco::UInt64& size)
+{
+	std::string p = path(key);
+	struct stat st;
+	if (::stat(p.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+	{
+		try
+		{
+			auto pStream = std::make_unique<Poco::FileInputStream>(p);
+			size = static_cast<Poco::UInt64>(st.st_size);
+			return pStream;
+		}
+		catch (Poco::FileNotFoundException&)
+		{
+			// removed in the meantime
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,84 @@
+//
+// FileImageStore.h
+//
+// Definition of the FileImageStore class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef FileImageStore_INCLUDED
+#define FileImageStore_INCLUDED
+
+
+#include "ImageStore.h"
+#include "ImageWriter.h"
+#include "DirectoryCache.h"
+#include <vector>
+
+
+class FileImageStore: public ImageStore
+	/// An ImageStore keeping images as individual files
+	/// in a directory tree on a file system volume.
+	///
+	/// The path of an image file is the image key,
+	/// relative to the root directory of the store.
+	///
+	/// Hour directories are kept open in a DirectoryCache, and
+	/// image files are created relative to their directory.
+	///
+	/// Images are not synced when stored; sync() writes back
+	/// the whole volume with syncfs().
+{
+public:
+	using Ptr = Poco::SharedPtr<FileImageStore>;
+
+	FileImageStore(const std::string& root, ImageWriter::WriteMode mode, AlignedBufferPool& pool, std::size_t cachedDirectories = 256);
+		/// Creates the FileImageStore with the given root directory,
+		/// writing images with the given write mode and keeping up
+		/// to cachedDirectories hour directories open.
+
+	~FileImageStore();
+		/// Destroys the FileImageStore.
+
+	const std::string& root() const;
+		/// Returns the root directory of the store, including
+		/// a trailing path separator.
+
+	std::string path(const std::string& key) const;
+		/// Returns the path of the file for the given key.
+
+	bool remove(const std::string& key);
+		/// Removes the image with the given key.
+		/// Returns false if no such image exists.
+
+	// ImageStore
+	std::string store(const std::string& key, std::istream& istr) override;
+	std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size) override;
+	bool exists(const std::string& key) override;
+	void list(const std::string& directory, std::vector<std::string>& names) override;
+	void sync() override;
+
+private:
+	std::string _root;
+	ImageWriter _writer;
+	DirectoryCache _directories;
+};
+
+
+//
+// inlines
+//
+inline const std::string& FileImageStore::root() const
+{
+	return _root;
+}
+
+
+inline std::string FileImageStore::path(const std::string& key) const
+{
+	return _root + key;
+}
+
+
+#endif // FileImageStore_INCLUDED
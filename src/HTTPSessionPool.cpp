@@ -0,0 +1,66 @@
+//
+// HTTPSessionPool.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "HTTPSessionPool.h"
+#include "Poco/NumberFormatter.h"
+
+
+HTTPSessionPool::HTTPSessionPool(const std::string& host, Poco::UInt16 port, Poco::Timespan timeout, int maxIdle):
+	_host(host),
+	_port(port),
+	_timeout(timeout),
+	_maxIdle(maxIdle > 0 ? maxIdle : 0)
+{
+}
+
+
+HTTPSessionPool::~HTTPSessionPool()
+{
+}
+
+
+HTTPSessionPool::SessionPtr HTTPSessionPool::get()
+{
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		if (!_sessions.empty())
+		{
+			SessionPtr pSession = std::move(_sessions.back());
+			_sessions.pop_back();
+			return pSession;
+		}
+	}
+
+	auto pSession = std::make_unique<Poco::Net::HTTPClientSession>(_host, _port);
+	pSession->setKeepAlive(true);
+	pSession->setTimeout(_timeout);
+	return pSession;
+}
+
+
+void HTTPSessionPool::release(SessionPtr pSession)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	if (_sessions.size() < _maxIdle)
+	{
+		_sessions.push_back(std::move(pSession));
+	}
+}
+
+
+std::string HTTPSessionPool::hostHeader() const
+{
+	std::string header(_host);
+	if (_port != 80)
+	{
+		header += ':';
+		Poco::NumberFormatter::append(header, static_cast<unsigned>(_port));
+	}
+	return header;
+}
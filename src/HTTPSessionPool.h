@@ -0,0 +1,81 @@
+//
+// HTTPSessionPool.h
+//
+// Definition of the HTTPSessionPool class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef HTTPSessionPool_INCLUDED
+#define HTTPSessionPool_INCLUDED
+
+
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include <memory>
+#include <vector>
+#include <string>
+
+
+class HTTPSessionPool
+	/// A thread-safe pool of persistent (keep-alive) HTTP client
+	/// sessions to a single server.
+	///
+	/// A session obtained with get() must only be returned to the
+	/// pool with release() after a request/response exchange has
+	/// completed successfully, including reading the entire response
+	/// body. Sessions that have seen an error are simply destroyed.
+{
+public:
+	using SessionPtr = std::unique_ptr<Poco::Net::HTTPClientSession>;
+
+	HTTPSessionPool(const std::string& host, Poco::UInt16 port, Poco::Timespan timeout, int maxIdle);
+		/// Creates the HTTPSessionPool for the given server, keeping
+		/// at most maxIdle idle sessions.
+
+	~HTTPSessionPool();
+		/// Destroys the HTTPSessionPool and closes all idle sessions.
+
+	SessionPtr get();
+		/// Returns an idle session, or creates a new one.
+
+	void release(SessionPtr pSession);
+		/// Returns a session to the pool.
+
+	const std::string& host() const;
+		/// Returns the server host name or address.
+
+	Poco::UInt16 port() const;
+		/// Returns the server port number.
+
+	std::string hostHeader() const;
+		/// Returns the value for the Host header of requests.
+
+private:
+	std::string _host;
+	Poco::UInt16 _port;
+	Poco::Timespan _timeout;
+	std::size_t _maxIdle;
+	std::vector<SessionPtr> _sessions;
+	Poco::FastMutex _mutex;
+};
+
+
+//
+// inlines
+//
+inline const std::string& HTTPSessionPool::host() const
+{
+	return _host;
+}
+
+
+inline Poco::UInt16 HTTPSessionPool::port() const
+{
+	return _port;
+}
+
+
+#endif // HTTPSessionPool_INCLUDED
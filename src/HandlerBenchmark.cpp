@@ -0,0 +1,385 @@
+//
+// HandlerBenchmark.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "HandlerBenchmark.h"
+#include "ImageUploadRequestHandler.h"
+#include "JpegScanner.h"
+#include "ImageStore.h"
+#include "ImageKey.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/SocketAddress.h"
+#include "Poco/Util/Application.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/NullStream.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/LocalDateTime.h"
+#include "Poco/Message.h"
+#include <memory>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	class NullImageStore: public ImageStore
+		/// Discards stored images.
+	{
+	public:
+		std::string store(const std::string& key, std::istream& istr)
+		{
+			Poco::NullOutputStream nullStream;
+			_bytes += Poco::StreamCopier::copyStream64(istr, nullStream);
+			return key;
+		}
+
+		std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size)
+		{
+			return nullptr;
+		}
+
+		Poco::UInt64 bytes() const
+		{
+			return _bytes;
+		}
+
+	private:
+		Poco::UInt64 _bytes = 0;
+	};
+
+	class MockServerResponse: public Poco::Net::HTTPServerResponse
+	{
+	public:
+		void sendContinue()
+		{
+		}
+
+		std::ostream& send()
+		{
+			_sent = true;
+			return _nullStream;
+		}
+
+		std::pair<std::ostream*, std::ostream*> beginSend()
+		{
+			_sent = true;
+			return std::make_pair(&_nullStream, nullptr);
+		}
+
+		void sendFile(const std::string& path, const std::string& mediaType)
+		{
+			_sent = true;
+		}
+
+		void sendBuffer(const void* pBuffer, std::size_t length)
+		{
+			_sent = true;
+			_bytes += length;
+		}
+
+		void redirect(const std::string& uri, HTTPStatus status)
+		{
+			_sent = true;
+		}
+
+		void requireAuthentication(const std::string& realm)
+		{
+			_sent = true;
+		}
+
+		bool sent() const
+		{
+			return _sent;
+		}
+
+		void reset()
+		{
+			clear();
+			_sent = false;
+		}
+
+		Poco::UInt64 bytes() const
+		{
+			return _bytes;
+		}
+
+	private:
+		Poco::NullOutputStream _nullStream;
+		bool _sent = false;
+		Poco::UInt64 _bytes = 0;
+	};
+
+	class MockServerRequest: public Poco::Net::HTTPServerRequest
+	{
+	public:
+		MockServerRequest(const std::string& method, const std::string& uri, const std::string& body):
+			_body(body),
+			_clientAddress("192.0.2.1:49152"s),
+			_serverAddress("127.0.0.1:9980"s),
+			_pParams(new Poco::Net::HTTPServerParams)
+		{
+			setMethod(method);
+			setURI(uri);
+			setVersion(Poco::Net::HTTPMessage::HTTP_1_1);
+			reset();
+		}
+
+		std::istream& stream()
+		{
+			return *_pStream;
+		}
+
+		const Poco::Net::SocketAddress& clientAddress() const
+		{
+			return _clientAddress;
+		}
+
+		const Poco::Net::SocketAddress& serverAddress() const
+		{
+			return _serverAddress;
+		}
+
+		const Poco::Net::HTTPServerParams& serverParams() const
+		{
+			return *_pParams;
+		}
+
+		Poco::Net::HTTPServerResponse& response() const
+		{
+			return _response;
+		}
+
+		bool secure() const
+		{
+			return false;
+		}
+
+		void reset()
+			/// Rewinds the request body and resets the response.
+		{
+			_pStream = std::make_unique<Poco::MemoryInputStream>(_body.data(), _body.size());
+			_response.reset();
+		}
+
+	private:
+		const std::string& _body;
+		std::unique_ptr<std::istream> _pStream;
+		Poco::Net::SocketAddress _clientAddress;
+		Poco::Net::SocketAddress _serverAddress;
+		Poco::Net::HTTPServerParams::Ptr _pParams;
+		mutable MockServerResponse _response;
+	};
+}
+
+
+HandlerBenchmark::HandlerBenchmark(const Poco::Util::AbstractConfiguration& config):
+	_iterations(config.getInt("benchmark.iterations"s, 100000)),
+	_imageSize(config.getUInt("benchmark.imageSize"s, 262144))
+{
+}
+
+
+HandlerBenchmark::~HandlerBenchmark()
+{
+}
+
+
+void HandlerBenchmark::run(std::ostream& ostr)
+{
+	auto& app = Poco::Util::Application::instance();
+	const std::string token = app.config().getString("upload.token"s, ""s);
+	const std::string uploadURI = "/upload/site1/camera01?token="s + token;
+	const std::string body(_imageSize, '\xAA');
+	const std::string empty;
+
+	// Logging every request would dominate the measurements.
+	const int logLevel = app.logger().getLevel();
+	app.logger().setLevel(Poco::Message::PRIO_WARNING);
+
+	ostr << "Handler benchmark: " << _iterations << " iterations per case, images of " << _imageSize << " bytes\n\n";
+	ostr << "case                              ns/op          ops/s\n";
+
+	std::size_t sink = 0;
+	Poco::Stopwatch sw;
+
+	MockServerRequest post(Poco::Net::HTTPRequest::HTTP_POST, uploadURI, body);
+	post.setContentType("image/jpeg"s);
+
+	sw.restart();
+	for (int i = 0; i < _iterations; i++)
+	{
+		sink += ImageUploadRequestHandler::authorize(post, token);
+	}
+	sw.stop();
+	report(ostr, "authorize"s, _iterations, sw);
+
+	sw.restart();
+	for (int i = 0; i < _iterations; i++)
+	{
+		sink += ImageUploadRequestHandler::uploadSite(post).size();
+		sink += ImageUploadRequestHandler::uploadCamera(post).size();
+	}
+	sw.stop();
+	report(ostr, "uploadSite + uploadCamera"s, _iterations, sw);
+
+	sw.restart();
+	for (int i = 0; i < _iterations; i++)
+	{
+		sink += ImageUploadRequestHandler::uploadRoute(post).camera.size();
+	}
+	sw.stop();
+	report(ostr, "uploadRoute"s, _iterations, sw);
+
+	const Poco::LocalDateTime now;
+	sw.restart();
+	for (int i = 0; i < _iterations; i++)
+	{
+		sink += ImageKey::format("site1"s, "camera01"s, now).size();
+	}
+	sw.stop();
+	report(ostr, "ImageKey::format"s, _iterations, sw);
+
+	const std::string cameraDirectory("site1/camera01/");
+	sw.restart();
+	for (int i = 0; i < _iterations; i++)
+	{
+		sink += ImageKey::format(cameraDirectory, now).size();
+	}
+	sw.stop();
+	report(ostr, "ImageKey::format (directory)"s, _iterations, sw);
+
+	const std::string key = ImageKey::format("site1"s, "camera01"s, now);
+	MockServerRequest get(Poco::Net::HTTPRequest::HTTP_GET, "/upload/"s + key + "?token="s + token, empty);
+	sw.restart();
+	for (int i = 0; i < _iterations; i++)
+	{
+		sink += ImageUploadRequestHandler::imageKey(get).size();
+	}
+	sw.stop();
+	report(ostr, "imageKey (GET URI)"s, _iterations, sw);
+
+	sw.restart();
+	for (int i = 0; i < _iterations; i++)
+	{
+		get.reset();
+		ImageUploadRequestHandler::sendResponse(get, Poco::Net::HTTPResponse::HTTP_OK, "Image accepted"s);
+	}
+	sw.stop();
+	report(ostr, "sendResponse"s, _iterations, sw);
+
+	// The copy and upload cases move a whole image per
+	// iteration, so they run fewer iterations.
+	const int copyIterations = _iterations/10 > 0 ? _iterations/10 : 1;
+	sw.restart();
+	for (int i = 0; i < copyIterations; i++)
+	{
+		Poco::MemoryInputStream istr(body.data(), body.size());
+		Poco::NullOutputStream nullStream;
+		sink += static_cast<std::size_t>(Poco::StreamCopier::copyStream64(istr, nullStream));
+	}
+	sw.stop();
+	report(ostr, "body copy loop"s, copyIterations, sw);
+
+	// The marker scan cases find all 0xFF bytes in a JPEG image
+	// of the same size, once per implementation.
+	const std::string jpeg = makeJpeg(_imageSize);
+	const unsigned char* jpegBegin = reinterpret_cast<const unsigned char*>(jpeg.data());
+	const unsigned char* jpegEnd = jpegBegin + jpeg.size();
+	for (auto impl: {JpegScanner::IMPL_SCALAR, JpegScanner::IMPL_SSE2, JpegScanner::IMPL_AVX2})
+	{
+		if (!JpegScanner::isSupported(impl)) continue;
+
+		sw.restart();
+		for (int i = 0; i < copyIterations; i++)
+		{
+			const unsigned char* p = jpegBegin;
+			while ((p = JpegScanner::findFF(p, jpegEnd, impl)) < jpegEnd)
+			{
+				sink++;
+				p++;
+			}
+		}
+		sw.stop();
+		report(ostr, "scan markers ("s + JpegScanner::formatImplementation(impl) + ")"s, copyIterations, sw);
+	}
+
+	sw.restart();
+	for (int i = 0; i < copyIterations; i++)
+	{
+		sink += JpegScanner::isValid(jpeg.data(), jpeg.size());
+	}
+	sw.stop();
+	report(ostr, "JpegScanner::isValid"s, copyIterations, sw);
+
+	NullImageStore store;
+	sw.restart();
+	for (int i = 0; i < copyIterations; i++)
+	{
+		post.reset();
+		ImageUploadRequestHandler handler(store, store);
+		handler.handleRequest(post, post.response());
+	}
+	sw.stop();
+	report(ostr, "handleRequest (POST upload)"s, copyIterations, sw);
+
+	app.logger().setLevel(logLevel);
+
+	if (store.bytes() != static_cast<Poco::UInt64>(copyIterations)*body.size())
+	{
+		ostr << "\nWarning: upload case stored " << store.bytes() << " bytes, expected " << static_cast<Poco::UInt64>(copyIterations)*body.size() << "\n";
+	}
+	ostr << "\n(checksum " << sink << ")" << std::endl;
+}
+
+
+std::string HandlerBenchmark::makeJpeg(std::size_t size)
+{
+	std::string jpeg("\xFF\xD8"s);
+	const auto appendSegment = [&jpeg](unsigned char code, std::size_t length)
+		{
+			jpeg += '\xFF';
+			jpeg += static_cast<char>(code);
+			jpeg += static_cast<char>(length >> 8);
+			jpeg += static_cast<char>(length & 0xFF);
+			jpeg.append(length - 2, '\0');
+		};
+	appendSegment(JpegScanner::MARKER_APP0, 16);
+	appendSegment(0xDB, 67); // DQT
+	appendSegment(JpegScanner::MARKER_SOF0, 17);
+	appendSegment(JpegScanner::MARKER_DHT, 418);
+	appendSegment(JpegScanner::MARKER_SOS, 12);
+
+	// Pseudo-random entropy-coded data, with stuffed 0xFF bytes
+	// and a restart marker every 4 KB.
+	Poco::UInt32 state = 12345;
+	while (jpeg.size() + 2 < size)
+	{
+		state = state*1103515245 + 12345;
+		const char c = static_cast<char>(state >> 16);
+		jpeg += c;
+		if (c == '\xFF') jpeg += '\0';
+		if ((jpeg.size() & 0xFFF) == 0)
+		{
+			jpeg += '\xFF';
+			jpeg += static_cast<char>(JpegScanner::MARKER_RST0 + ((jpeg.size() >> 12) & 7));
+		}
+	}
+	jpeg += "\xFF\xD9"s;
+	return jpeg;
+}
+
+
+void HandlerBenchmark::report(std::ostream& ostr, const std::string& name, int iterations, const Poco::Stopwatch& sw)
+{
+	const double microseconds = static_cast<double>(sw.elapsed());
+	std::string line = name;
+	line.resize(28, ' ');
+	line += Poco::NumberFormatter::format(iterations > 0 ? 1000.0*microseconds/iterations : 0.0, 12, 1);
+	line += Poco::NumberFormatter::format(microseconds > 0 ? iterations*1000000.0/microseconds : 0.0, 15, 0);
+	ostr << line << std::endl;
+}
@@ -0,0 +1,52 @@
+//
+// HandlerBenchmark.h
+//
+// Definition of the HandlerBenchmark class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef HandlerBenchmark_INCLUDED
+#define HandlerBenchmark_INCLUDED
+
+
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/Stopwatch.h"
+#include <ostream>
+#include <string>
+
+
+class HandlerBenchmark
+	/// HandlerBenchmark measures the CPU cost of the steps on the
+	/// request handling hot path of ImageUploadRequestHandler, using
+	/// in-memory request and response objects and an image store
+	/// that discards images, so that no network or disk I/O is involved.
+	/// It also compares the JpegScanner implementations supported by
+	/// the CPU on a synthetic JPEG image of the same size.
+	///
+	/// The benchmark is configured with the following properties:
+	///   - benchmark.iterations: number of iterations per case (default: 100000)
+	///   - benchmark.imageSize: size of an image in bytes (default: 262144)
+{
+public:
+	explicit HandlerBenchmark(const Poco::Util::AbstractConfiguration& config);
+		/// Creates the HandlerBenchmark.
+
+	~HandlerBenchmark();
+		/// Destroys the HandlerBenchmark.
+
+	void run(std::ostream& ostr);
+		/// Runs the benchmark and writes the results to ostr.
+
+protected:
+	static std::string makeJpeg(std::size_t size);
+	void report(std::ostream& ostr, const std::string& name, int iterations, const Poco::Stopwatch& sw);
+
+private:
+	int _iterations;
+	std::size_t _imageSize;
+};
+
+
+#endif // HandlerBenchmark_INCLUDED
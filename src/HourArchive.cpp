@@ -0,0 +1,212 @@
+//
+// HourArchive.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "HourArchive.h"
+#include "Poco/Checksum.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <algorithm>
+#include <streambuf>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const Poco::UInt32 MAX_NAME_LENGTH = 255;
+	const Poco::UInt64 MAX_INDEX_LENGTH = 64*1024*1024;
+
+	class ArchiveStreamBuf: public std::streambuf
+		/// Reads an image from an archive.
+	{
+	public:
+		ArchiveStreamBuf(const HourArchive::Ptr& pArchive, const HourArchive::Entry& entry):
+			_pArchive(pArchive),
+			_entry(entry),
+			_buffer(static_cast<std::size_t>(std::min<Poco::UInt64>(entry.size, 65536)))
+		{
+		}
+
+	protected:
+		int_type underflow() override
+		{
+			if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+			const std::size_t n = _pArchive->read(_entry, _position, _buffer.data(), _buffer.size());
+			if (n == 0) return traits_type::eof();
+
+			_position += n;
+			setg(_buffer.data(), _buffer.data(), _buffer.data() + n);
+			return traits_type::to_int_type(*gptr());
+		}
+
+	private:
+		HourArchive::Ptr _pArchive;
+		HourArchive::Entry _entry;
+		Poco::UInt64 _position = 0;
+		std::vector<char> _buffer;
+	};
+
+	class ArchiveInputStream: public std::istream
+	{
+	public:
+		ArchiveInputStream(const HourArchive::Ptr& pArchive, const HourArchive::Entry& entry):
+			std::istream(nullptr),
+			_buf(pArchive, entry)
+		{
+			rdbuf(&_buf);
+		}
+
+	private:
+		ArchiveStreamBuf _buf;
+	};
+}
+
+
+const Poco::UInt32 HourArchive::MAGIC = 0x31415841; // "AXA1"
+const std::string HourArchive::SUFFIX(".archive");
+
+
+HourArchive::HourArchive(const std::string& path):
+	_path(path),
+	_fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC))
+{
+	if (_fd < 0)
+	{
+		if (errno == ENOENT) throw Poco::FileNotFoundException(path);
+		throw Poco::OpenFileException(path, Poco::Error::getMessage(errno));
+	}
+	try
+	{
+		readIndex();
+	}
+	catch (...)
+	{
+		::close(_fd);
+		throw;
+	}
+}
+
+
+HourArchive::~HourArchive()
+{
+	::close(_fd);
+}
+
+
+bool HourArchive::find(const std::string& name, Entry& entry) const
+{
+	auto it = _entries.find(name);
+	if (it == _entries.end()) return false;
+
+	entry = it->second;
+	return true;
+}
+
+
+std::size_t HourArchive::read(const Entry& entry, Poco::UInt64 position, char* buffer, std::size_t length) const
+{
+	if (position >= entry.size) return 0;
+	if (length > entry.size - position) length = static_cast<std::size_t>(entry.size - position);
+
+	while (true)
+	{
+		ssize_t n = ::pread(_fd, buffer, length, static_cast<off_t>(entry.offset + position));
+		if (n > 0) return static_cast<std::size_t>(n);
+		if (n < 0 && errno == EINTR) continue;
+		if (n == 0) throw Poco::ReadFileException(_path, "Unexpected end of archive"s);
+		throw Poco::ReadFileException(_path, Poco::Error::getMessage(errno));
+	}
+}
+
+
+std::unique_ptr<std::istream> HourArchive::open(const Ptr& pArchive, const std::string& name, Poco::UInt64& size)
+{
+	Entry entry;
+	if (!pArchive->find(name, entry)) return nullptr;
+
+	size = entry.size;
+	return std::make_unique<ArchiveInputStream>(pArchive, entry);
+}
+
+
+void HourArchive::readIndex()
+{
+	struct stat st;
+	if (::fstat(_fd, &st) != 0)
+	{
+		throw Poco::ReadFileException(_path, Poco::Error::getMessage(errno));
+	}
+	const Poco::UInt64 fileSize = static_cast<Poco::UInt64>(st.st_size);
+	if (fileSize < sizeof(Trailer)) throw Poco::DataFormatException("Archive too short"s, _path);
+
+	Trailer trailer;
+	readAll(reinterpret_cast<char*>(&trailer), sizeof(trailer), fileSize - sizeof(trailer));
+	if (trailer.magic != MAGIC
+		|| trailer.indexLength > MAX_INDEX_LENGTH
+		|| trailer.indexOffset + trailer.indexLength + sizeof(trailer) != fileSize)
+	{
+		throw Poco::DataFormatException("Invalid archive trailer"s, _path);
+	}
+
+	std::vector<char> index(static_cast<std::size_t>(trailer.indexLength));
+	readAll(index.data(), index.size(), trailer.indexOffset);
+
+	Poco::Checksum checksum(Poco::Checksum::TYPE_CRC32);
+	checksum.update(index.data(), static_cast<unsigned>(index.size()));
+	if (checksum.checksum() != trailer.checksum)
+	{
+		throw Poco::DataFormatException("Archive index checksum mismatch"s, _path);
+	}
+
+	std::size_t pos = 0;
+	for (Poco::UInt32 i = 0; i < trailer.count; i++)
+	{
+		IndexEntry record;
+		if (index.size() - pos < sizeof(record)) throw Poco::DataFormatException("Truncated archive index"s, _path);
+		std::memcpy(&record, index.data() + pos, sizeof(record));
+		pos += sizeof(record);
+
+		if (record.nameLength == 0
+			|| record.nameLength > MAX_NAME_LENGTH
+			|| index.size() - pos < record.nameLength
+			|| record.offset > trailer.indexOffset
+			|| record.size > trailer.indexOffset - record.offset)
+		{
+			throw Poco::DataFormatException("Invalid archive index entry"s, _path);
+		}
+		Entry& entry = _entries[std::string(index.data() + pos, record.nameLength)];
+		entry.offset = record.offset;
+		entry.size = record.size;
+		pos += record.nameLength;
+	}
+}
+
+
+void HourArchive::readAll(char* buffer, std::size_t length, Poco::UInt64 offset) const
+{
+	while (length > 0)
+	{
+		ssize_t n = ::pread(_fd, buffer, length, static_cast<off_t>(offset));
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			throw Poco::ReadFileException(_path, Poco::Error::getMessage(errno));
+		}
+		if (n == 0) throw Poco::DataFormatException("Unexpected end of archive"s, _path);
+		buffer += n;
+		length -= static_cast<std::size_t>(n);
+		offset += static_cast<Poco::UInt64>(n);
+	}
+}
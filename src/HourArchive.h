@@ -0,0 +1,129 @@
+//
+// HourArchive.h
+//
+// Definition of the HourArchive class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef HourArchive_INCLUDED
+#define HourArchive_INCLUDED
+
+
+#include "Poco/Types.h"
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+
+
+class HourArchive
+	/// HourArchive gives read access to an archive file holding
+	/// the images of a complete hour directory, as written by
+	/// ArchiveWriter.
+	///
+	/// An archive consists of the image data, followed by an index
+	/// (name, offset and size of every image) and a fixed-size
+	/// trailer locating the index. The index is read when the archive
+	/// is opened. Image data is read with pread(), so that any number
+	/// of threads can read from the same archive at the same time.
+{
+public:
+	using Ptr = std::shared_ptr<HourArchive>;
+
+	struct Entry
+	{
+		Poco::UInt64 offset = 0;
+		Poco::UInt64 size = 0;
+	};
+
+	using Entries = std::map<std::string, Entry>;
+
+	struct IndexEntry
+		/// Index record, followed by nameLength bytes of name.
+	{
+		Poco::UInt64 offset;
+		Poco::UInt64 size;
+		Poco::UInt32 nameLength;
+		Poco::UInt32 reserved;
+	};
+
+	struct Trailer
+		/// The last bytes of an archive. checksum is the
+		/// CRC-32 of the index.
+	{
+		Poco::UInt32 magic;
+		Poco::UInt32 checksum;
+		Poco::UInt32 count;
+		Poco::UInt32 reserved;
+		Poco::UInt64 indexOffset;
+		Poco::UInt64 indexLength;
+	};
+
+	static const Poco::UInt32 MAGIC;
+	static const std::string SUFFIX;
+		/// The archive of an hour directory is a file next to it,
+		/// named like the directory, with this suffix (".archive").
+
+	explicit HourArchive(const std::string& path);
+		/// Opens the archive at the given path and reads its index.
+		///
+		/// Throws a Poco::FileNotFoundException if no archive exists
+		/// at path, or a Poco::DataFormatException if the file is not
+		/// a complete archive.
+
+	~HourArchive();
+		/// Closes the archive.
+
+	const std::string& path() const;
+		/// Returns the path of the archive.
+
+	const Entries& entries() const;
+		/// Returns the index of the archive.
+
+	bool find(const std::string& name, Entry& entry) const;
+		/// Looks up the image with the given name.
+		/// Returns false if the archive has no such image.
+
+	std::size_t read(const Entry& entry, Poco::UInt64 position, char* buffer, std::size_t length) const;
+		/// Reads up to length bytes of the given image, starting at
+		/// position within the image. Returns the number of bytes
+		/// read, which is 0 only at the end of the image.
+
+	static std::unique_ptr<std::istream> open(const Ptr& pArchive, const std::string& name, Poco::UInt64& size);
+		/// Opens the image with the given name for reading and stores
+		/// its size in size. The stream keeps the archive open.
+		///
+		/// Returns a null pointer if the archive has no such image.
+
+protected:
+	void readIndex();
+	void readAll(char* buffer, std::size_t length, Poco::UInt64 offset) const;
+
+private:
+	std::string _path;
+	int _fd;
+	Entries _entries;
+
+	HourArchive(const HourArchive&) = delete;
+	HourArchive& operator = (const HourArchive&) = delete;
+};
+
+
+//
+// inlines
+//
+inline const std::string& HourArchive::path() const
+{
+	return _path;
+}
+
+
+inline const HourArchive::Entries& HourArchive::entries() const
+{
+	return _entries;
+}
+
+
+#endif // HourArchive_INCLUDED
@@ -0,0 +1,167 @@
+//
+// ImageIndex.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ImageIndex.h"
+#include "ImageKey.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/LocalDateTime.h"
+#include "Poco/DateTime.h"
+#include "Poco/Ascii.h"
+#include <algorithm>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	bool parseDigits(const std::string& s, std::size_t pos, std::size_t n, int& value)
+	{
+		value = 0;
+		for (std::size_t i = pos; i < pos + n; i++)
+		{
+			if (!Poco::Ascii::isDigit(s[i])) return false;
+			value = value*10 + (s[i] - '0');
+		}
+		return true;
+	}
+
+	bool earlier(const ImageIndex::Entry& entry, ImageIndex::Time time)
+	{
+		return entry.time < time;
+	}
+}
+
+
+ImageIndex::ImageIndex(const CameraRegistry& registry, Poco::Timespan retention):
+	_registry(registry),
+	_retention(retention),
+	_created(now()),
+	_cameras(new Camera[registry.capacity()])
+{
+	for (std::size_t id = 0; id < registry.capacity(); id++)
+	{
+		_cameras[id].since = _created;
+	}
+}
+
+
+ImageIndex::~ImageIndex()
+{
+}
+
+
+void ImageIndex::add(CameraRegistry::CameraId id, const std::string& key, Poco::UInt64 size)
+{
+	if (id == CameraRegistry::INVALID_ID || id >= _registry.capacity()) return;
+
+	Entry entry;
+	if (!parseName(ImageKey::fileName(key), entry.time)) return;
+	entry.size = size;
+
+	Camera& camera = _cameras[id];
+	Poco::FastMutex::ScopedLock lock(camera.mutex);
+
+	// Replicated images may arrive late; images from before
+	// since are on the storage volume, but not in the index.
+	if (entry.time < camera.since) return;
+
+	// Allocated on first use, as most cameras in
+	// the registry's capacity are never used.
+	if (!camera.pEntries) camera.pEntries.reset(new std::deque<Entry>);
+	std::deque<Entry>& entries = *camera.pEntries;
+
+	if (entries.empty() || entries.back().time <= entry.time)
+	{
+		entries.push_back(entry);
+	}
+	else
+	{
+		auto it = std::upper_bound(entries.begin(), entries.end(), entry.time, [](Time time, const Entry& e)
+			{
+				return time < e.time;
+			});
+		entries.insert(it, entry);
+	}
+	_size++;
+
+	const Time oldest = entries.back().time - _retention.totalMicroseconds();
+	while (entries.front().time < oldest)
+	{
+		camera.since = entries.front().time + 1;
+		entries.pop_front();
+		_size--;
+	}
+}
+
+
+std::size_t ImageIndex::find(CameraRegistry::CameraId id, Time from, Time to, std::size_t limit, std::vector<Entry>& entries) const
+{
+	if (id == CameraRegistry::INVALID_ID || id >= _registry.capacity()) return 0;
+
+	const Camera& camera = _cameras[id];
+	Poco::FastMutex::ScopedLock lock(camera.mutex);
+
+	if (!camera.pEntries) return 0;
+	const std::deque<Entry>& cameraEntries = *camera.pEntries;
+	std::size_t n = 0;
+	for (auto it = std::lower_bound(cameraEntries.begin(), cameraEntries.end(), from, earlier); it != cameraEntries.end() && it->time < to && n < limit; ++it)
+	{
+		entries.push_back(*it);
+		n++;
+	}
+	return n;
+}
+
+
+ImageIndex::Time ImageIndex::since(CameraRegistry::CameraId id) const
+{
+	if (id == CameraRegistry::INVALID_ID || id >= _registry.capacity()) return _created;
+
+	const Camera& camera = _cameras[id];
+	Poco::FastMutex::ScopedLock lock(camera.mutex);
+	return camera.since;
+}
+
+
+std::size_t ImageIndex::size() const
+{
+	return _size;
+}
+
+
+bool ImageIndex::parseName(const std::string& name, Time& time)
+{
+	// YYYYMMDD-HHMMSS-ffffff.jpg
+	if (name.size() != 26 || name[8] != '-' || name[15] != '-' || name.compare(22, 4, ".jpg") != 0) return false;
+
+	int year, month, day, hour, minute, second, fraction;
+	if (!parseDigits(name, 0, 4, year) || !parseDigits(name, 4, 2, month) || !parseDigits(name, 6, 2, day)) return false;
+	if (!parseDigits(name, 9, 2, hour) || !parseDigits(name, 11, 2, minute) || !parseDigits(name, 13, 2, second)) return false;
+	if (!parseDigits(name, 16, 6, fraction)) return false;
+	if (!Poco::DateTime::isValid(year, month, day, hour, minute, second, fraction/1000, fraction % 1000)) return false;
+
+	time = Poco::DateTime(year, month, day, hour, minute, second, fraction/1000, fraction % 1000).timestamp().epochMicroseconds();
+	return true;
+}
+
+
+std::string ImageIndex::formatKey(const std::string& cameraDirectory, Time time)
+{
+	std::string key;
+	key.reserve(cameraDirectory.size() + 40);
+	key += cameraDirectory;
+	Poco::DateTimeFormatter::append(key, Poco::DateTime(Poco::Timestamp(time)), "%Y/%m/%d/%H/%Y%m%d-%H%M%S-%F.jpg"s);
+	return key;
+}
+
+
+ImageIndex::Time ImageIndex::now()
+{
+	Poco::LocalDateTime local;
+	return Poco::DateTime(local.year(), local.month(), local.day(), local.hour(), local.minute(), local.second(), local.millisecond(), local.microsecond()).timestamp().epochMicroseconds();
+}
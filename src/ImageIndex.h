@@ -0,0 +1,103 @@
+//
+// ImageIndex.h
+//
+// Definition of the ImageIndex class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ImageIndex_INCLUDED
+#define ImageIndex_INCLUDED
+
+
+#include "CameraRegistry.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include "Poco/Types.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class ImageIndex
+	/// ImageIndex keeps an in-memory index of the images stored
+	/// for every camera since the index was created, ordered by
+	/// upload time, so that the images of a camera in a time range
+	/// can be listed without reading directories on the storage
+	/// volume.
+	///
+	/// Times are the wall-clock times in image keys (the local time
+	/// of the server), counted in microseconds as if they were UTC,
+	/// so that they can be compared and subtracted like timestamps.
+	///
+	/// Images are kept for retention, measured back from the latest
+	/// image of the camera. The index of a camera is complete from
+	/// since() on; older images must be found on the storage volume.
+{
+public:
+	using Time = Poco::Int64;
+
+	struct Entry
+	{
+		Time time;
+		Poco::UInt64 size;
+	};
+
+	ImageIndex(const CameraRegistry& registry, Poco::Timespan retention);
+		/// Creates the ImageIndex for the cameras in the given registry.
+
+	~ImageIndex();
+		/// Destroys the ImageIndex.
+
+	void add(CameraRegistry::CameraId id, const std::string& key, Poco::UInt64 size);
+		/// Adds the image with the given key and size to the index
+		/// of the camera with the given ID. Invalid IDs and keys
+		/// are ignored.
+
+	std::size_t find(CameraRegistry::CameraId id, Time from, Time to, std::size_t limit, std::vector<Entry>& entries) const;
+		/// Appends up to limit images of the given camera uploaded in
+		/// [from, to) to entries, in upload order. Returns the number
+		/// of images appended.
+
+	Time since(CameraRegistry::CameraId id) const;
+		/// Returns the time from which the index of the given
+		/// camera is complete.
+
+	std::size_t size() const;
+		/// Returns the number of images in the index.
+
+	static bool parseName(const std::string& name, Time& time);
+		/// Extracts the time from the file name of an image key.
+		/// Returns false if the name is not well-formed.
+
+	static std::string formatKey(const std::string& cameraDirectory, Time time);
+		/// Returns the key of an image uploaded at the given time by
+		/// the camera with the given directory ("<site>/<camera>/").
+
+	static Time now();
+		/// Returns the current wall-clock time.
+
+protected:
+	struct Camera
+	{
+		mutable Poco::FastMutex mutex;
+		std::unique_ptr<std::deque<Entry>> pEntries;
+		Time since = 0;
+	};
+
+private:
+	const CameraRegistry& _registry;
+	const Poco::Timespan _retention;
+	const Time _created;
+	std::unique_ptr<Camera[]> _cameras;
+	std::atomic<std::size_t> _size{0};
+
+	ImageIndex(const ImageIndex&) = delete;
+	ImageIndex& operator = (const ImageIndex&) = delete;
+};
+
+
+#endif // ImageIndex_INCLUDED
@@ -0,0 +1,128 @@
+//
+// ImageKey.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ImageKey.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTime.h"
+#include "Poco/NumberParser.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/Ascii.h"
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	bool isDigits(const std::string& s, std::size_t pos, std::size_t n)
+	{
+		if (pos + n > s.size()) return false;
+		for (std::size_t i = pos; i < pos + n; i++)
+		{
+			if (!Poco::Ascii::isDigit(s[i])) return false;
+		}
+		return true;
+	}
+
+	bool isName(const std::string& s)
+	{
+		return !s.empty() && s != "." && s != ".." && s.find('\\') == std::string::npos;
+	}
+}
+
+
+std::string ImageKey::format(const std::string& site, const std::string& camera, const Poco::LocalDateTime& time)
+{
+	std::string key;
+	key.reserve(site.size() + camera.size() + 41);
+	key += site;
+	key += '/';
+	key += camera;
+	key += '/';
+	Poco::DateTimeFormatter::append(key, time, "%Y/%m/%d/%H/%Y%m%d-%H%M%S-%F.jpg"s);
+	return key;
+}
+
+
+std::string ImageKey::format(const std::string& cameraDirectory, const Poco::LocalDateTime& time)
+{
+	std::string key;
+	key.reserve(cameraDirectory.size() + 40);
+	key += cameraDirectory;
+	Poco::DateTimeFormatter::append(key, time, "%Y/%m/%d/%H/%Y%m%d-%H%M%S-%F.jpg"s);
+	return key;
+}
+
+
+std::string ImageKey::directory(const std::string& key)
+{
+	auto pos = key.rfind('/');
+	if (pos != std::string::npos)
+		return key.substr(0, pos);
+	else
+		return std::string();
+}
+
+
+std::string ImageKey::fileName(const std::string& key)
+{
+	auto pos = key.rfind('/');
+	if (pos != std::string::npos)
+		return key.substr(pos + 1);
+	else
+		return key;
+}
+
+
+std::string ImageKey::site(const std::string& key)
+{
+	return key.substr(0, key.find('/'));
+}
+
+
+std::string ImageKey::camera(const std::string& key)
+{
+	auto pos = key.find('/');
+	if (pos == std::string::npos) return std::string();
+	return key.substr(pos + 1, key.find('/', pos + 1) - pos - 1);
+}
+
+
+bool ImageKey::isValid(const std::string& key)
+{
+	Poco::LocalDateTime hour;
+	if (!parseDirectory(directory(key), hour)) return false;
+
+	// YYYYMMDD-HHMMSS-ffffff.jpg
+	const std::string name = fileName(key);
+	return name.size() == 26
+		&& isDigits(name, 0, 8) && name[8] == '-'
+		&& isDigits(name, 9, 6) && name[15] == '-'
+		&& isDigits(name, 16, 6) && name.compare(22, 4, ".jpg") == 0;
+}
+
+
+bool ImageKey::parseDirectory(const std::string& directory, Poco::LocalDateTime& hour)
+{
+	Poco::StringTokenizer tok(directory, "/"s);
+	if (tok.count() != 6) return false;
+	if (!isName(tok[0]) || !isName(tok[1])) return false;
+	if (tok[2].size() != 4 || !isDigits(tok[2], 0, 4)) return false;
+	for (std::size_t i = 3; i < 6; i++)
+	{
+		if (tok[i].size() != 2 || !isDigits(tok[i], 0, 2)) return false;
+	}
+
+	const int year = Poco::NumberParser::parse(tok[2]);
+	const int month = Poco::NumberParser::parse(tok[3]);
+	const int day = Poco::NumberParser::parse(tok[4]);
+	const int hr = Poco::NumberParser::parse(tok[5]);
+	if (!Poco::DateTime::isValid(year, month, day, hr)) return false;
+
+	hour = Poco::LocalDateTime(year, month, day, hr);
+	return true;
+}
@@ -0,0 +1,63 @@
+//
+// ImageKey.h
+//
+// Definition of the ImageKey class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ImageKey_INCLUDED
+#define ImageKey_INCLUDED
+
+
+#include "Poco/LocalDateTime.h"
+#include <string>
+
+
+class ImageKey
+	/// Helper functions for working with image keys.
+	///
+	/// An image key identifies a stored image. It is also the path
+	/// of the image relative to the root of a storage volume:
+	///
+	///     <site>/<camera>/<YYYY>/<MM>/<DD>/<HH>/<YYYYMMDD>-<HHMMSS>-<ffffff>.jpg
+	///
+	/// The part up to the last slash is the hour directory of the image.
+{
+public:
+	static std::string format(const std::string& site, const std::string& camera, const Poco::LocalDateTime& time);
+		/// Returns the key of an image from the given site and camera,
+		/// uploaded at the given time.
+
+	static std::string format(const std::string& cameraDirectory, const Poco::LocalDateTime& time);
+		/// Returns the key of an image uploaded at the given time by
+		/// the camera with the given directory ("<site>/<camera>/").
+
+	static std::string directory(const std::string& key);
+		/// Returns the hour directory part of the given key.
+
+	static std::string fileName(const std::string& key);
+		/// Returns the file name part of the given key.
+
+	static std::string site(const std::string& key);
+		/// Returns the site part of the given key.
+
+	static std::string camera(const std::string& key);
+		/// Returns the camera part of the given key.
+
+	static bool isValid(const std::string& key);
+		/// Returns true if the given string is a well-formed image key.
+		/// Keys received from clients must be checked with isValid()
+		/// before being used to access storage.
+
+	static bool parseDirectory(const std::string& directory, Poco::LocalDateTime& hour);
+		/// Extracts the start of the hour from a hour directory.
+		/// Returns false if the directory is not well-formed.
+
+private:
+	ImageKey() = delete;
+};
+
+
+#endif // ImageKey_INCLUDED
@@ -0,0 +1,270 @@
+//
+// ImageListRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ImageListRequestHandler.h"
+#include "ImageUploadRequestHandler.h"
+#include "ImageKey.h"
+#include "Poco/Net/HTMLForm.h"
+#include "Poco/Util/Application.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeParser.h"
+#include "Poco/DateTime.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/Exception.h"
+#include "Poco/URI.h"
+#include <algorithm>
+#include <vector>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const ImageIndex::Time HOUR = Poco::Timespan::HOURS;
+	const std::size_t BATCH_SIZE = 1024;
+}
+
+
+const std::string ImageListRequestHandler::SUFFIX("list");
+const std::size_t ImageListRequestHandler::DEFAULT_LIMIT(1000);
+const std::size_t ImageListRequestHandler::MAX_LIMIT(100000);
+const int ImageListRequestHandler::MAX_SCAN_HOURS(7*24);
+
+
+ImageListRequestHandler::ImageListRequestHandler(ImageStore& store, const CameraRegistry* pRegistry, const ImageIndex* pIndex):
+	_store(store),
+	_pRegistry(pRegistry),
+	_pIndex(pIndex)
+{
+}
+
+
+ImageListRequestHandler::~ImageListRequestHandler()
+{
+}
+
+
+void ImageListRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	auto& app = Poco::Util::Application::instance();
+
+	if (!ImageUploadRequestHandler::authorize(request, app.config().getString("upload.token"s, ""s)))
+	{
+		app.logger().warning("Invalid or missing token for request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing or invalid upload token"s);
+	}
+
+	const Poco::URI uri(request.getURI());
+	Poco::StringTokenizer tok(uri.getPath(), "/"s, Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	const std::string& site = tok[0];
+	const std::string& camera = tok[1];
+	const std::string cameraDirectory = site + '/' + camera + '/';
+	if (!ImageKey::isValid(ImageIndex::formatKey(cameraDirectory, ImageIndex::now())))
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Invalid site or camera"s);
+	}
+
+	Poco::Net::HTMLForm params;
+	params.read(uri.getRawQuery());
+	ImageIndex::Time from;
+	ImageIndex::Time to;
+	std::size_t limit;
+	try
+	{
+		from = parseTime(params.get("from"s));
+		to = params.has("to"s) ? parseTime(params.get("to"s)) : ImageIndex::now() + 1;
+		limit = Poco::NumberParser::parseUnsigned(params.get("limit"s, Poco::NumberFormatter::format(DEFAULT_LIMIT)));
+		if (params.has("after"s))
+		{
+			ImageIndex::Time after;
+			if (!ImageIndex::parseName(params.get("after"s), after)) throw Poco::SyntaxException(params.get("after"s));
+			from = std::max(from, after + 1);
+		}
+	}
+	catch (Poco::NotFoundException& exc)
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing parameter: "s + exc.message());
+	}
+	catch (Poco::SyntaxException& exc)
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Invalid parameter: "s + exc.message());
+	}
+	if (limit == 0 || limit > MAX_LIMIT)
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Invalid limit"s);
+	}
+
+	// The index of a camera is complete from since on.
+	// Images before that are listed from the store.
+	CameraRegistry::CameraId id = CameraRegistry::INVALID_ID;
+	ImageIndex::Time since = to;
+	if (_pRegistry && _pIndex)
+	{
+		id = _pRegistry->find(site, camera);
+		if (id != CameraRegistry::INVALID_ID)
+		{
+			since = std::max(from, _pIndex->since(id));
+		}
+	}
+
+	response.set("Cache-Control"s, "no-cache"s);
+	response.setContentType("application/json"s);
+	response.setChunkedTransferEncoding(true);
+	Writer writer(response.send(), limit);
+	if (from < since && !listStore(writer, cameraDirectory, from, std::min(since, to)))
+	{
+		return writer.close();
+	}
+	if (since < to)
+	{
+		listIndex(writer, id, cameraDirectory, since, to);
+	}
+	writer.close();
+}
+
+
+bool ImageListRequestHandler::matches(const std::string& path)
+{
+	// /<site>/<camera>/list
+	Poco::StringTokenizer tok(path, "/"s, Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	return tok.count() == 3 && tok[2] == SUFFIX;
+}
+
+
+bool ImageListRequestHandler::listStore(Writer& writer, const std::string& cameraDirectory, ImageIndex::Time from, ImageIndex::Time to)
+{
+	std::vector<std::string> names;
+	int scanned = 0;
+	for (ImageIndex::Time hour = from - from % HOUR; hour < to; hour += HOUR)
+	{
+		// Bound the work per request; sparse or far-reaching
+		// ranges are continued on the next page.
+		if (scanned++ == MAX_SCAN_HOURS)
+		{
+			writer.resumeAt(hour);
+			return false;
+		}
+
+		const std::string directory = ImageKey::directory(ImageIndex::formatKey(cameraDirectory, hour));
+		names.clear();
+		_store.list(directory, names);
+		std::sort(names.begin(), names.end());
+		names.erase(std::unique(names.begin(), names.end()), names.end());
+
+		for (const auto& name: names)
+		{
+			ImageIndex::Time time;
+			if (!ImageIndex::parseName(name, time) || time < from) continue;
+			if (time >= to) break;
+			if (!writer.add(directory + '/' + name, time, 0, false)) return false;
+		}
+	}
+	return true;
+}
+
+
+bool ImageListRequestHandler::listIndex(Writer& writer, CameraRegistry::CameraId id, const std::string& cameraDirectory, ImageIndex::Time from, ImageIndex::Time to)
+{
+	// Copy the index in batches, so that the camera's index
+	// is not locked while the response is sent.
+	std::vector<ImageIndex::Entry> entries;
+	entries.reserve(BATCH_SIZE);
+	for (;;)
+	{
+		entries.clear();
+		_pIndex->find(id, from, to, BATCH_SIZE, entries);
+		for (const auto& entry: entries)
+		{
+			if (!writer.add(ImageIndex::formatKey(cameraDirectory, entry.time), entry.time, entry.size, true)) return false;
+		}
+		if (entries.size() < BATCH_SIZE) return true;
+		from = entries.back().time + 1;
+	}
+}
+
+
+ImageIndex::Time ImageListRequestHandler::parseTime(const std::string& time)
+{
+	Poco::DateTime dateTime;
+	int tzd;
+	if (!Poco::DateTimeParser::tryParse("%Y-%m-%dT%H:%M:%S"s, time, dateTime, tzd))
+	{
+		throw Poco::SyntaxException(time);
+	}
+	// Image keys use the local time of the server,
+	// so the time is taken as is, like in the keys.
+	return dateTime.timestamp().epochMicroseconds();
+}
+
+
+std::string ImageListRequestHandler::formatTime(ImageIndex::Time time)
+{
+	return Poco::DateTimeFormatter::format(Poco::DateTime(Poco::Timestamp(time)), "%Y-%m-%dT%H:%M:%S.%F"s);
+}
+
+
+ImageListRequestHandler::Writer::Writer(std::ostream& ostr, std::size_t limit):
+	_handler(ostr),
+	_limit(limit)
+{
+	_handler.startObject();
+	_handler.key("images"s);
+	_handler.startArray();
+}
+
+
+ImageListRequestHandler::Writer::~Writer()
+{
+}
+
+
+bool ImageListRequestHandler::Writer::add(const std::string& key, ImageIndex::Time time, Poco::UInt64 size, bool hasSize)
+{
+	if (_count == _limit)
+	{
+		_full = true;
+		return false;
+	}
+
+	_handler.startObject();
+	_handler.key("key"s);
+	_handler.value(key);
+	_handler.key("time"s);
+	_handler.value(formatTime(time));
+	if (hasSize)
+	{
+		_handler.key("size"s);
+		_handler.value(size);
+	}
+	_handler.endObject();
+	_last = ImageKey::fileName(key);
+	_count++;
+	return true;
+}
+
+
+void ImageListRequestHandler::Writer::resumeAt(ImageIndex::Time time)
+{
+	// after takes the file name of the last image listed
+	_last = ImageKey::fileName(ImageIndex::formatKey(std::string(), time - 1));
+	_full = true;
+}
+
+
+void ImageListRequestHandler::Writer::close()
+{
+	_handler.endArray();
+	_handler.key("next"s);
+	if (_full)
+		_handler.value(_last);
+	else
+		_handler.null();
+	_handler.endObject();
+}
@@ -0,0 +1,107 @@
+//
+// ImageListRequestHandler.h
+//
+// Definition of the ImageListRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ImageListRequestHandler_INCLUDED
+#define ImageListRequestHandler_INCLUDED
+
+
+#include "ImageStore.h"
+#include "ImageIndex.h"
+#include "CameraRegistry.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/JSON/PrintHandler.h"
+#include <string>
+
+
+class ImageListRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Lists the images of a camera uploaded in a time range:
+	///
+	///   GET /<site>/<camera>/list?from=...&to=...&limit=...&after=...
+	///
+	/// Times are local times in the format YYYY-MM-DDTHH:MM:SS; to
+	/// defaults to the current time. At most limit images are listed
+	/// (default 1000). If there may be more, the response contains the
+	/// file name of the last image listed as next, to be passed as after
+	/// to get the next page:
+	///
+	///   {"images": [{"key": "...", "time": "...", "size": 12345}, ...], "next": "..."}
+	///
+	/// Images from the time covered by the ImageIndex are taken from
+	/// the index, older images by listing the hour directories in the
+	/// store; the size of the latter is not given. At most
+	/// MAX_SCAN_HOURS hour directories are listed per request; if the
+	/// range extends beyond them, next continues after the last hour
+	/// listed, even if the page is not full. Cameras without an index
+	/// (e.g., if the CameraRegistry is full) are listed from the store. The response is
+	/// written while images are looked up, with chunked transfer
+	/// encoding, so large pages are not held in memory.
+{
+public:
+	ImageListRequestHandler(ImageStore& store, const CameraRegistry* pRegistry, const ImageIndex* pIndex);
+		/// Creates the ImageListRequestHandler. Without a CameraRegistry
+		/// and ImageIndex, all images are listed from the store.
+
+	~ImageListRequestHandler();
+		/// Destroys the ImageListRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+	static bool matches(const std::string& path);
+		/// Returns true if the given request path refers
+		/// to the image list of a camera.
+
+	static const std::string SUFFIX;
+		/// The last segment of an image list path ("list").
+
+	static const std::size_t DEFAULT_LIMIT;
+	static const std::size_t MAX_LIMIT;
+	static const int MAX_SCAN_HOURS;
+
+protected:
+	class Writer
+		/// Writes the images of a page as JSON.
+	{
+	public:
+		Writer(std::ostream& ostr, std::size_t limit);
+		~Writer();
+
+		bool add(const std::string& key, ImageIndex::Time time, Poco::UInt64 size, bool hasSize);
+			/// Writes the given image. Returns false, without writing
+			/// the image, if the page is full.
+
+		void resumeAt(ImageIndex::Time time);
+			/// Ends the page before the range has been listed,
+			/// so that the next page starts at the given time.
+
+		void close();
+			/// Ends the page.
+
+	private:
+		Poco::JSON::PrintHandler _handler;
+		const std::size_t _limit;
+		std::size_t _count = 0;
+		std::string _last;
+		bool _full = false;
+	};
+
+	bool listStore(Writer& writer, const std::string& cameraDirectory, ImageIndex::Time from, ImageIndex::Time to);
+	bool listIndex(Writer& writer, CameraRegistry::CameraId id, const std::string& cameraDirectory, ImageIndex::Time from, ImageIndex::Time to);
+	static ImageIndex::Time parseTime(const std::string& time);
+	static std::string formatTime(ImageIndex::Time time);
+
+private:
+	ImageStore& _store;
+	const CameraRegistry* _pRegistry;
+	const ImageIndex* _pIndex;
+};
+
+
+#endif // ImageListRequestHandler_INCLUDED
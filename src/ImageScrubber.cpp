@@ -0,0 +1,207 @@
+//
+// ImageScrubber.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ImageScrubber.h"
+#include "Crc32c.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include <vector>
+
+
+using namespace std::string_literals;
+
+
+ImageScrubber::ImageScrubber(ImageStore& store, const IntegrityManifest& manifest, Poco::UInt64 bytesPerSecond, Poco::Timespan passInterval):
+	_store(store),
+	_manifest(manifest),
+	_bytesPerSecond(bytesPerSecond),
+	_passInterval(passInterval),
+	_thread("ImageScrubber"s),
+	_logger(Poco::Logger::get("ImageScrubber"s))
+{
+}
+
+
+ImageScrubber::~ImageScrubber()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+void ImageScrubber::start()
+{
+	_stop.reset();
+	_stopped = false;
+	_thread.start(*this);
+	_running = true;
+}
+
+
+void ImageScrubber::stop()
+{
+	if (!_running) return;
+
+	_stop.set();
+	_thread.join();
+	_running = false;
+}
+
+
+void ImageScrubber::run()
+{
+	do
+	{
+		_passStart.update();
+		_passBytes = 0;
+		const Poco::UInt64 verified = _verified;
+		const Poco::UInt64 corrupted = _corrupted;
+		const Poco::UInt64 missing = _missing;
+		try
+		{
+			scrubDirectory(std::string());
+		}
+		catch (Poco::Exception& exc)
+		{
+			_logger.log(exc);
+		}
+		if (_stopped) return;
+
+		_logger.information("Scrubbing pass completed in %d seconds: %Lu images verified, %Lu corrupted, %Lu missing."s,
+			static_cast<int>(_passStart.elapsed()/Poco::Timespan::SECONDS),
+			_verified - verified,
+			_corrupted - corrupted,
+			_missing - missing);
+	}
+	while (!_stop.tryWait(static_cast<long>(_passInterval.totalMilliseconds())));
+}
+
+
+void ImageScrubber::scrubDirectory(const std::string& directory)
+{
+	Poco::File dir(_manifest.root() + directory);
+	if (!dir.exists()) return;
+
+	// Collect the entries first, so that no directory handle
+	// is held open while throttling.
+	std::vector<std::string> directories;
+	std::vector<std::string> manifests;
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(dir); it != end; ++it)
+	{
+		const std::string& name = it.name();
+		if (it->isDirectory())
+		{
+			directories.push_back(directory + name + '/');
+		}
+		else if (name.size() > IntegrityManifest::SUFFIX.size() && name.compare(name.size() - IntegrityManifest::SUFFIX.size(), IntegrityManifest::SUFFIX.size(), IntegrityManifest::SUFFIX) == 0)
+		{
+			manifests.push_back(directory + name.substr(0, name.size() - IntegrityManifest::SUFFIX.size()));
+		}
+	}
+
+	for (const auto& manifest: manifests)
+	{
+		if (_stopped) return;
+		scrubManifest(manifest);
+	}
+	for (const auto& subdirectory: directories)
+	{
+		if (_stopped) return;
+		scrubDirectory(subdirectory);
+	}
+}
+
+
+void ImageScrubber::scrubManifest(const std::string& directory)
+{
+	IntegrityManifest::Entries entries;
+	try
+	{
+		IntegrityManifest::read(_manifest.path(directory), entries);
+	}
+	catch (Poco::Exception& exc)
+	{
+		_logger.error("Failed to read manifest %s: %s"s, _manifest.path(directory), exc.displayText());
+		return;
+	}
+	for (const auto& entry: entries)
+	{
+		if (_stopped) return;
+
+		try
+		{
+			verify(directory + '/' + entry.first, entry.second);
+		}
+		catch (Poco::Exception& exc)
+		{
+			_logger.error("Failed to verify %s/%s: %s"s, directory, entry.first, exc.displayText());
+		}
+	}
+}
+
+
+void ImageScrubber::verify(const std::string& key, const IntegrityManifest::Entry& entry)
+{
+	Poco::UInt64 size = 0;
+	auto pStream = _store.open(key, size);
+	if (!pStream)
+	{
+		_missing++;
+		_logger.warning("Image %s listed in manifest not found."s, key);
+		return;
+	}
+
+	Crc32c crc;
+	Poco::UInt64 total = 0;
+	std::vector<char> buffer(65536);
+	while (pStream->good())
+	{
+		pStream->read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		const std::size_t n = static_cast<std::size_t>(pStream->gcount());
+		crc.update(buffer.data(), n);
+		total += n;
+		if (throttle(n)) return;
+	}
+	if (pStream->bad()) throw Poco::ReadFileException(key);
+
+	_verified++;
+	if (total != entry.size || crc.checksum() != entry.checksum)
+	{
+		_corrupted++;
+		_logger.error("Image %s is corrupted: %Lu bytes with checksum %08x, expected %Lu bytes with checksum %08x."s,
+			key, total, crc.checksum(), entry.size, entry.checksum);
+	}
+}
+
+
+bool ImageScrubber::throttle(Poco::UInt64 bytes)
+{
+	_passBytes += bytes;
+	if (_bytesPerSecond > 0)
+	{
+		// Wait until reading the bytes so far would have
+		// taken the time allowed for them.
+		const Poco::Timestamp::TimeDiff due = static_cast<Poco::Timestamp::TimeDiff>(_passBytes*1000000.0/_bytesPerSecond);
+		const Poco::Timestamp::TimeDiff ahead = due - _passStart.elapsed();
+		if (ahead >= 1000 && _stop.tryWait(static_cast<long>(ahead/1000)))
+		{
+			_stopped = true;
+		}
+	}
+	else if (_stop.tryWait(0))
+	{
+		_stopped = true;
+	}
+	return _stopped;
+}
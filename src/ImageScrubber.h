@@ -0,0 +1,106 @@
+//
+// ImageScrubber.h
+//
+// Definition of the ImageScrubber class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ImageScrubber_INCLUDED
+#define ImageScrubber_INCLUDED
+
+
+#include "ImageStore.h"
+#include "IntegrityManifest.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Logger.h"
+#include <atomic>
+
+
+class ImageScrubber: public Poco::Runnable
+	/// ImageScrubber verifies stored images against the checksums
+	/// recorded in their IntegrityManifest, to detect bit rot.
+	///
+	/// A background thread reads all manifests and the images listed
+	/// in them, reading at most bytesPerSecond bytes of image data
+	/// per second (unless 0), so that scrubbing does not compete
+	/// with uploads.
+	/// Corrupted images are logged as errors, missing images as
+	/// warnings. A new pass starts passInterval after the previous
+	/// pass has completed.
+{
+public:
+	ImageScrubber(ImageStore& store, const IntegrityManifest& manifest, Poco::UInt64 bytesPerSecond, Poco::Timespan passInterval);
+		/// Creates the ImageScrubber.
+
+	~ImageScrubber();
+		/// Destroys the ImageScrubber, stopping it if necessary.
+
+	void start();
+		/// Starts scrubbing.
+
+	void stop();
+		/// Stops scrubbing. A pass in progress is interrupted.
+
+	Poco::UInt64 verified() const;
+		/// Returns the number of images verified.
+
+	Poco::UInt64 corrupted() const;
+		/// Returns the number of corrupted images found.
+
+	Poco::UInt64 missing() const;
+		/// Returns the number of images listed in a manifest,
+		/// but not found in the store.
+
+protected:
+	void run();
+	void scrubDirectory(const std::string& directory);
+	void scrubManifest(const std::string& directory);
+	void verify(const std::string& key, const IntegrityManifest::Entry& entry);
+	bool throttle(Poco::UInt64 bytes);
+
+private:
+	ImageStore& _store;
+	const IntegrityManifest& _manifest;
+	const Poco::UInt64 _bytesPerSecond;
+	const Poco::Timespan _passInterval;
+	Poco::Timestamp _passStart;
+	Poco::UInt64 _passBytes = 0;
+	std::atomic<Poco::UInt64> _verified{0};
+	std::atomic<Poco::UInt64> _corrupted{0};
+	std::atomic<Poco::UInt64> _missing{0};
+	Poco::Thread _thread;
+	Poco::Event _stop;
+	bool _running = false;
+	bool _stopped = false;
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline Poco::UInt64 ImageScrubber::verified() const
+{
+	return _verified.load(std::memory_order_relaxed);
+}
+
+
+inline Poco::UInt64 ImageScrubber::corrupted() const
+{
+	return _corrupted.load(std::memory_order_relaxed);
+}
+
+
+inline Poco::UInt64 ImageScrubber::missing() const
+{
+	return _missing.load(std::memory_order_relaxed);
+}
+
+
+#endif // ImageScrubber_INCLUDED
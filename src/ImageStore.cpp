@@ -0,0 +1,45 @@
+//
+// ImageStore.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ImageStore.h"
+
+
+ImageStore::ImageStore()
+{
+}
+
+
+ImageStore::~ImageStore()
+{
+}
+
+
+bool ImageStore::exists(const std::string& key)
+{
+	Poco::UInt64 size;
+	return open(key, size) != nullptr;
+}
+
+
+void ImageStore::list(const std::string& directory, std::vector<std::string>& names)
+{
+}
+
+
+void ImageStore::sync()
+{
+}
+
+
+void ImageStore::start()
+{
+}
+
+
+void ImageStore::stop()
+{
+}
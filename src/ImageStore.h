@@ -0,0 +1,85 @@
+//
+// ImageStore.h
+//
+// Definition of the ImageStore class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ImageStore_INCLUDED
+#define ImageStore_INCLUDED
+
+
+#include "Poco/SharedPtr.h"
+#include "Poco/Types.h"
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class ImageStore
+	/// ImageStore is the interface for storage backends
+	/// holding uploaded images.
+	///
+	/// Images are identified by their key (see ImageKey).
+{
+public:
+	using Ptr = Poco::SharedPtr<ImageStore>;
+
+	ImageStore();
+		/// Creates the ImageStore.
+
+	virtual ~ImageStore();
+		/// Destroys the ImageStore.
+
+	virtual std::string store(const std::string& key, std::istream& istr) = 0;
+		/// Stores the image data read from istr under the given key.
+		/// Returns a description of the location the image has
+		/// been stored at, suitable for logging.
+
+	virtual std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size) = 0;
+		/// Opens the image with the given key for reading and
+		/// stores its size in size.
+		///
+		/// Returns a null pointer if no such image exists.
+
+	virtual bool exists(const std::string& key);
+		/// Returns true if an image with the given key exists.
+		///
+		/// The default implementation uses open().
+
+	virtual void list(const std::string& directory, std::vector<std::string>& names);
+		/// Appends the file names of the images in the given hour
+		/// directory to names, in no particular order. An image
+		/// may be listed more than once.
+		///
+		/// The default implementation does nothing, for stores
+		/// that cannot list their images.
+
+	virtual void sync();
+		/// Makes all images stored so far durable, so that they
+		/// survive a crash or power loss. Throws a Poco::Exception
+		/// if that fails.
+		///
+		/// The default implementation does nothing, for stores
+		/// whose images are durable once store() has returned.
+
+	virtual void start();
+		/// Starts background activities of the store.
+		///
+		/// The default implementation does nothing.
+
+	virtual void stop();
+		/// Stops background activities of the store.
+		///
+		/// The default implementation does nothing.
+
+private:
+	ImageStore(const ImageStore&) = delete;
+	ImageStore& operator = (const ImageStore&) = delete;
+};
+
+
+#endif // ImageStore_INCLUDED
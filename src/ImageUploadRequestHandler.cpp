@@ -0,0 +1,468 @@
+//
+// ImageUploadRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ImageUploadRequestHandler.h"
+#include "ImageKey.h"
+#include "ReplicatingImageStore.h"
+#include "JpegScanner.h"
+#include "Poco/Net/HTMLForm.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/Util/Application.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/NullStream.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Exception.h"
+#include "Poco/LocalDateTime.h"
+#include "Poco/Path.h"
+#include "Poco/URI.h"
+#include <algorithm>
+#include <vector>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	class ReceiveStreamBuf: public std::streambuf
+		/// Reads from another stream, counting the bytes read and
+		/// measuring the time spent waiting for data from it.
+	{
+	public:
+		explicit ReceiveStreamBuf(std::istream& istr):
+			_istr(istr),
+			_buffer(65536)
+		{
+		}
+
+		Poco::UInt64 size() const
+		{
+			return _size;
+		}
+
+		Poco::Timestamp::TimeDiff receiveTime() const
+		{
+			return _stopwatch.elapsed();
+		}
+
+	protected:
+		int_type underflow() override
+		{
+			if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+			_stopwatch.start();
+			_istr.read(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+			_stopwatch.stop();
+			const std::size_t n = static_cast<std::size_t>(_istr.gcount());
+			if (_istr.bad()) throw Poco::IOException("Error reading image data"s);
+			if (n == 0) return traits_type::eof();
+
+			_size += n;
+			setg(_buffer.data(), _buffer.data(), _buffer.data() + n);
+			return traits_type::to_int_type(*gptr());
+		}
+
+	private:
+		std::istream& _istr;
+		std::vector<char> _buffer;
+		Poco::UInt64 _size = 0;
+		Poco::Stopwatch _stopwatch;
+	};
+}
+
+
+ImageUploadRequestHandler::ImageUploadRequestHandler(ImageStore& store, ImageStore& replicaStore, AdmissionController* pAdmission, StorageScheduler* pScheduler, const std::string& admittedSite, ServerStatistics* pStatistics, CameraRegistry* pRegistry, CameraHealth* pHealth, ImageIndex* pIndex):
+	_store(store),
+	_replicaStore(replicaStore),
+	_pAdmission(pAdmission),
+	_pScheduler(pScheduler),
+	_admittedSite(admittedSite),
+	_pStatistics(pStatistics),
+	_pRegistry(pRegistry),
+	_pHealth(pHealth),
+	_pIndex(pIndex)
+{
+}
+
+
+ImageUploadRequestHandler::~ImageUploadRequestHandler()
+{
+	if (_pAdmission) _pAdmission->leave(_admittedSite);
+}
+
+
+void ImageUploadRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	auto& app = Poco::Util::Application::instance();
+	const auto& config = app.config();
+	ServerStatistics::RequestTimer timer(_pStatistics, request);
+
+	try
+	{
+		if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_POST)
+		{
+			if (authorize(request, config.getString("upload.token"s, ""s)))
+			{
+				if (request.getContentType() == "image/jpeg" && request.has(ReplicatingImageStore::REPLICA_KEY_HEADER))
+				{
+					return storeReplica(request, request.get(ReplicatingImageStore::REPLICA_KEY_HEADER));
+				}
+				else if (request.getContentType() == "image/jpeg")
+				{
+					std::string path;
+					try
+					{
+						path = storeImage(request);
+					}
+					catch (Poco::DataFormatException& exc)
+					{
+						app.logger().warning("%s in request from %s: %s %s"s, exc.message(), request.clientAddress().toString(), request.getMethod(), request.getURI());
+						return sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, exc.message());
+					}
+					app.logger().information("Image stored to '%s'."s, path);
+					return sendResponse(request, Poco::Net::HTTPResponse::HTTP_OK, "Image accepted"s);
+				}
+				else
+				{
+					app.logger().warning("Invalid or missing content type '%s' for request from %s: %s %s"s, request.getContentType(), request.clientAddress().toString(), request.getMethod(), request.getURI());
+					ignoreContent(request);
+					return sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Unexpected content type"s);
+				}
+			}
+			else
+			{
+				app.logger().warning("Invalid or missing token for request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
+				ignoreContent(request);
+				return sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing or invalid upload token"s);
+			}
+		}
+		else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET)
+		{
+			std::string key = imageKey(request);
+			if (!key.empty())
+			{
+				if (authorize(request, config.getString("upload.token"s, ""s)))
+				{
+					return sendImage(request, key);
+				}
+				else
+				{
+					app.logger().warning("Invalid or missing token for request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
+					return sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing or invalid upload token"s);
+				}
+			}
+			return sendResponse(request, Poco::Net::HTTPResponse::HTTP_OK, "Image upload server ready"s);
+		}
+		else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_HEAD)
+		{
+			response.send();
+			return;
+		}
+		else
+		{
+			return sendResponse(request, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Request method not allowed"s);
+		}
+	}
+	catch (Poco::Exception& exc)
+	{
+		app.logger().log(exc);
+		if (!response.sent())
+		{
+			sendResponse(request, Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "error uploading file");
+		}
+	}
+}
+
+
+bool ImageUploadRequestHandler::authorize(const Poco::Net::HTTPServerRequest& request, const std::string& token)
+{
+	Poco::URI uri(request.getURI());
+	Poco::Net::HTMLForm params;
+	params.read(uri.getRawQuery());
+	return params.get("token"s, ""s) == token;
+}
+
+
+std::string ImageUploadRequestHandler::storeImage(Poco::Net::HTTPServerRequest& request)
+{
+	Poco::LocalDateTime now;
+	const Route route = uploadRoute(request);
+	const StorageScheduler::Priority priority = uploadPriority(request, route);
+	const CameraRegistry::CameraId id = _pRegistry ? _pRegistry->id(route.site, route.camera) : CameraRegistry::INVALID_ID;
+	std::string key = id != CameraRegistry::INVALID_ID ? ImageKey::format(_pRegistry->directory(id), now) : ImageKey::format(route.site, route.camera, now);
+
+	std::string path;
+	Poco::UInt64 size = 0;
+	if (Poco::Util::Application::instance().config().getBool("upload.validateJpeg"s, false))
+	{
+		std::string data;
+		receive(request.stream(), data);
+		if (!JpegScanner::isValid(data.data(), data.size())) throw Poco::DataFormatException("Invalid JPEG image"s);
+		path = storeReceived(key, data, _store, priority, route.site);
+		size = data.size();
+	}
+	else
+	{
+		path = storeScheduled(key, request.stream(), _store, priority, route.site, size);
+	}
+	if (_pStatistics) _pStatistics->upload(route.site, size);
+	if (_pHealth) _pHealth->upload(id, size, priority == StorageScheduler::PRIORITY_PERIODIC);
+	if (_pIndex) _pIndex->add(id, key, size);
+	return path;
+}
+
+
+std::string ImageUploadRequestHandler::storeScheduled(const std::string& key, std::istream& istr, ImageStore& store, StorageScheduler::Priority priority, const std::string& site, Poco::UInt64& size)
+{
+	if (_pScheduler)
+	{
+		// Receive the image before taking a storage slot,
+		// so that slow uploads do not hold slots.
+		std::string data;
+		receive(istr, data);
+		size = data.size();
+		return storeReceived(key, data, store, priority, site);
+	}
+	else
+	{
+		// The time spent waiting for the body is not storage
+		// latency, so slow camera uplinks do not trigger admission
+		// control while the storage volume is idle.
+		ReceiveStreamBuf streamBuf(istr);
+		std::istream bodyStream(&streamBuf);
+		Poco::Stopwatch stopwatch;
+		stopwatch.start();
+		std::string path = store.store(key, bodyStream);
+		if (_pAdmission) _pAdmission->sample(std::max<Poco::Timestamp::TimeDiff>(stopwatch.elapsed() - streamBuf.receiveTime(), 0));
+		size = streamBuf.size();
+		return path;
+	}
+}
+
+
+std::string ImageUploadRequestHandler::storeReceived(const std::string& key, const std::string& data, ImageStore& store, StorageScheduler::Priority priority, const std::string& site)
+{
+	Poco::MemoryInputStream dataStream(data.data(), data.size());
+	Poco::Stopwatch stopwatch;
+	stopwatch.start();
+	std::string path;
+	if (_pScheduler)
+	{
+		StorageScheduler::Slot slot(*_pScheduler, priority, site, data.size());
+		path = store.store(key, dataStream);
+	}
+	else
+	{
+		path = store.store(key, dataStream);
+	}
+	if (_pAdmission) _pAdmission->sample(stopwatch.elapsed());
+	return path;
+}
+
+
+void ImageUploadRequestHandler::storeReplica(Poco::Net::HTTPServerRequest& request, const std::string& key)
+{
+	auto& app = Poco::Util::Application::instance();
+
+	if (!ImageKey::isValid(key))
+	{
+		app.logger().warning("Invalid replica key '%s' for request from %s: %s %s"s, key, request.clientAddress().toString(), request.getMethod(), request.getURI());
+		ignoreContent(request);
+		sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Invalid replica key"s);
+	}
+	else if (_replicaStore.exists(key))
+	{
+		app.logger().information("Replica '%s' already stored."s, key);
+		ignoreContent(request);
+		sendResponse(request, Poco::Net::HTTPResponse::HTTP_OK, "Image already stored"s);
+	}
+	else
+	{
+		Poco::UInt64 size = 0;
+		std::string path = storeScheduled(key, request.stream(), _replicaStore, StorageScheduler::PRIORITY_PERIODIC, ImageKey::site(key), size);
+		// The sender drops the image from its outbox when it
+		// is acknowledged, so it must be on stable storage first.
+		_replicaStore.sync();
+		if (_pRegistry && _pIndex) _pIndex->add(_pRegistry->id(ImageKey::site(key), ImageKey::camera(key)), key, size);
+		app.logger().information("Replica stored to '%s'."s, path);
+		sendResponse(request, Poco::Net::HTTPResponse::HTTP_OK, "Image accepted"s);
+	}
+}
+
+
+void ImageUploadRequestHandler::receive(std::istream& istr, std::string& data)
+{
+	const Poco::UInt64 maxSize = Poco::Util::Application::instance().config().getUInt64("upload.maxBufferedSize"s, 16*1024*1024);
+	char buffer[8192];
+	while (istr.good())
+	{
+		istr.read(buffer, sizeof(buffer));
+		const std::size_t n = static_cast<std::size_t>(istr.gcount());
+		if (data.size() + n > maxSize) throw Poco::DataFormatException("Image too large"s);
+		data.append(buffer, n);
+	}
+	// A truncated or failed body must not be stored as a short image.
+	if (istr.bad()) throw Poco::IOException("Error reading image data"s);
+}
+
+
+void ImageUploadRequestHandler::sendImage(Poco::Net::HTTPServerRequest& request, const std::string& key)
+{
+	Poco::UInt64 size = 0;
+	auto pStream = _store.open(key, size);
+	if (pStream)
+	{
+		request.response().setContentType("image/jpeg"s);
+		request.response().setContentLength64(static_cast<Poco::Int64>(size));
+		Poco::StreamCopier::copyStream64(*pStream, request.response().send());
+	}
+	else
+	{
+		sendResponse(request, Poco::Net::HTTPResponse::HTTP_NOT_FOUND, "Image not found"s);
+	}
+}
+
+
+StorageScheduler::Priority ImageUploadRequestHandler::uploadPriority(const Poco::Net::HTTPServerRequest& request)
+{
+	return uploadPriority(request, uploadRoute(request));
+}
+
+
+StorageScheduler::Priority ImageUploadRequestHandler::uploadPriority(const Poco::Net::HTTPServerRequest& request, const Route& route)
+{
+	const auto& config = Poco::Util::Application::instance().config();
+
+	if (request.getURI().find("priority="s) != std::string::npos)
+	{
+		Poco::URI uri(request.getURI());
+		Poco::Net::HTMLForm params;
+		params.read(uri.getRawQuery());
+		const std::string priority = params.get("priority"s, ""s);
+		if (!priority.empty())
+		{
+			try
+			{
+				return StorageScheduler::parsePriority(priority);
+			}
+			catch (Poco::InvalidArgumentException&)
+			{
+			}
+		}
+	}
+
+	if (!route.prefix.empty())
+	{
+		Poco::StringTokenizer prefixes(config.getString("upload.priority.eventPrefixes"s, ""s), ","s, Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+		if (prefixes.has(route.prefix)) return StorageScheduler::PRIORITY_EVENT;
+	}
+	return StorageScheduler::parsePriority(config.getString("upload.priority.default"s, "periodic"s));
+}
+
+
+std::string ImageUploadRequestHandler::imageKey(const Poco::Net::HTTPServerRequest& request)
+{
+	// /<prefix>/<site>/<camera>/<YYYY>/<MM>/<DD>/<HH>/<file>.jpg
+	Poco::URI uri(request.getURI());
+	const std::string& path = uri.getPath();
+	auto pos = path.find('/', 1);
+	if (pos != std::string::npos)
+	{
+		std::string key = path.substr(pos + 1);
+		if (ImageKey::isValid(key)) return key;
+	}
+	return std::string();
+}
+
+
+ImageUploadRequestHandler::Route ImageUploadRequestHandler::uploadRoute(const Poco::Net::HTTPServerRequest& request)
+{
+	// /<prefix>/<site>/<camera>
+	const std::string& uri = request.getURI();
+	const std::size_t end = std::min(uri.find_first_of("?#"), uri.size());
+	Route route;
+	std::string* components[] = {&route.prefix, &route.site, &route.camera};
+	std::size_t n = 0;
+	// A leading "//" starts an authority in Poco::URI.
+	bool plain = end > 0 && uri[0] == '/' && (end < 2 || uri[1] != '/') && uri.find('%') >= end;
+	std::size_t pos = 0;
+	while (plain && pos < end)
+	{
+		while (pos < end && uri[pos] == '/') pos++;
+		if (pos == end) break;
+
+		std::size_t next = std::min(uri.find('/', pos), end);
+		const std::size_t length = next - pos;
+		if ((length == 1 && uri[pos] == '.') || (length == 2 && uri.compare(pos, 2, "..") == 0))
+		{
+			plain = false;
+		}
+		else if (n < 3)
+		{
+			components[n++]->assign(uri, pos, length);
+		}
+		pos = next;
+	}
+
+	if (!plain)
+	{
+		route = Route();
+		Poco::URI u(uri);
+		Poco::Path p(u.getPath(), Poco::Path::PATH_UNIX);
+		p.makeDirectory();
+		for (int i = 0; i < 3 && i < p.depth(); i++)
+		{
+			*components[i] = p[i];
+		}
+	}
+
+	if (route.site.empty()) route.site = "defaultSite"s;
+	if (route.camera.empty()) route.camera = "defaultCamera"s;
+	return route;
+}
+
+
+std::string ImageUploadRequestHandler::uploadSite(const Poco::Net::HTTPServerRequest& request)
+{
+	return uploadRoute(request).site;
+}
+
+
+std::string ImageUploadRequestHandler::uploadCamera(const Poco::Net::HTTPServerRequest& request)
+{
+	return uploadRoute(request).camera;
+}
+
+
+void ImageUploadRequestHandler::ignoreContent(Poco::Net::HTTPServerRequest& request)
+{
+	Poco::NullOutputStream nullStream;
+	Poco::StreamCopier::copyStream(request.stream(), nullStream);
+}
+
+
+void ImageUploadRequestHandler::sendResponse(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPResponse::HTTPStatus status, const std::string& message)
+{
+	request.response().setContentType("text/html"s);
+	request.response().setStatusAndReason(status);
+
+	std::string html("<!DOCTYPE html>\n<html><head><title>");
+	html += Poco::NumberFormatter::format(static_cast<int>(status));
+	html += " - ";
+	html += request.response().getReasonForStatus(status);
+	html += "</title></head><body><header><h1>"s;
+	html += Poco::NumberFormatter::format(static_cast<int>(status));
+	html += " - ";
+	html += request.response().getReasonForStatus(status);
+	html += "</h1></header><section><p>"s;
+	html += Poco::Net::htmlize(message);
+	html += "</p></section>"s;
+	html += "</body></html>"s;
+	request.response().sendBuffer(html.data(), html.size());
+}
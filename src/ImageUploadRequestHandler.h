@@ -0,0 +1,133 @@
+//
+// ImageUploadRequestHandler.h
+//
+// Definition of the ImageUploadRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ImageUploadRequestHandler_INCLUDED
+#define ImageUploadRequestHandler_INCLUDED
+
+
+#include "ImageStore.h"
+#include "AdmissionController.h"
+#include "StorageScheduler.h"
+#include "ServerStatistics.h"
+#include "CameraRegistry.h"
+#include "CameraHealth.h"
+#include "ImageIndex.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+
+class ImageUploadRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Handles image uploads from cameras (POST), replicated
+	/// images from a peer server and image downloads (GET).
+	///
+	/// If upload.validateJpeg is true, uploaded images are received
+	/// completely and checked with JpegScanner before being stored.
+	/// Malformed images are rejected with 400 Bad Request.
+	///
+	/// Images received completely before being stored are limited
+	/// to upload.maxBufferedSize bytes; larger images are rejected
+	/// with 400 Bad Request.
+{
+public:
+	struct Route
+		/// The components of an upload URI: /<prefix>/<site>/<camera>
+	{
+		std::string prefix;
+		std::string site;
+		std::string camera;
+	};
+
+	ImageUploadRequestHandler(ImageStore& store, ImageStore& replicaStore, AdmissionController* pAdmission = nullptr, StorageScheduler* pScheduler = nullptr, const std::string& admittedSite = std::string(), ServerStatistics* pStatistics = nullptr, CameraRegistry* pRegistry = nullptr, CameraHealth* pHealth = nullptr, ImageIndex* pIndex = nullptr);
+		/// Creates the ImageUploadRequestHandler.
+		///
+		/// Uploaded images are stored in store, images received
+		/// from a peer server in replicaStore.
+		///
+		/// If pAdmission is given, the request has been admitted by
+		/// it for the given site, and the time taken to store the
+		/// image, excluding the time spent waiting for the request
+		/// body, is reported to it.
+		///
+		/// If pScheduler is given, the request body is received
+		/// into memory first, and the image is stored when the
+		/// scheduler grants a storage slot to the request's priority
+		/// class and site. Otherwise, images are streamed to the store.
+		///
+		/// If pStatistics is given, the request and uploaded
+		/// images are recorded in it.
+		///
+		/// If pRegistry is given, the camera of an upload is resolved
+		/// to its camera ID, and if pHealth is also given, uploaded
+		/// images are recorded in it for that camera ID. If pIndex
+		/// is also given, stored images and replicas are added to it.
+
+	~ImageUploadRequestHandler();
+		/// Destroys the ImageUploadRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+	static bool authorize(const Poco::Net::HTTPServerRequest& request, const std::string& token);
+		/// Returns true if the request has the given token in its query string.
+
+	static Route uploadRoute(const Poco::Net::HTTPServerRequest& request);
+		/// Returns the components of the request URI. Site and camera
+		/// are "defaultSite" and "defaultCamera" if not given.
+		///
+		/// Plain URIs are split directly; other URIs (e.g., with
+		/// percent-encoded characters or "." or ".." segments)
+		/// are normalized with Poco::URI and Poco::Path first.
+
+	static std::string uploadSite(const Poco::Net::HTTPServerRequest& request);
+		/// Returns the site given in the request URI.
+
+	static std::string uploadCamera(const Poco::Net::HTTPServerRequest& request);
+		/// Returns the camera given in the request URI.
+
+	static StorageScheduler::Priority uploadPriority(const Poco::Net::HTTPServerRequest& request);
+		/// Returns the priority class of an upload, given by the
+		/// priority query parameter, or by the first path segment
+		/// if listed in upload.priority.eventPrefixes.
+
+	static StorageScheduler::Priority uploadPriority(const Poco::Net::HTTPServerRequest& request, const Route& route);
+		/// Returns the priority class of an upload with the
+		/// given route.
+
+	static std::string imageKey(const Poco::Net::HTTPServerRequest& request);
+		/// Returns the image key given in the request URI, or an empty
+		/// string if the URI does not refer to an image.
+
+	static void ignoreContent(Poco::Net::HTTPServerRequest& request);
+		/// Reads and discards the request body.
+
+	static void sendResponse(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPResponse::HTTPStatus status, const std::string& message);
+		/// Sends a HTML response with the given status and message.
+
+protected:
+	std::string storeImage(Poco::Net::HTTPServerRequest& request);
+	std::string storeScheduled(const std::string& key, std::istream& istr, ImageStore& store, StorageScheduler::Priority priority, const std::string& site, Poco::UInt64& size);
+	std::string storeReceived(const std::string& key, const std::string& data, ImageStore& store, StorageScheduler::Priority priority, const std::string& site);
+	void storeReplica(Poco::Net::HTTPServerRequest& request, const std::string& key);
+	static void receive(std::istream& istr, std::string& data);
+	void sendImage(Poco::Net::HTTPServerRequest& request, const std::string& key);
+
+private:
+	ImageStore& _store;
+	ImageStore& _replicaStore;
+	AdmissionController* _pAdmission;
+	StorageScheduler* _pScheduler;
+	std::string _admittedSite;
+	ServerStatistics* _pStatistics;
+	CameraRegistry* _pRegistry;
+	CameraHealth* _pHealth;
+	ImageIndex* _pIndex;
+};
+
+
+#endif // ImageUploadRequestHandler_INCLUDED
@@ -0,0 +1,174 @@
+//
+// ImageUploadRequestHandlerFactory.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ImageUploadRequestHandlerFactory.h"
+#include "ImageUploadRequestHandler.h"
+#include "RedirectRequestHandler.h"
+#include "ProxyRequestHandler.h"
+#include "ServiceUnavailableRequestHandler.h"
+#include "CapturingRequestHandler.h"
+#include "StatusRequestHandler.h"
+#include "CameraHealthRequestHandler.h"
+#include "TimeLapseRequestHandler.h"
+#include "ImageListRequestHandler.h"
+#include "ReplicatingImageStore.h"
+#include "ImageKey.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Util/Application.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/URI.h"
+#include <sstream>
+
+
+using namespace std::string_literals;
+
+
+ImageUploadRequestHandlerFactory::ImageUploadRequestHandlerFactory(ImageStore& store, ImageStore& replicaStore, ShardRing* pShardRing, AdmissionController* pAdmission, StorageScheduler* pScheduler, TrafficCapture* pCapture, ServerStatistics* pStatistics, CameraRegistry* pRegistry, CameraHealth* pHealth, TimeLapseGenerator* pTimeLapse, ImageIndex* pIndex):
+	_store(store),
+	_replicaStore(replicaStore),
+	_pShardRing(pShardRing),
+	_pAdmission(pAdmission),
+	_pScheduler(pScheduler),
+	_pCapture(pCapture),
+	_pStatistics(pStatistics),
+	_pRegistry(pRegistry),
+	_pHealth(pHealth),
+	_pTimeLapse(pTimeLapse),
+	_pIndex(pIndex)
+{
+}
+
+
+ImageUploadRequestHandlerFactory::~ImageUploadRequestHandlerFactory()
+{
+}
+
+
+Poco::Net::HTTPRequestHandler* ImageUploadRequestHandlerFactory::createRequestHandler(const Poco::Net::HTTPServerRequest& request)
+{
+	auto& app = Poco::Util::Application::instance();
+
+	app.logger().information("Request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
+	if (app.logger().debug())
+	{
+		std::ostringstream sstr;
+		request.write(sstr);
+		app.logger().debug("Request details: %s"s, sstr.str());
+	}
+
+	const Poco::Timestamp::TimeDiff offset = _pCapture ? _pCapture->offset() : 0;
+	bool rejected = false;
+	Poco::Net::HTTPRequestHandler* pHandler = createHandler(request, rejected);
+	if (_pCapture)
+	{
+		if (rejected)
+		{
+			// The body of a rejected upload is never received.
+			_pCapture->write(CapturingRequestHandler::capturedRequest(request, offset), std::string());
+		}
+		else
+		{
+			pHandler = new CapturingRequestHandler(pHandler, *_pCapture, offset);
+		}
+	}
+	return pHandler;
+}
+
+
+Poco::Net::HTTPRequestHandler* ImageUploadRequestHandlerFactory::createHandler(const Poco::Net::HTTPServerRequest& request, bool& rejected)
+{
+	auto& app = Poco::Util::Application::instance();
+
+	if (_pStatistics && request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET && Poco::URI(request.getURI()).getPath() == StatusRequestHandler::PATH)
+	{
+		return new StatusRequestHandler(*_pStatistics);
+	}
+	if (_pRegistry && _pHealth && request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET && Poco::URI(request.getURI()).getPath() == CameraHealthRequestHandler::PATH)
+	{
+		return new CameraHealthRequestHandler(*_pHealth);
+	}
+	if (_pTimeLapse && TimeLapseRequestHandler::matches(request.getMethod(), Poco::URI(request.getURI()).getPath()))
+	{
+		return new TimeLapseRequestHandler(*_pTimeLapse);
+	}
+
+	ShardRing::Node* pOwner = remoteOwner(request);
+	if (pOwner)
+	{
+		if (_pShardRing->mode() == ShardRing::MODE_PROXY)
+			return new ProxyRequestHandler(*pOwner->pSessionPool);
+		else
+			return new RedirectRequestHandler(pOwner->address);
+	}
+
+	if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET && ImageListRequestHandler::matches(Poco::URI(request.getURI()).getPath()))
+	{
+		return new ImageListRequestHandler(_store, _pRegistry, _pIndex);
+	}
+
+	if (_pAdmission && request.getMethod() == Poco::Net::HTTPRequest::HTTP_POST)
+	{
+		const ImageUploadRequestHandler::Route route = ImageUploadRequestHandler::uploadRoute(request);
+		const std::string& site = route.site;
+		const bool mayReject = ImageUploadRequestHandler::uploadPriority(request, route) != StorageScheduler::PRIORITY_EVENT;
+		if (_pAdmission->admit(site, mayReject))
+		{
+			return new ImageUploadRequestHandler(_store, _replicaStore, _pAdmission, _pScheduler, site, _pStatistics, _pRegistry, _pHealth, _pIndex);
+		}
+		else
+		{
+			rejected = true;
+			return new ServiceUnavailableRequestHandler(app.config().getInt("upload.admission.retryAfter"s, 5));
+		}
+	}
+
+	return new ImageUploadRequestHandler(_store, _replicaStore, nullptr, _pScheduler, std::string(), _pStatistics, _pRegistry, _pHealth, _pIndex);
+}
+
+
+ShardRing::Node* ImageUploadRequestHandlerFactory::remoteOwner(const Poco::Net::HTTPServerRequest& request) const
+{
+	if (!_pShardRing) return nullptr;
+
+	// Replicas and requests forwarded by another node are always
+	// handled here, otherwise nodes with different views of the
+	// cluster could forward requests back and forth.
+	if (request.has(ShardRing::FORWARDED_HEADER) || request.has(ReplicatingImageStore::REPLICA_KEY_HEADER)) return nullptr;
+
+	std::string site;
+	std::string camera;
+	if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_POST)
+	{
+		ImageUploadRequestHandler::Route route = ImageUploadRequestHandler::uploadRoute(request);
+		site = std::move(route.site);
+		camera = std::move(route.camera);
+	}
+	else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET)
+	{
+		const std::string path = Poco::URI(request.getURI()).getPath();
+		if (ImageListRequestHandler::matches(path))
+		{
+			Poco::StringTokenizer tok(path, "/"s, Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+			site = tok[0];
+			camera = tok[1];
+		}
+		else
+		{
+			const std::string key = ImageUploadRequestHandler::imageKey(request);
+			if (key.empty()) return nullptr;
+			site = ImageKey::site(key);
+			camera = ImageKey::camera(key);
+		}
+	}
+	else return nullptr;
+
+	ShardRing::Node& owner = _pShardRing->owner(site, camera);
+	if (_pShardRing->isSelf(owner))
+		return nullptr;
+	else
+		return &owner;
+}
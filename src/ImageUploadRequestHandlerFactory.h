@@ -0,0 +1,100 @@
+//
+// ImageUploadRequestHandlerFactory.h
+//
+// Definition of the ImageUploadRequestHandlerFactory class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ImageUploadRequestHandlerFactory_INCLUDED
+#define ImageUploadRequestHandlerFactory_INCLUDED
+
+
+#include "ImageStore.h"
+#include "ShardRing.h"
+#include "AdmissionController.h"
+#include "StorageScheduler.h"
+#include "TrafficCapture.h"
+#include "ServerStatistics.h"
+#include "CameraRegistry.h"
+#include "CameraHealth.h"
+#include "TimeLapseGenerator.h"
+#include "ImageIndex.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+
+
+class ImageUploadRequestHandlerFactory: public Poco::Net::HTTPRequestHandlerFactory
+	/// Creates the request handlers for the image upload server.
+	///
+	/// If a ShardRing is given, uploads and image downloads for cameras
+	/// owned by another node are redirected or proxied to that node.
+	///
+	/// If an AdmissionController is given, uploads it does not admit
+	/// are rejected with 503 Service Unavailable before their body
+	/// is received. Event uploads are only rejected if the in-flight
+	/// limits have been reached.
+	///
+	/// If a StorageScheduler is given, handlers store images in the
+	/// order determined by the scheduler.
+	///
+	/// If a TrafficCapture is given, all requests are recorded to it.
+	/// Request bodies are then received before the handler runs,
+	/// except for rejected uploads, which are recorded with the
+	/// size given in their Content-Length header.
+	///
+	/// If ServerStatistics are given, requests and uploads are
+	/// recorded in them, and the status page is served.
+	///
+	/// If a CameraRegistry is given, handlers resolve the camera
+	/// of an upload to its camera ID. If a CameraHealth is also
+	/// given, uploads are recorded in it, and the camera list
+	/// is served.
+	///
+	/// If a TimeLapseGenerator is given, time-lapse jobs can be
+	/// submitted and their videos downloaded.
+	///
+	/// The images of a camera in a time range are listed at
+	/// /<site>/<camera>/list. If a CameraRegistry and an ImageIndex
+	/// are given, stored images are added to the index, and recent
+	/// images are listed from it instead of the store.
+{
+public:
+	ImageUploadRequestHandlerFactory(ImageStore& store, ImageStore& replicaStore, ShardRing* pShardRing = nullptr, AdmissionController* pAdmission = nullptr, StorageScheduler* pScheduler = nullptr, TrafficCapture* pCapture = nullptr, ServerStatistics* pStatistics = nullptr, CameraRegistry* pRegistry = nullptr, CameraHealth* pHealth = nullptr, TimeLapseGenerator* pTimeLapse = nullptr, ImageIndex* pIndex = nullptr);
+		/// Creates the ImageUploadRequestHandlerFactory.
+		///
+		/// The ShardRing, AdmissionController, StorageScheduler,
+		/// TrafficCapture, ServerStatistics, CameraRegistry,
+		/// CameraHealth, TimeLapseGenerator and ImageIndex, if given,
+		/// must outlive the factory.
+
+	~ImageUploadRequestHandlerFactory();
+		/// Destroys the ImageUploadRequestHandlerFactory.
+
+	Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& request);
+
+protected:
+	Poco::Net::HTTPRequestHandler* createHandler(const Poco::Net::HTTPServerRequest& request, bool& rejected);
+		/// Creates the handler for the request. Sets rejected to
+		/// true if the request is rejected by admission control.
+
+	ShardRing::Node* remoteOwner(const Poco::Net::HTTPServerRequest& request) const;
+		/// Returns the node owning the camera referred to by the
+		/// request, or nullptr if the request must be handled locally.
+
+private:
+	ImageStore& _store;
+	ImageStore& _replicaStore;
+	ShardRing* _pShardRing;
+	AdmissionController* _pAdmission;
+	StorageScheduler* _pScheduler;
+	TrafficCapture* _pCapture;
+	ServerStatistics* _pStatistics;
+	CameraRegistry* _pRegistry;
+	CameraHealth* _pHealth;
+	TimeLapseGenerator* _pTimeLapse;
+	ImageIndex* _pIndex;
+};
+
+
+#endif // ImageUploadRequestHandlerFactory_INCLUDED
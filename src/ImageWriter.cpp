@@ -0,0 +1,232 @@
+//
+// ImageWriter.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ImageWriter.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	class FileDescriptor
+	{
+	public:
+		explicit FileDescriptor(int fd):
+			_fd(fd)
+		{
+		}
+
+		~FileDescriptor()
+		{
+			if (_fd >= 0) ::close(_fd);
+		}
+
+		int release()
+		{
+			int fd = _fd;
+			_fd = -1;
+			return fd;
+		}
+
+	private:
+		int _fd;
+	};
+}
+
+
+ImageWriter::ImageWriter(WriteMode mode, AlignedBufferPool& pool):
+	_mode(mode),
+	_pool(pool)
+{
+}
+
+
+ImageWriter::~ImageWriter()
+{
+}
+
+
+Poco::UInt64 ImageWriter::write(std::istream& istr, const std::string& path)
+{
+	return write(istr, AT_FDCWD, path, path);
+}
+
+
+Poco::UInt64 ImageWriter::write(std::istream& istr, int dirfd, const std::string& name, const std::string& path)
+{
+	WriteMode mode = _mode;
+	int fd = openFile(dirfd, name, path, mode);
+	FileDescriptor guard(fd);
+	try
+	{
+		Poco::UInt64 n = copy(istr, fd, mode, path);
+		if (::close(guard.release()) != 0)
+		{
+			throw Poco::WriteFileException(path, Poco::Error::getMessage(errno));
+		}
+		return n;
+	}
+	catch (...)
+	{
+		::unlinkat(dirfd, name.c_str(), 0);
+		throw;
+	}
+}
+
+
+int ImageWriter::openFile(int dirfd, const std::string& name, const std::string& path, WriteMode& mode)
+{
+	const int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+	int fd = -1;
+#ifdef O_DIRECT
+	if (mode == WRITE_DIRECT)
+	{
+		fd = createFile(dirfd, name, flags | O_DIRECT);
+		if (fd < 0 && errno == EINVAL)
+		{
+			// file system does not support direct I/O
+			mode = WRITE_DONTNEED;
+		}
+	}
+#else
+	if (mode == WRITE_DIRECT) mode = WRITE_DONTNEED;
+#endif
+	if (fd < 0 && mode != WRITE_DIRECT)
+	{
+		fd = createFile(dirfd, name, flags);
+	}
+	if (fd < 0)
+	{
+		throw Poco::CreateFileException(path, Poco::Error::getMessage(errno));
+	}
+	return fd;
+}
+
+
+int ImageWriter::createFile(int dirfd, const std::string& name, int flags)
+{
+	// Image files are normally new. An image stored again
+	// (e.g., a replayed or replicated image) replaces the file.
+	int fd = ::openat(dirfd, name.c_str(), flags | O_EXCL, 0644);
+	if (fd < 0 && errno == EEXIST)
+	{
+		fd = ::openat(dirfd, name.c_str(), flags | O_TRUNC, 0644);
+	}
+	return fd;
+}
+
+
+Poco::UInt64 ImageWriter::copy(std::istream& istr, int fd, WriteMode mode, const std::string& path)
+{
+	AlignedBufferPool::Buffer buffer(_pool);
+	Poco::UInt64 total = 0;
+	std::size_t n = fill(istr, buffer.begin(), buffer.size());
+	while (n > 0)
+	{
+		if (mode == WRITE_DIRECT && n < buffer.size())
+		{
+			// Direct I/O requires aligned transfer sizes, so the last
+			// block is padded and the file truncated to its real size.
+			const std::size_t alignment = _pool.alignment();
+			const std::size_t padded = (n + alignment - 1) & ~(alignment - 1);
+			std::memset(buffer.begin() + n, 0, padded - n);
+			writeAll(fd, buffer.begin(), padded, path);
+			total += n;
+			if (::ftruncate(fd, static_cast<off_t>(total)) != 0)
+			{
+				throw Poco::WriteFileException(path, Poco::Error::getMessage(errno));
+			}
+			break;
+		}
+		writeAll(fd, buffer.begin(), n, path);
+		total += n;
+		n = fill(istr, buffer.begin(), buffer.size());
+	}
+
+	if (mode == WRITE_DONTNEED && total > 0)
+	{
+		// Dirty pages cannot be dropped, so write them back first.
+#if defined(__linux__)
+		int rc = ::sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#else
+		int rc = ::fdatasync(fd);
+#endif
+		if (rc != 0)
+		{
+			throw Poco::WriteFileException(path, Poco::Error::getMessage(errno));
+		}
+		::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	}
+	return total;
+}
+
+
+std::size_t ImageWriter::fill(std::istream& istr, char* buffer, std::size_t size)
+{
+	std::size_t n = 0;
+	while (n < size && istr.good())
+	{
+		istr.read(buffer + n, static_cast<std::streamsize>(size - n));
+		n += static_cast<std::size_t>(istr.gcount());
+	}
+	if (istr.bad())
+	{
+		throw Poco::IOException("Error reading image data");
+	}
+	return n;
+}
+
+
+void ImageWriter::writeAll(int fd, const char* buffer, std::size_t size, const std::string& path)
+{
+	while (size > 0)
+	{
+		ssize_t n = ::write(fd, buffer, size);
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			throw Poco::WriteFileException(path, Poco::Error::getMessage(errno));
+		}
+		buffer += n;
+		size -= static_cast<std::size_t>(n);
+	}
+}
+
+
+ImageWriter::WriteMode ImageWriter::parseWriteMode(const std::string& mode)
+{
+	if (mode == "buffered")
+		return WRITE_BUFFERED;
+	else if (mode == "dontneed")
+		return WRITE_DONTNEED;
+	else if (mode == "direct")
+		return WRITE_DIRECT;
+	else
+		throw Poco::InvalidArgumentException("Invalid write mode"s, mode);
+}
+
+
+std::string ImageWriter::formatWriteMode(WriteMode mode)
+{
+	switch (mode)
+	{
+	case WRITE_BUFFERED:
+		return "buffered"s;
+	case WRITE_DONTNEED:
+		return "dontneed"s;
+	case WRITE_DIRECT:
+		return "direct"s;
+	}
+	return ""s;
+}
@@ -0,0 +1,107 @@
+//
+// ImageWriter.h
+//
+// Definition of the ImageWriter class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ImageWriter_INCLUDED
+#define ImageWriter_INCLUDED
+
+
+#include "AlignedBufferPool.h"
+#include "Poco/Types.h"
+#include <istream>
+#include <string>
+
+
+class ImageWriter
+	/// ImageWriter copies uploaded image data into a newly
+	/// created file on a storage volume.
+	///
+	/// Images are normally written through the page cache.
+	/// As stored images are rarely read back, this evicts
+	/// more useful data (like directory entries) from the cache
+	/// on busy servers. Therefore, two additional write modes
+	/// are supported that keep image data out of the page cache.
+{
+public:
+	enum WriteMode
+	{
+		WRITE_BUFFERED,
+			/// Regular writes through the page cache.
+
+		WRITE_DONTNEED,
+			/// Regular writes, followed by writeback of the file
+			/// and posix_fadvise(POSIX_FADV_DONTNEED) to drop
+			/// the written pages from the page cache.
+
+		WRITE_DIRECT
+			/// Direct writes (O_DIRECT) from aligned buffers,
+			/// bypassing the page cache. Falls back to WRITE_DONTNEED
+			/// if the file system does not support direct I/O.
+	};
+
+	ImageWriter(WriteMode mode, AlignedBufferPool& pool);
+		/// Creates the ImageWriter, using the given pool for
+		/// I/O buffers. For WRITE_DIRECT, the pool's alignment
+		/// must satisfy the logical block size of the volume.
+
+	~ImageWriter();
+		/// Destroys the ImageWriter.
+
+	Poco::UInt64 write(std::istream& istr, const std::string& path);
+		/// Copies all data from istr into a newly created file
+		/// at the given path, replacing any existing file.
+		/// Returns the number of bytes written.
+		///
+		/// If writing fails, the partially written file is removed
+		/// and a Poco::FileException is thrown.
+
+	Poco::UInt64 write(std::istream& istr, int dirfd, const std::string& name, const std::string& path);
+		/// Copies all data from istr into a newly created file with
+		/// the given name in the directory referred to by dirfd,
+		/// replacing any existing file. path is the full path of
+		/// the file, used in error messages.
+		///
+		/// If the file cannot be created, a Poco::CreateFileException
+		/// is thrown before any data is read from istr.
+
+	WriteMode mode() const;
+		/// Returns the write mode.
+
+	static WriteMode parseWriteMode(const std::string& mode);
+		/// Parses a write mode ("buffered", "dontneed" or "direct").
+		/// Throws a Poco::InvalidArgumentException if the mode is not valid.
+
+	static std::string formatWriteMode(WriteMode mode);
+		/// Returns the name of the given write mode.
+
+protected:
+	int openFile(int dirfd, const std::string& name, const std::string& path, WriteMode& mode);
+	static int createFile(int dirfd, const std::string& name, int flags);
+	Poco::UInt64 copy(std::istream& istr, int fd, WriteMode mode, const std::string& path);
+	static std::size_t fill(std::istream& istr, char* buffer, std::size_t size);
+	static void writeAll(int fd, const char* buffer, std::size_t size, const std::string& path);
+
+private:
+	ImageWriter(const ImageWriter&) = delete;
+	ImageWriter& operator = (const ImageWriter&) = delete;
+
+	WriteMode _mode;
+	AlignedBufferPool& _pool;
+};
+
+
+//
+// inlines
+//
+inline ImageWriter::WriteMode ImageWriter::mode() const
+{
+	return _mode;
+}
+
+
+#endif // ImageWriter_INCLUDED
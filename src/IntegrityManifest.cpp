@@ -0,0 +1,111 @@
+//
+// IntegrityManifest.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "IntegrityManifest.h"
+#include "ImageKey.h"
+#include "Poco/FileStream.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Path.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include <sstream>
+
+
+using namespace std::string_literals;
+
+
+const std::string IntegrityManifest::SUFFIX(".manifest");
+
+
+IntegrityManifest::IntegrityManifest(const std::string& root, std::size_t batchSize):
+	_root(root),
+	_batchSize(batchSize > 0 ? batchSize : 1)
+{
+}
+
+
+IntegrityManifest::~IntegrityManifest()
+{
+}
+
+
+void IntegrityManifest::add(const std::string& key, Poco::UInt64 size, Poco::UInt32 checksum)
+{
+	const std::string directory = ImageKey::directory(key);
+	std::string line = ImageKey::fileName(key);
+	line += ' ';
+	Poco::NumberFormatter::append(line, size);
+	line += ' ';
+	Poco::NumberFormatter::appendHex(line, checksum, 8);
+	line += '\n';
+
+	Batch batch;
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		Batch& pending = _batches[directory];
+		pending.push_back(std::move(line));
+		if (pending.size() < _batchSize) return;
+
+		batch.swap(pending);
+		_batches.erase(directory);
+	}
+	write(directory, batch);
+}
+
+
+void IntegrityManifest::flush()
+{
+	std::map<std::string, Batch> batches;
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		batches.swap(_batches);
+	}
+	for (const auto& batch: batches)
+	{
+		write(batch.first, batch.second);
+	}
+}
+
+
+void IntegrityManifest::write(const std::string& directory, const Batch& batch)
+{
+	std::string data;
+	for (const auto& line: batch)
+	{
+		data += line;
+	}
+
+	// Batches for the same manifest may be written by
+	// different threads.
+	Poco::FastMutex::ScopedLock lock(_writeMutex);
+
+	const std::string p = path(directory);
+	Poco::File(Poco::Path(p).parent()).createDirectories();
+	Poco::FileOutputStream ostr(p, std::ios::out | std::ios::app);
+	ostr.write(data.data(), static_cast<std::streamsize>(data.size()));
+	ostr.close();
+	if (!ostr.good()) throw Poco::WriteFileException(p);
+}
+
+
+void IntegrityManifest::read(const std::string& path, Entries& entries)
+{
+	Poco::FileInputStream istr(path);
+	std::string line;
+	while (std::getline(istr, line))
+	{
+		std::istringstream lineStream(line);
+		std::string name;
+		Entry entry;
+		if (lineStream >> name >> entry.size >> std::hex >> entry.checksum)
+		{
+			entries[name] = entry;
+		}
+	}
+}
@@ -0,0 +1,109 @@
+//
+// IntegrityManifest.h
+//
+// Definition of the IntegrityManifest class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef IntegrityManifest_INCLUDED
+#define IntegrityManifest_INCLUDED
+
+
+#include "Poco/Mutex.h"
+#include "Poco/Types.h"
+#include <map>
+#include <string>
+#include <vector>
+
+
+class IntegrityManifest
+	/// IntegrityManifest records the size and CRC-32C checksum
+	/// of stored images in per-hour manifest files.
+	///
+	/// The manifest of an hour directory is a text file at
+	///
+	///     <root>/<site>/<camera>/<YYYY>/<MM>/<DD>/<HH>.manifest
+	///
+	/// with one line per image:
+	///
+	///     <file name> <size> <checksum (8 hex digits)>
+	///
+	/// If an image is stored again, a new line is appended; the
+	/// last line for a file name is valid. Entries are collected in
+	/// memory and appended in batches of up to batchSize entries per
+	/// manifest, or by flush(). Entries not yet flushed when the
+	/// server crashes are lost; the affected images are not verified.
+{
+public:
+	struct Entry
+	{
+		Poco::UInt64 size = 0;
+		Poco::UInt32 checksum = 0;
+	};
+
+	using Entries = std::map<std::string, Entry>;
+		/// Entries of a manifest, by file name.
+
+	IntegrityManifest(const std::string& root, std::size_t batchSize);
+		/// Creates the IntegrityManifest with the given root
+		/// directory (with a trailing path separator).
+
+	~IntegrityManifest();
+		/// Destroys the IntegrityManifest. Entries not yet
+		/// flushed are discarded.
+
+	void add(const std::string& key, Poco::UInt64 size, Poco::UInt32 checksum);
+		/// Adds the entry for the image with the given key,
+		/// and appends the batch of the image's hour directory
+		/// to its manifest if it is full.
+
+	void flush();
+		/// Appends all pending entries to their manifests.
+
+	const std::string& root() const;
+		/// Returns the root directory of the manifests.
+
+	std::string path(const std::string& directory) const;
+		/// Returns the path of the manifest for the given
+		/// hour directory.
+
+	static void read(const std::string& path, Entries& entries);
+		/// Reads the entries of the manifest at the given path.
+		/// Malformed lines (e.g., a partially written last line)
+		/// are skipped.
+
+	static const std::string SUFFIX;
+		/// The suffix of manifest files (".manifest").
+
+protected:
+	using Batch = std::vector<std::string>;
+
+	void write(const std::string& directory, const Batch& batch);
+
+private:
+	const std::string _root;
+	const std::size_t _batchSize;
+	std::map<std::string, Batch> _batches;
+	Poco::FastMutex _mutex;
+	Poco::FastMutex _writeMutex;
+};
+
+
+//
+// inlines
+//
+inline const std::string& IntegrityManifest::root() const
+{
+	return _root;
+}
+
+
+inline std::string IntegrityManifest::path(const std::string& directory) const
+{
+	return _root + directory + SUFFIX;
+}
+
+
+#endif // IntegrityManifest_INCLUDED
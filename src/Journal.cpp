@@ -0,0 +1,342 @@
+//
+// Journal.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "Journal.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/FileStream.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Checksum.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const std::string SEGMENT_SUFFIX(".journal");
+	const Poco::UInt32 RECORD_MAGIC = 0x314A5841; // "AXJ1"
+	const Poco::UInt32 MAX_KEY_LENGTH = 4096;
+	const Poco::UInt64 MAX_DATA_LENGTH = 1024*1024*1024;
+
+	struct RecordHeader
+	{
+		Poco::UInt32 magic;
+		Poco::UInt32 checksum;
+		Poco::UInt32 keyLength;
+		Poco::UInt32 reserved;
+		Poco::UInt64 dataLength;
+	};
+
+	Poco::UInt32 recordChecksum(const std::string& key, const std::string& data)
+	{
+		Poco::Checksum checksum(Poco::Checksum::TYPE_CRC32);
+		checksum.update(key);
+		checksum.update(data);
+		return checksum.checksum();
+	}
+}
+
+
+Journal::Journal(const std::string& path, Poco::UInt64 segmentSize):
+	_path(Poco::Path(path).makeDirectory().toString()),
+	_segmentSize(segmentSize),
+	_logger(Poco::Logger::get("Journal"s))
+{
+}
+
+
+Journal::~Journal()
+{
+	try
+	{
+		close();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+void Journal::replay(const ReplayFunction& apply, const CheckpointFunction& checkpoint)
+{
+	Poco::File dir(_path);
+	if (!dir.exists()) return;
+
+	std::vector<Poco::UInt32> segments;
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(dir); it != end; ++it)
+	{
+		const std::string& name = it.name();
+		unsigned segment;
+		if (name.size() > SEGMENT_SUFFIX.size()
+			&& name.compare(name.size() - SEGMENT_SUFFIX.size(), SEGMENT_SUFFIX.size(), SEGMENT_SUFFIX) == 0
+			&& Poco::NumberParser::tryParseUnsigned(name.substr(0, name.size() - SEGMENT_SUFFIX.size()), segment))
+		{
+			segments.push_back(segment);
+		}
+	}
+	std::sort(segments.begin(), segments.end());
+
+	for (auto segment: segments)
+	{
+		replaySegment(segmentPath(segment), apply);
+	}
+	if (!segments.empty()) checkpoint();
+	for (auto segment: segments)
+	{
+		removeSegment(segment);
+		if (segment > _segment) _segment = segment;
+	}
+}
+
+
+bool Journal::replaySegment(const std::string& path, const ReplayFunction& apply)
+{
+	Poco::FileInputStream istr(path);
+	int records = 0;
+	while (true)
+	{
+		RecordHeader header;
+		istr.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (istr.gcount() == 0) break;
+
+		std::string key;
+		std::string data;
+		bool valid = istr.gcount() == sizeof(header)
+			&& header.magic == RECORD_MAGIC
+			&& header.keyLength <= MAX_KEY_LENGTH
+			&& header.dataLength <= MAX_DATA_LENGTH;
+		if (valid)
+		{
+			key.resize(header.keyLength);
+			data.resize(header.dataLength);
+			istr.read(&key[0], key.size());
+			valid = static_cast<std::size_t>(istr.gcount()) == key.size();
+			if (valid)
+			{
+				istr.read(&data[0], data.size());
+				valid = static_cast<std::size_t>(istr.gcount()) == data.size()
+					&& recordChecksum(key, data) == header.checksum;
+			}
+		}
+		if (!valid)
+		{
+			_logger.warning("Journal segment %s ends with an incomplete record after %d records."s, path, records);
+			return false;
+		}
+
+		apply(key, data);
+		records++;
+	}
+	_logger.information("Replayed %d records from journal segment %s."s, records, path);
+	return true;
+}
+
+
+void Journal::open()
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	Poco::File(_path).createDirectories();
+	rotate();
+}
+
+
+void Journal::close()
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	while (_syncing) _syncDone.wait(_mutex);
+	if (_fd >= 0)
+	{
+		::fdatasync(_fd);
+		::close(_fd);
+		_fd = -1;
+		_synced = _written;
+
+		auto it = _outstanding.find(_segment);
+		if (it != _outstanding.end() && it->second == 0)
+		{
+			_outstanding.erase(it);
+			removeSegment(_segment);
+		}
+	}
+}
+
+
+Journal::Position Journal::append(const std::string& key, const std::string& data)
+{
+	RecordHeader header;
+	header.magic = RECORD_MAGIC;
+	header.checksum = recordChecksum(key, data);
+	header.keyLength = static_cast<Poco::UInt32>(key.size());
+	header.reserved = 0;
+	header.dataLength = data.size();
+	const Poco::UInt64 recordSize = sizeof(header) + key.size() + data.size();
+
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	if (_fd < 0) throw Poco::IllegalStateException("Journal is not open"s);
+	if (_segmentOffset > 0 && _segmentOffset + recordSize > _segmentSize)
+	{
+		rotate();
+	}
+
+	struct iovec iov[3];
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = const_cast<char*>(key.data());
+	iov[1].iov_len = key.size();
+	iov[2].iov_base = const_cast<char*>(data.data());
+	iov[2].iov_len = data.size();
+
+	struct iovec* pIov = iov;
+	int iovCount = 3;
+	while (iovCount > 0)
+	{
+		ssize_t n = ::writev(_fd, pIov, iovCount);
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			int err = errno;
+			// Cut off the partial record, so that later records remain readable.
+			if (::ftruncate(_fd, static_cast<off_t>(_segmentOffset)) != 0) rotate();
+			throw Poco::WriteFileException(segmentPath(_segment), Poco::Error::getMessage(err));
+		}
+		while (iovCount > 0 && static_cast<std::size_t>(n) >= pIov->iov_len)
+		{
+			n -= pIov->iov_len;
+			pIov++;
+			iovCount--;
+		}
+		if (iovCount > 0)
+		{
+			pIov->iov_base = static_cast<char*>(pIov->iov_base) + n;
+			pIov->iov_len -= n;
+		}
+	}
+
+	_segmentOffset += recordSize;
+	_written += recordSize;
+	_outstanding[_segment]++;
+
+	Position position;
+	position.segment = _segment;
+	position.lsn = _written;
+	return position;
+}
+
+
+void Journal::commit(const Position& position)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	while (_synced < position.lsn)
+	{
+		if (_syncing)
+		{
+			// Another thread is syncing; its fdatasync() may
+			// not cover our record, so check again afterwards.
+			_syncDone.wait(_mutex);
+			continue;
+		}
+
+		_syncing = true;
+		const Poco::UInt64 target = _written;
+		const int fd = _fd;
+		int rc;
+		int err;
+		{
+			Poco::FastMutex::ScopedUnlock unlock(_mutex);
+			rc = ::fdatasync(fd);
+			err = errno;
+		}
+		_syncing = false;
+		_syncDone.broadcast();
+		if (rc != 0) throw Poco::WriteFileException(segmentPath(position.segment), Poco::Error::getMessage(err));
+		if (target > _synced) _synced = target;
+	}
+}
+
+
+void Journal::release(const Position& position)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _outstanding.find(position.segment);
+	if (it != _outstanding.end() && --it->second == 0 && (position.segment != _segment || _fd < 0))
+	{
+		_outstanding.erase(it);
+		removeSegment(position.segment);
+	}
+}
+
+
+std::string Journal::segmentPath(Poco::UInt32 segment) const
+{
+	return _path + Poco::NumberFormatter::format0(segment, 8) + SEGMENT_SUFFIX;
+}
+
+
+void Journal::rotate()
+{
+	// The segment file may only be closed when no
+	// other thread is syncing it.
+	while (_syncing) _syncDone.wait(_mutex);
+
+	if (_fd >= 0)
+	{
+		if (::fdatasync(_fd) != 0)
+			throw Poco::WriteFileException(segmentPath(_segment), Poco::Error::getMessage(errno));
+		::close(_fd);
+		_fd = -1;
+		_synced = _written;
+
+		auto it = _outstanding.find(_segment);
+		if (it != _outstanding.end() && it->second == 0)
+		{
+			_outstanding.erase(it);
+			removeSegment(_segment);
+		}
+	}
+
+	_segment++;
+	const std::string path = segmentPath(_segment);
+	_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+	if (_fd < 0) throw Poco::CreateFileException(path, Poco::Error::getMessage(errno));
+	_segmentOffset = 0;
+	_outstanding[_segment] = 0;
+
+	// make the new directory entry durable
+	int dirFd = ::open(_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirFd >= 0)
+	{
+		::fsync(dirFd);
+		::close(dirFd);
+	}
+}
+
+
+void Journal::removeSegment(Poco::UInt32 segment)
+{
+	const std::string path = segmentPath(segment);
+	if (::unlink(path.c_str()) != 0 && errno != ENOENT)
+	{
+		_logger.error("Cannot remove journal segment %s: %s"s, path, Poco::Error::getMessage(errno));
+	}
+}
@@ -0,0 +1,120 @@
+//
+// Journal.h
+//
+// Definition of the Journal class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef Journal_INCLUDED
+#define Journal_INCLUDED
+
+
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Logger.h"
+#include "Poco/Types.h"
+#include <functional>
+#include <string>
+#include <map>
+
+
+class Journal
+	/// Journal is an append-only write-ahead log for images.
+	///
+	/// Records (image key and data) are appended sequentially to
+	/// segment files in the journal directory. commit() makes
+	/// appended records durable. Concurrent commits are grouped,
+	/// so that a single fdatasync() covers all records appended
+	/// by the time it starts.
+	///
+	/// A segment file is deleted once it is no longer written to
+	/// and all its records have been released. Records in segments
+	/// left over from a previous run are passed to replay().
+{
+public:
+	struct Position
+		/// The position of a record in the journal.
+	{
+		Poco::UInt32 segment = 0;  /// Segment number
+		Poco::UInt64 lsn = 0;      /// Log sequence number (end of the record)
+	};
+
+	using ReplayFunction = std::function<void(const std::string& key, const std::string& data)>;
+	using CheckpointFunction = std::function<void()>;
+
+	Journal(const std::string& path, Poco::UInt64 segmentSize);
+		/// Creates the Journal, using the given directory.
+		/// Segment files are rotated when they exceed segmentSize bytes.
+
+	~Journal();
+		/// Destroys the Journal, closing the current segment.
+
+	void replay(const ReplayFunction& apply, const CheckpointFunction& checkpoint);
+		/// Calls apply for every record found in existing segment files,
+		/// in the order the records have been written, then checkpoint,
+		/// which must make the applied records durable, then deletes the
+		/// segment files. A segment ending in an incomplete or corrupt
+		/// record (e.g., after a crash during an append) is read up to
+		/// that record. If apply or checkpoint throws, the segment files
+		/// are kept.
+		///
+		/// Must be called before open().
+
+	void open();
+		/// Creates the journal directory if necessary and opens
+		/// a new segment for appending.
+
+	void close();
+		/// Syncs and closes the current segment. Unreleased records
+		/// are kept for replay().
+
+	Position append(const std::string& key, const std::string& data);
+		/// Appends a record. The record is not durable until
+		/// commit() has been called with the returned Position.
+
+	void commit(const Position& position);
+		/// Waits until the record at the given position, and all
+		/// records before it, are on stable storage.
+
+	void release(const Position& position);
+		/// Marks the record at the given position as applied.
+
+	const std::string& path() const;
+		/// Returns the journal directory.
+
+	std::string segmentPath(Poco::UInt32 segment) const;
+		/// Returns the path of the segment file with the given number.
+
+protected:
+	void rotate();
+	void removeSegment(Poco::UInt32 segment);
+	bool replaySegment(const std::string& path, const ReplayFunction& apply);
+
+private:
+	std::string _path;
+	Poco::UInt64 _segmentSize;
+	int _fd = -1;
+	Poco::UInt32 _segment = 0;
+	Poco::UInt64 _segmentOffset = 0;
+	Poco::UInt64 _written = 0;
+	Poco::UInt64 _synced = 0;
+	bool _syncing = false;
+	std::map<Poco::UInt32, int> _outstanding;
+	Poco::FastMutex _mutex;
+	Poco::Condition _syncDone;
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline const std::string& Journal::path() const
+{
+	return _path;
+}
+
+
+#endif // Journal_INCLUDED
@@ -0,0 +1,301 @@
+//
+// JournalingImageStore.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "JournalingImageStore.h"
+#include "ImageKey.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/Exception.h"
+#include <sstream>
+
+
+using namespace std::string_literals;
+
+
+JournalingImageStore::JournalingImageStore(ImageStore::Ptr pTarget, const std::string& journalPath, Poco::UInt64 segmentSize, int threads, Poco::Timespan retryDelay, std::size_t maxPending, std::size_t quantum, Poco::Timespan syncInterval):
+	_pTarget(pTarget),
+	_journal(journalPath, segmentSize),
+	_threadCount(threads > 0 ? threads : 1),
+	_retryDelay(retryDelay),
+	_maxPending(maxPending),
+	_syncInterval(syncInterval),
+	_ready(quantum),
+	_logger(Poco::Logger::get("JournalingImageStore"s))
+{
+}
+
+
+JournalingImageStore::~JournalingImageStore()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+std::size_t JournalingImageStore::pending() const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	return _pending.size();
+}
+
+
+std::string JournalingImageStore::store(const std::string& key, std::istream& istr)
+{
+	if (pending() >= _maxPending)
+	{
+		_logger.debug("%z images pending, storing %s directly."s, _maxPending, key);
+		return _pTarget->store(key, istr);
+	}
+
+	std::string data;
+	Poco::StreamCopier::copyToString(istr, data);
+	if (istr.bad()) throw Poco::IOException("Error reading image data"s);
+	DataPtr pData = std::make_shared<const std::string>(std::move(data));
+
+	Journal::Position position = _journal.append(key, *pData);
+	try
+	{
+		_journal.commit(position);
+	}
+	catch (...)
+	{
+		_journal.release(position);
+		throw;
+	}
+
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_pending[key] = pData;
+	}
+
+	Record record;
+	record.key = key;
+	record.pData = pData;
+	record.position = position;
+	schedule(record);
+	return _journal.segmentPath(position.segment);
+}
+
+
+std::unique_ptr<std::istream> JournalingImageStore::open(const std::string& key, Poco::UInt64& size)
+{
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		auto it = _pending.find(key);
+		if (it != _pending.end())
+		{
+			size = it->second->size();
+			return std::make_unique<std::istringstream>(*it->second);
+		}
+	}
+	return _pTarget->open(key, size);
+}
+
+
+bool JournalingImageStore::exists(const std::string& key)
+{
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		if (_pending.find(key) != _pending.end()) return true;
+	}
+	return _pTarget->exists(key);
+}
+
+
+void JournalingImageStore::list(const std::string& directory, std::vector<std::string>& names)
+{
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		const std::string prefix = directory + '/';
+		for (auto it = _pending.lower_bound(prefix); it != _pending.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+		{
+			names.push_back(ImageKey::fileName(it->first));
+		}
+	}
+	_pTarget->list(directory, names);
+}
+
+
+void JournalingImageStore::start()
+{
+	_pTarget->start();
+	_stopped = false;
+
+	// Records from the previous run must be in the target
+	// store before the journal is reused.
+	_journal.replay([this](const std::string& key, const std::string& data)
+		{
+			replay(key, data);
+		},
+		[this]()
+		{
+			_pTarget->sync();
+		});
+	_journal.open();
+
+	for (int i = 0; i < _threadCount; i++)
+	{
+		_threads.push_back(std::make_unique<Poco::Thread>("JournalApplier"s));
+		_threads.back()->start(*this);
+	}
+}
+
+
+void JournalingImageStore::stop()
+{
+	if (_stopped) return;
+
+	_stopped = true;
+	for (auto& pThread: _threads)
+	{
+		pThread->join();
+	}
+	_threads.clear();
+
+	// Images not yet applied (or not synced, if
+	// the checkpoint fails) remain in the journal.
+	checkpoint();
+	_journal.close();
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		if (!_pending.empty())
+		{
+			_logger.information("%z images will be replayed from the journal at the next start."s, _pending.size());
+		}
+		_pending.clear();
+		_applied.clear();
+		_ready.clear();
+		_retries.clear();
+	}
+	_pTarget->stop();
+}
+
+
+void JournalingImageStore::run()
+{
+	while (!_stopped)
+	{
+		Record record;
+		bool ready;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+
+			Poco::Timestamp now;
+			while (!_retries.empty() && _retries.begin()->first <= now)
+			{
+				const Record& retry = _retries.begin()->second;
+				_ready.push(ImageKey::site(retry.key), retry, retry.pData->size());
+				_retries.erase(_retries.begin());
+			}
+			ready = _ready.pop(record);
+			if (!ready) _readyCondition.tryWait(_mutex, 1000);
+		}
+		if (ready) apply(record);
+		if (checkpointDue()) checkpoint();
+	}
+}
+
+
+void JournalingImageStore::schedule(const Record& record)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	_ready.push(ImageKey::site(record.key), record, record.pData->size());
+	_readyCondition.signal();
+}
+
+
+void JournalingImageStore::apply(Record& record)
+{
+	try
+	{
+		std::istringstream istr(*record.pData);
+		_pTarget->store(record.key, istr);
+
+		// The record is released by the next checkpoint,
+		// once the image is durable in the target store.
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_pending.erase(record.key);
+		_applied.push_back(record.position);
+	}
+	catch (Poco::Exception& exc)
+	{
+		record.attempt++;
+		_logger.warning("Failed to store %s (attempt %d), retrying in %d seconds: %s"s, record.key, record.attempt, static_cast<int>(_retryDelay.totalSeconds()), exc.displayText());
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_retries.emplace(Poco::Timestamp() + _retryDelay.totalMicroseconds(), record);
+	}
+}
+
+
+bool JournalingImageStore::checkpointDue()
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	if (_syncing || _applied.empty() || !_lastSync.isElapsed(_syncInterval.totalMicroseconds())) return false;
+	_syncing = true;
+	return true;
+}
+
+
+void JournalingImageStore::checkpoint()
+{
+	std::vector<Journal::Position> positions;
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		positions.swap(_applied);
+	}
+
+	bool synced = positions.empty();
+	if (!synced)
+	{
+		try
+		{
+			_pTarget->sync();
+			synced = true;
+		}
+		catch (Poco::Exception& exc)
+		{
+			_logger.warning("Failed to sync the target store, keeping %z images in the journal: %s"s, positions.size(), exc.displayText());
+		}
+	}
+	if (synced)
+	{
+		for (const auto& position: positions)
+		{
+			_journal.release(position);
+		}
+	}
+
+	Poco::FastMutex::ScopedLock lock(_mutex);
+	if (!synced) _applied.insert(_applied.end(), positions.begin(), positions.end());
+	_lastSync.update();
+	_syncing = false;
+}
+
+
+void JournalingImageStore::replay(const std::string& key, const std::string& data)
+{
+	// An image stored but not synced before a crash
+	// may have been left incomplete.
+	Poco::UInt64 size = 0;
+	const bool stored = _pTarget->open(key, size) != nullptr && size == data.size();
+	if (!stored)
+	{
+		std::istringstream istr(data);
+		_pTarget->store(key, istr);
+	}
+}
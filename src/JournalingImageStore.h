@@ -0,0 +1,112 @@
+//
+// JournalingImageStore.h
+//
+// Definition of the JournalingImageStore class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef JournalingImageStore_INCLUDED
+#define JournalingImageStore_INCLUDED
+
+
+#include "ImageStore.h"
+#include "Journal.h"
+#include "DeficitRoundRobin.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Logger.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <map>
+
+
+class JournalingImageStore: public ImageStore, private Poco::Runnable
+	/// An ImageStore that stores images asynchronously, without
+	/// losing acknowledged images in a crash.
+	///
+	/// store() appends the image to a Journal and returns as soon
+	/// as the journal record is on stable storage, which usually
+	/// takes a single sequential write and a group-committed
+	/// fdatasync(). Background threads then store the image in the
+	/// target store. Every syncInterval, the target store is synced
+	/// (see ImageStore::sync()) and the journal records of the images
+	/// stored before are released. Records not yet released when the
+	/// server stops or crashes are replayed into the target store
+	/// by start().
+	///
+	/// Images are applied fairly across sites (deficit round-robin
+	/// weighted by image size), so that a backlog from a large site
+	/// does not delay the images of other sites.
+	///
+	/// Until they have been applied, images are kept in memory.
+	/// If more than maxPending images are waiting, store() writes
+	/// to the target store directly. Such images are not journaled
+	/// and only durable once the target store has been synced.
+{
+public:
+	using Ptr = Poco::SharedPtr<JournalingImageStore>;
+
+	JournalingImageStore(ImageStore::Ptr pTarget, const std::string& journalPath, Poco::UInt64 segmentSize, int threads, Poco::Timespan retryDelay, std::size_t maxPending, std::size_t quantum, Poco::Timespan syncInterval);
+		/// Creates the JournalingImageStore.
+
+	~JournalingImageStore();
+		/// Destroys the JournalingImageStore, stopping it if necessary.
+
+	std::size_t pending() const;
+		/// Returns the number of images not yet stored in the target store.
+
+	// ImageStore
+	std::string store(const std::string& key, std::istream& istr) override;
+	std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size) override;
+	bool exists(const std::string& key) override;
+	void list(const std::string& directory, std::vector<std::string>& names) override;
+	void start() override;
+	void stop() override;
+
+protected:
+	using DataPtr = std::shared_ptr<const std::string>;
+
+	struct Record
+	{
+		std::string key;
+		DataPtr pData;
+		Journal::Position position;
+		int attempt = 0;
+	};
+
+	void run() override;
+	void schedule(const Record& record);
+	void apply(Record& record);
+	bool checkpointDue();
+	void checkpoint();
+	void replay(const std::string& key, const std::string& data);
+
+private:
+
+	ImageStore::Ptr _pTarget;
+	Journal _journal;
+	int _threadCount;
+	Poco::Timespan _retryDelay;
+	std::size_t _maxPending;
+	Poco::Timespan _syncInterval;
+	DeficitRoundRobin<Record> _ready;
+	std::multimap<Poco::Timestamp, Record> _retries;
+	Poco::Condition _readyCondition;
+	std::vector<std::unique_ptr<Poco::Thread>> _threads;
+	std::atomic<bool> _stopped{true};
+	std::map<std::string, DataPtr> _pending;
+	std::vector<Journal::Position> _applied;
+	Poco::Timestamp _lastSync;
+	bool _syncing = false;
+	mutable Poco::FastMutex _mutex;
+	Poco::Logger& _logger;
+};
+
+
+#endif // JournalingImageStore_INCLUDED
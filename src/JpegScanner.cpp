@@ -0,0 +1,258 @@
+//
+// JpegScanner.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "JpegScanner.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JPEG_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const unsigned char* findFFScalar(const unsigned char* p, const unsigned char* end)
+	{
+		while (p < end && *p != 0xFF) p++;
+		return p;
+	}
+
+#ifdef JPEG_SCANNER_X86
+	__attribute__((target("sse2")))
+	const unsigned char* findFFSSE2(const unsigned char* p, const unsigned char* end)
+	{
+		const __m128i ff = _mm_set1_epi8(static_cast<char>(0xFF));
+		while (end - p >= 16)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, ff));
+			if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+			p += 16;
+		}
+		return findFFScalar(p, end);
+	}
+
+	__attribute__((target("avx2")))
+	const unsigned char* findFFAVX2(const unsigned char* p, const unsigned char* end)
+	{
+		const __m256i ff = _mm256_set1_epi8(static_cast<char>(0xFF));
+		// Two vectors per iteration; 0xFF bytes are rare, so the
+		// common case is a single test of both comparisons.
+		while (end - p >= 64)
+		{
+			const __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), ff);
+			const __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), ff);
+			if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)))
+			{
+				const unsigned maskA = static_cast<unsigned>(_mm256_movemask_epi8(a));
+				if (maskA) return p + __builtin_ctz(maskA);
+				return p + 32 + __builtin_ctz(static_cast<unsigned>(_mm256_movemask_epi8(b)));
+			}
+			p += 64;
+		}
+		while (end - p >= 32)
+		{
+			const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), ff)));
+			if (mask) return p + __builtin_ctz(mask);
+			p += 32;
+		}
+		return findFFScalar(p, end);
+	}
+#endif
+
+	using FindFF = const unsigned char* (*)(const unsigned char*, const unsigned char*);
+
+	FindFF findFFFunction(JpegScanner::Implementation impl)
+	{
+		switch (impl)
+		{
+#ifdef JPEG_SCANNER_X86
+		case JpegScanner::IMPL_AVX2:
+			return findFFAVX2;
+		case JpegScanner::IMPL_SSE2:
+			return findFFSSE2;
+#endif
+		default:
+			return findFFScalar;
+		}
+	}
+
+	JpegScanner::Implementation bestImplementation()
+	{
+#ifdef JPEG_SCANNER_X86
+		__builtin_cpu_init();
+#endif
+		if (JpegScanner::isSupported(JpegScanner::IMPL_AVX2)) return JpegScanner::IMPL_AVX2;
+		if (JpegScanner::isSupported(JpegScanner::IMPL_SSE2)) return JpegScanner::IMPL_SSE2;
+		return JpegScanner::IMPL_SCALAR;
+	}
+
+	FindFF selectedFindFF()
+	{
+		static const FindFF findFF = findFFFunction(JpegScanner::implementation());
+		return findFF;
+	}
+
+	bool isFrameMarker(unsigned char code)
+	{
+		return code >= JpegScanner::MARKER_SOF0 && code <= 0xCF
+			&& code != JpegScanner::MARKER_DHT
+			&& code != JpegScanner::MARKER_JPG
+			&& code != JpegScanner::MARKER_DAC;
+	}
+}
+
+
+const unsigned char* JpegScanner::findFF(const unsigned char* begin, const unsigned char* end)
+{
+	return selectedFindFF()(begin, end);
+}
+
+
+const unsigned char* JpegScanner::findFF(const unsigned char* begin, const unsigned char* end, Implementation impl)
+{
+	return findFFFunction(impl)(begin, end);
+}
+
+
+const unsigned char* JpegScanner::findMarker(const unsigned char* begin, const unsigned char* end)
+{
+	const FindFF findFF = selectedFindFF();
+	const unsigned char* p = begin;
+	while (p < end)
+	{
+		p = findFF(p, end);
+		if (end - p < 2) return end;
+
+		const unsigned char code = p[1];
+		if (code == 0x00 || (code >= MARKER_RST0 && code <= MARKER_RST7))
+			p += 2;
+		else if (code == 0xFF)
+			p += 1;
+		else
+			return p;
+	}
+	return end;
+}
+
+
+bool JpegScanner::isValid(const char* data, std::size_t size)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+	const unsigned char* end = p + size;
+	if (size < 4 || p[0] != 0xFF || p[1] != MARKER_SOI) return false;
+	p += 2;
+
+	bool frame = false;
+	bool scan = false;
+	for (;;)
+	{
+		// Markers may be preceded by fill bytes.
+		while (end - p >= 2 && p[0] == 0xFF && p[1] == 0xFF) p++;
+		if (end - p < 2 || p[0] != 0xFF) return false;
+
+		const unsigned char code = p[1];
+		p += 2;
+		if (code == MARKER_EOI) return scan;
+		if (code == MARKER_TEM) continue;
+		if (code == 0x00 || code == MARKER_SOI || (code >= MARKER_RST0 && code <= MARKER_RST7)) return false;
+
+		if (end - p < 2) return false;
+		const std::size_t length = (static_cast<std::size_t>(p[0]) << 8) | p[1];
+		if (length < 2 || static_cast<std::size_t>(end - p) < length) return false;
+		p += length;
+
+		if (isFrameMarker(code))
+		{
+			frame = true;
+		}
+		else if (code == MARKER_SOS)
+		{
+			if (!frame) return false;
+			scan = true;
+			p = findMarker(p, end);
+			if (p == end) return false;
+		}
+	}
+}
+
+
+bool JpegScanner::frameSize(const char* data, std::size_t size, int& width, int& height)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+	const unsigned char* end = p + size;
+	if (size < 4 || p[0] != 0xFF || p[1] != MARKER_SOI) return false;
+	p += 2;
+
+	for (;;)
+	{
+		while (end - p >= 2 && p[0] == 0xFF && p[1] == 0xFF) p++;
+		if (end - p < 4 || p[0] != 0xFF) return false;
+
+		const unsigned char code = p[1];
+		if (code == MARKER_EOI || code == MARKER_SOS) return false;
+		if (code == MARKER_TEM)
+		{
+			p += 2;
+			continue;
+		}
+
+		// Frame header: length, sample precision, height, width
+		const std::size_t length = (static_cast<std::size_t>(p[2]) << 8) | p[3];
+		if (length < 2 || static_cast<std::size_t>(end - p - 2) < length) return false;
+		if (isFrameMarker(code))
+		{
+			if (length < 7) return false;
+			height = (p[5] << 8) | p[6];
+			width = (p[7] << 8) | p[8];
+			return true;
+		}
+		p += 2 + length;
+	}
+}
+
+
+JpegScanner::Implementation JpegScanner::implementation()
+{
+	static const Implementation impl = bestImplementation();
+	return impl;
+}
+
+
+bool JpegScanner::isSupported(Implementation impl)
+{
+	switch (impl)
+	{
+	case IMPL_SCALAR:
+		return true;
+#ifdef JPEG_SCANNER_X86
+	case IMPL_SSE2:
+		return __builtin_cpu_supports("sse2");
+	case IMPL_AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+
+std::string JpegScanner::formatImplementation(Implementation impl)
+{
+	switch (impl)
+	{
+	case IMPL_SCALAR:
+		return "scalar"s;
+	case IMPL_SSE2:
+		return "sse2"s;
+	case IMPL_AVX2:
+		return "avx2"s;
+	}
+	return ""s;
+}
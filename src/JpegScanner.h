@@ -0,0 +1,99 @@
+//
+// JpegScanner.h
+//
+// Definition of the JpegScanner class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef JpegScanner_INCLUDED
+#define JpegScanner_INCLUDED
+
+
+#include "Poco/Types.h"
+#include <cstddef>
+#include <string>
+
+
+class JpegScanner
+	/// Finds markers in JPEG data and checks the structure
+	/// of JPEG images.
+	///
+	/// A JPEG marker is a 0xFF byte followed by a marker code. Most of an
+	/// image is entropy-coded data, in which 0xFF bytes are rare and
+	/// followed by 0x00 (byte stuffing), so finding markers amounts
+	/// to finding 0xFF bytes. This is done with SSE2 or AVX2 if supported
+	/// by the CPU (selected at run time), or with a byte-by-byte loop.
+{
+public:
+	enum Implementation
+	{
+		IMPL_SCALAR,
+			/// Byte-by-byte loop, available on all CPUs.
+		IMPL_SSE2,
+			/// 16 bytes at a time, x86 CPUs with SSE2.
+		IMPL_AVX2
+			/// 32 bytes at a time, x86 CPUs with AVX2.
+	};
+
+	enum Marker
+	{
+		MARKER_SOF0 = 0xC0,
+		MARKER_DHT  = 0xC4,
+		MARKER_JPG  = 0xC8,
+		MARKER_DAC  = 0xCC,
+		MARKER_RST0 = 0xD0,
+		MARKER_RST7 = 0xD7,
+		MARKER_SOI  = 0xD8,
+		MARKER_EOI  = 0xD9,
+		MARKER_SOS  = 0xDA,
+		MARKER_APP0 = 0xE0,
+		MARKER_APP1 = 0xE1,
+		MARKER_TEM  = 0x01
+	};
+
+	static const unsigned char* findFF(const unsigned char* begin, const unsigned char* end);
+		/// Returns a pointer to the first 0xFF byte in [begin, end),
+		/// or end if there is none, using the best implementation
+		/// supported by the CPU.
+
+	static const unsigned char* findFF(const unsigned char* begin, const unsigned char* end, Implementation impl);
+		/// Returns a pointer to the first 0xFF byte in [begin, end),
+		/// or end if there is none, using the given implementation,
+		/// which must be supported by the CPU.
+
+	static const unsigned char* findMarker(const unsigned char* begin, const unsigned char* end);
+		/// Returns a pointer to the first marker in entropy-coded data
+		/// in [begin, end), skipping stuffed 0xFF bytes, fill bytes
+		/// and restart markers, or end if there is none.
+
+	static bool isValid(const char* data, std::size_t size);
+		/// Returns true if data is a structurally well-formed JPEG
+		/// image: a start of image marker, a frame header, segments
+		/// with valid lengths, at least one scan, and an end of image
+		/// marker. Data following the end of image marker is ignored.
+		/// The entropy-coded data itself is not decoded.
+
+	static bool frameSize(const char* data, std::size_t size, int& width, int& height);
+		/// Extracts the width and height of the image from the frame
+		/// header. Returns false if there is no frame header before
+		/// the first scan.
+
+	static Implementation implementation();
+		/// Returns the implementation used by findFF().
+
+	static bool isSupported(Implementation impl);
+		/// Returns true if the given implementation is
+		/// supported by the CPU.
+
+	static std::string formatImplementation(Implementation impl);
+		/// Returns the name of the given implementation
+		/// ("scalar", "sse2" or "avx2").
+
+private:
+	JpegScanner() = delete;
+};
+
+
+#endif // JpegScanner_INCLUDED
@@ -0,0 +1,262 @@
+//
+// Outbox.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "Outbox.h"
+#include "ImageKey.h"
+#include "Poco/Notification.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const std::string TMP_SUFFIX(".tmp");
+
+	void syncPath(const std::string& path, int flags)
+	{
+		const int fd = ::open(path.c_str(), flags | O_RDONLY | O_CLOEXEC);
+		if (fd == -1) throw Poco::WriteFileException(path, Poco::Error::getMessage(errno));
+		const int rc = ::fsync(fd);
+		const int err = errno;
+		::close(fd);
+		if (rc != 0) throw Poco::WriteFileException(path, Poco::Error::getMessage(err));
+	}
+
+	class OutboxNotification: public Poco::Notification
+	{
+	public:
+		using Ptr = Poco::AutoPtr<OutboxNotification>;
+
+		OutboxNotification(const std::string& key, int attempt):
+			_key(key),
+			_attempt(attempt)
+		{
+		}
+
+		const std::string& key() const
+		{
+			return _key;
+		}
+
+		int attempt() const
+		{
+			return _attempt;
+		}
+
+	private:
+		std::string _key;
+		int _attempt;
+	};
+}
+
+
+Outbox::Delivery::~Delivery()
+{
+}
+
+
+Outbox::Outbox(const std::string& name, FileImageStore::Ptr pStore, Delivery& delivery, int threads, Poco::Timespan retryDelay, Poco::Timespan maxRetryDelay):
+	_name(name),
+	_pStore(pStore),
+	_delivery(delivery),
+	_threadCount(threads > 0 ? threads : 1),
+	_retryDelay(retryDelay),
+	_maxRetryDelay(maxRetryDelay),
+	_logger(Poco::Logger::get(name))
+{
+}
+
+
+Outbox::~Outbox()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+std::string Outbox::add(const std::string& key, std::istream& istr)
+{
+	const std::string tmpKey = key + TMP_SUFFIX;
+	try
+	{
+		_pStore->store(tmpKey, istr);
+	}
+	catch (Poco::CreateFileException&)
+	{
+		// the hour directory may just have been removed by a worker
+		_pStore->store(tmpKey, istr);
+	}
+
+	const std::string path = _pStore->path(key);
+	const bool existed = _pStore->exists(key);
+	try
+	{
+		syncPath(_pStore->path(tmpKey), 0);
+	}
+	catch (Poco::Exception&)
+	{
+		_pStore->remove(tmpKey);
+		throw;
+	}
+	if (::rename(_pStore->path(tmpKey).c_str(), path.c_str()) != 0)
+	{
+		int err = errno;
+		_pStore->remove(tmpKey);
+		throw Poco::WriteFileException(path, Poco::Error::getMessage(err));
+	}
+
+	// Make the new directory entry durable, including the entries of
+	// directories created for it. Syncing an unchanged directory is cheap.
+	std::string directory = ImageKey::directory(key);
+	while (!directory.empty())
+	{
+		syncPath(_pStore->root() + directory, O_DIRECTORY);
+		directory = ImageKey::directory(directory);
+	}
+	syncPath(_pStore->root(), O_DIRECTORY);
+	if (!existed)
+	{
+		++_pending;
+		enqueue(key, 0, Poco::Timestamp());
+	}
+	return path;
+}
+
+
+std::unique_ptr<std::istream> Outbox::open(const std::string& key, Poco::UInt64& size)
+{
+	return _pStore->open(key, size);
+}
+
+
+bool Outbox::contains(const std::string& key)
+{
+	return _pStore->exists(key);
+}
+
+
+void Outbox::start()
+{
+	_queue.clear();
+	_pending = 0;
+	recover(std::string(), 0);
+
+	_stopped = false;
+	for (int i = 0; i < _threadCount; i++)
+	{
+		_threads.push_back(std::make_unique<Poco::Thread>(_name));
+		_threads.back()->start(*this);
+	}
+}
+
+
+void Outbox::stop()
+{
+	_stopped = true;
+	for (auto& pThread: _threads)
+	{
+		pThread->join();
+	}
+	_threads.clear();
+}
+
+
+void Outbox::run()
+{
+	while (!_stopped)
+	{
+		Poco::AutoPtr<Poco::Notification> pNf(_queue.waitDequeueNotification(1000));
+		if (pNf)
+		{
+			OutboxNotification::Ptr pOutboxNf = pNf.cast<OutboxNotification>();
+			if (pOutboxNf)
+			{
+				deliver(pOutboxNf->key(), pOutboxNf->attempt());
+			}
+		}
+	}
+}
+
+
+void Outbox::enqueue(const std::string& key, int attempt, const Poco::Timestamp& due)
+{
+	_queue.enqueueNotification(new OutboxNotification(key, attempt), due);
+}
+
+
+void Outbox::deliver(const std::string& key, int attempt)
+{
+	Poco::UInt64 size = 0;
+	auto pStream = _pStore->open(key, size);
+	if (!pStream)
+	{
+		--_pending;
+		return;
+	}
+
+	try
+	{
+		_delivery.deliver(key, *pStream, size);
+		pStream.reset();
+		_pStore->remove(key);
+		::rmdir((_pStore->root() + ImageKey::directory(key)).c_str());
+		--_pending;
+	}
+	catch (Poco::Exception& exc)
+	{
+		Poco::Timespan::TimeDiff delay = _retryDelay.totalMicroseconds() << (attempt < 16 ? attempt : 16);
+		if (delay > _maxRetryDelay.totalMicroseconds() || delay <= 0) delay = _maxRetryDelay.totalMicroseconds();
+		_logger.warning("Delivery of %s failed (attempt %d), retrying in %d seconds: %s"s, key, attempt + 1, static_cast<int>(delay/Poco::Timespan::SECONDS), exc.displayText());
+		enqueue(key, attempt + 1, Poco::Timestamp() + delay);
+	}
+}
+
+
+void Outbox::recover(const std::string& directory, int depth)
+{
+	// site/camera/YYYY/MM/DD/HH/file
+	const int HOUR_DEPTH = 6;
+
+	Poco::File dir(_pStore->root() + directory);
+	if (!dir.exists()) return;
+
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(dir); it != end; ++it)
+	{
+		const std::string name = directory.empty() ? it.name() : directory + '/' + it.name();
+		if (depth < HOUR_DEPTH && it->isDirectory())
+		{
+			recover(name, depth + 1);
+		}
+		else if (depth == HOUR_DEPTH && it->isFile())
+		{
+			if (name.size() > TMP_SUFFIX.size() && name.compare(name.size() - TMP_SUFFIX.size(), TMP_SUFFIX.size(), TMP_SUFFIX) == 0)
+			{
+				_pStore->remove(name);
+			}
+			else
+			{
+				++_pending;
+				enqueue(name, 0, Poco::Timestamp());
+			}
+		}
+	}
+}
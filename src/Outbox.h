@@ -0,0 +1,104 @@
+//
+// Outbox.h
+//
+// Definition of the Outbox class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef Outbox_INCLUDED
+#define Outbox_INCLUDED
+
+
+#include "FileImageStore.h"
+#include "Poco/TimedNotificationQueue.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Logger.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+class Outbox: public Poco::Runnable
+	/// Outbox is a durable queue of images pending delivery
+	/// to a remote destination.
+	///
+	/// Every pending image is kept as a file in a local FileImageStore
+	/// until it has been delivered, so pending images survive a restart.
+	/// add() syncs the file and its directories before it returns.
+	/// A fixed number of worker threads deliver images via a Delivery
+	/// object. Failed deliveries are retried with exponential backoff.
+{
+public:
+	class Delivery
+		/// Delivers images from an Outbox to their destination.
+	{
+	public:
+		virtual ~Delivery();
+
+		virtual void deliver(const std::string& key, std::istream& istr, Poco::UInt64 size) = 0;
+			/// Delivers the image with the given key.
+			/// Must throw a Poco::Exception if delivery fails.
+	};
+
+	Outbox(const std::string& name, FileImageStore::Ptr pStore, Delivery& delivery, int threads, Poco::Timespan retryDelay, Poco::Timespan maxRetryDelay);
+		/// Creates the Outbox, keeping pending images in the given store.
+
+	~Outbox();
+		/// Destroys the Outbox, stopping it if necessary.
+
+	std::string add(const std::string& key, std::istream& istr);
+		/// Stores the image data from istr in the outbox and
+		/// queues it for delivery. The outbox file is on stable storage
+		/// when add() returns. Returns the path of the outbox file.
+
+	std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size);
+		/// Opens a pending image. Returns a null pointer if the
+		/// image is not (or no longer) pending.
+
+	bool contains(const std::string& key);
+		/// Returns true if the image with the given key is pending.
+
+	int pending() const;
+		/// Returns the number of pending images.
+
+	void start();
+		/// Queues all images found in the outbox directory
+		/// and starts the worker threads.
+
+	void stop();
+		/// Stops the worker threads. Pending images are kept.
+
+protected:
+	void run();
+	void enqueue(const std::string& key, int attempt, const Poco::Timestamp& due);
+	void deliver(const std::string& key, int attempt);
+	void recover(const std::string& directory, int depth);
+
+private:
+	std::string _name;
+	FileImageStore::Ptr _pStore;
+	Delivery& _delivery;
+	int _threadCount;
+	Poco::Timespan _retryDelay;
+	Poco::Timespan _maxRetryDelay;
+	Poco::TimedNotificationQueue _queue;
+	std::vector<std::unique_ptr<Poco::Thread>> _threads;
+	std::atomic<bool> _stopped{true};
+	std::atomic<int> _pending{0};
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline int Outbox::pending() const
+{
+	return _pending;
+}
+
+
+#endif // Outbox_INCLUDED
@@ -0,0 +1,103 @@
+//
+// ProxyRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ProxyRequestHandler.h"
+#include "ShardRing.h"
+#include "ImageUploadRequestHandler.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Util/Application.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/String.h"
+#include "Poco/Exception.h"
+
+
+using namespace std::string_literals;
+
+
+ProxyRequestHandler::ProxyRequestHandler(HTTPSessionPool& sessionPool):
+	_sessionPool(sessionPool)
+{
+}
+
+
+ProxyRequestHandler::~ProxyRequestHandler()
+{
+}
+
+
+void ProxyRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	auto& app = Poco::Util::Application::instance();
+
+	try
+	{
+		Poco::Net::HTTPRequest proxyRequest(request.getMethod(), request.getURI(), Poco::Net::HTTPMessage::HTTP_1_1);
+		for (const auto& header: request)
+		{
+			if (!isHopByHopHeader(header.first) && Poco::icompare(header.first, "Host"s) != 0)
+			{
+				proxyRequest.add(header.first, header.second);
+			}
+		}
+		proxyRequest.setHost(_sessionPool.hostHeader());
+		proxyRequest.set(ShardRing::FORWARDED_HEADER, request.clientAddress().host().toString());
+		if (request.hasContentLength())
+			proxyRequest.setContentLength64(request.getContentLength64());
+		else if (request.getChunkedTransferEncoding())
+			proxyRequest.setChunkedTransferEncoding(true);
+
+		HTTPSessionPool::SessionPtr pSession = _sessionPool.get();
+		std::ostream& ostr = pSession->sendRequest(proxyRequest);
+		Poco::StreamCopier::copyStream64(request.stream(), ostr);
+
+		Poco::Net::HTTPResponse proxyResponse;
+		std::istream& istr = pSession->receiveResponse(proxyResponse);
+
+		response.setStatusAndReason(proxyResponse.getStatus(), proxyResponse.getReason());
+		for (const auto& header: proxyResponse)
+		{
+			if (!isHopByHopHeader(header.first))
+			{
+				response.set(header.first, header.second);
+			}
+		}
+		if (proxyResponse.hasContentLength())
+			response.setContentLength64(proxyResponse.getContentLength64());
+		else
+			response.setChunkedTransferEncoding(true);
+
+		Poco::StreamCopier::copyStream64(istr, response.send());
+		if (proxyResponse.getKeepAlive())
+		{
+			_sessionPool.release(std::move(pSession));
+		}
+	}
+	catch (Poco::Exception& exc)
+	{
+		app.logger().error("Failed to forward %s %s to %s: %s"s, request.getMethod(), request.getURI(), _sessionPool.hostHeader(), exc.displayText());
+		if (!response.sent())
+		{
+			response.setKeepAlive(false);
+			ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_GATEWAY, "Owner node not reachable"s);
+		}
+	}
+}
+
+
+bool ProxyRequestHandler::isHopByHopHeader(const std::string& name)
+{
+	return Poco::icompare(name, "Connection"s) == 0
+		|| Poco::icompare(name, "Keep-Alive"s) == 0
+		|| Poco::icompare(name, "Transfer-Encoding"s) == 0
+		|| Poco::icompare(name, "Content-Length"s) == 0
+		|| Poco::icompare(name, "Expect"s) == 0
+		|| Poco::icompare(name, "Proxy-Connection"s) == 0
+		|| Poco::icompare(name, "TE"s) == 0
+		|| Poco::icompare(name, "Trailer"s) == 0
+		|| Poco::icompare(name, "Upgrade"s) == 0;
+}
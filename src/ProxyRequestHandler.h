@@ -0,0 +1,46 @@
+//
+// ProxyRequestHandler.h
+//
+// Definition of the ProxyRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ProxyRequestHandler_INCLUDED
+#define ProxyRequestHandler_INCLUDED
+
+
+#include "HTTPSessionPool.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+
+class ProxyRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Forwards a request to another node and relays its response.
+	///
+	/// Forwarded requests carry the ShardRing::FORWARDED_HEADER,
+	/// so that the receiving node always handles them locally.
+{
+public:
+	ProxyRequestHandler(HTTPSessionPool& sessionPool);
+		/// Creates the ProxyRequestHandler, using sessions
+		/// from the given pool.
+
+	~ProxyRequestHandler();
+		/// Destroys the ProxyRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+	static bool isHopByHopHeader(const std::string& name);
+		/// Returns true if the header with the given name applies
+		/// to a single connection or describes the message framing,
+		/// and therefore must not be copied to the forwarded message.
+
+private:
+	HTTPSessionPool& _sessionPool;
+};
+
+
+#endif // ProxyRequestHandler_INCLUDED
@@ -0,0 +1,35 @@
+//
+// RedirectRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "RedirectRequestHandler.h"
+#include "Poco/Util/Application.h"
+
+
+using namespace std::string_literals;
+
+
+RedirectRequestHandler::RedirectRequestHandler(const std::string& address):
+	_address(address)
+{
+}
+
+
+RedirectRequestHandler::~RedirectRequestHandler()
+{
+}
+
+
+void RedirectRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	auto& app = Poco::Util::Application::instance();
+	app.logger().debug("Redirecting %s %s to %s."s, request.getMethod(), request.getURI(), _address);
+
+	// The request body is not read, so the connection
+	// cannot be used for further requests.
+	response.setKeepAlive(false);
+	response.redirect("http://"s + _address + request.getURI(), Poco::Net::HTTPResponse::HTTP_TEMPORARY_REDIRECT);
+}
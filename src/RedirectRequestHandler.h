@@ -0,0 +1,40 @@
+//
+// RedirectRequestHandler.h
+//
+// Definition of the RedirectRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef RedirectRequestHandler_INCLUDED
+#define RedirectRequestHandler_INCLUDED
+
+
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include <string>
+
+
+class RedirectRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Redirects a request to the same URI on another node,
+	/// using 307 Temporary Redirect so that clients repeat
+	/// the request with the same method and body.
+{
+public:
+	RedirectRequestHandler(const std::string& address);
+		/// Creates the RedirectRequestHandler for the node
+		/// with the given address (host:port).
+
+	~RedirectRequestHandler();
+		/// Destroys the RedirectRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+private:
+	std::string _address;
+};
+
+
+#endif // RedirectRequestHandler_INCLUDED
@@ -0,0 +1,206 @@
+//
+// ReplicatingImageStore.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ReplicatingImageStore.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/NullStream.h"
+#include "Poco/Format.h"
+#include <streambuf>
+#include <vector>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const std::size_t MAX_TEE_SIZE = 16*1024*1024;
+
+	class TeeStreamBuf: public std::streambuf
+		/// Reads from another stream, keeping a copy of the data
+		/// read, up to a maximum size.
+	{
+	public:
+		TeeStreamBuf(std::istream& istr, std::size_t maxSize):
+			_istr(istr),
+			_buffer(65536),
+			_maxSize(maxSize)
+		{
+		}
+
+		const std::string& data() const
+		{
+			return _data;
+		}
+
+		bool complete() const
+		{
+			return !_overflow;
+		}
+
+	protected:
+		int_type underflow() override
+		{
+			if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+			_istr.read(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+			const std::size_t n = static_cast<std::size_t>(_istr.gcount());
+			if (_istr.bad()) throw Poco::IOException("Error reading image data"s);
+			if (n == 0) return traits_type::eof();
+
+			if (!_overflow && _data.size() + n <= _maxSize)
+			{
+				_data.append(_buffer.data(), n);
+			}
+			else if (!_overflow)
+			{
+				_overflow = true;
+				std::string().swap(_data);
+			}
+			setg(_buffer.data(), _buffer.data(), _buffer.data() + n);
+			return traits_type::to_int_type(*gptr());
+		}
+
+	private:
+		std::istream& _istr;
+		std::vector<char> _buffer;
+		const std::size_t _maxSize;
+		std::string _data;
+		bool _overflow = false;
+	};
+}
+
+
+const std::string ReplicatingImageStore::REPLICA_KEY_HEADER("X-Replica-Key");
+
+
+ReplicatingImageStore::ReplicatingImageStore(ImageStore::Ptr pPrimary, const Poco::URI& peer, const std::string& token, FileImageStore::Ptr pOutboxStore, int connections, Poco::Timespan timeout, Poco::Timespan retryDelay, Poco::Timespan maxRetryDelay):
+	_pPrimary(pPrimary),
+	_peerPath(peer.getPath()),
+	_token(token),
+	_sessionPool(peer.getHost(), peer.getPort(), timeout, connections),
+	_outbox("ReplicatingImageStore"s, pOutboxStore, *this, connections, retryDelay, maxRetryDelay),
+	_logger(Poco::Logger::get("ReplicatingImageStore"s))
+{
+	if (_peerPath.empty() || _peerPath == "/") _peerPath = "/replica"s;
+	if (_peerPath.back() == '/') _peerPath.pop_back();
+}
+
+
+ReplicatingImageStore::~ReplicatingImageStore()
+{
+}
+
+
+std::string ReplicatingImageStore::store(const std::string& key, std::istream& istr)
+{
+	// The image is copied while the primary store reads it, so
+	// that it does not have to be read back for the outbox.
+	TeeStreamBuf streamBuf(istr, MAX_TEE_SIZE);
+	std::istream teeStream(&streamBuf);
+	std::string path = _pPrimary->store(key, teeStream);
+
+	// The image has been stored and will be acknowledged to the
+	// camera, so a failure to queue it for replication must not
+	// fail the upload.
+	try
+	{
+		if (streamBuf.complete())
+		{
+			Poco::MemoryInputStream dataStream(streamBuf.data().data(), streamBuf.data().size());
+			_outbox.add(key, dataStream);
+		}
+		else
+		{
+			// Very large images are not kept in memory.
+			Poco::UInt64 size;
+			auto pStream = _pPrimary->open(key, size);
+			if (pStream)
+			{
+				_outbox.add(key, *pStream);
+			}
+		}
+	}
+	catch (Poco::Exception& exc)
+	{
+		_logger.error("Failed to queue %s for replication: %s"s, key, exc.displayText());
+	}
+	return path;
+}
+
+
+std::unique_ptr<std::istream> ReplicatingImageStore::open(const std::string& key, Poco::UInt64& size)
+{
+	return _pPrimary->open(key, size);
+}
+
+
+bool ReplicatingImageStore::exists(const std::string& key)
+{
+	return _pPrimary->exists(key);
+}
+
+
+void ReplicatingImageStore::list(const std::string& directory, std::vector<std::string>& names)
+{
+	_pPrimary->list(directory, names);
+}
+
+
+void ReplicatingImageStore::sync()
+{
+	_pPrimary->sync();
+}
+
+
+void ReplicatingImageStore::start()
+{
+	_pPrimary->start();
+	_outbox.start();
+}
+
+
+void ReplicatingImageStore::stop()
+{
+	_outbox.stop();
+	_pPrimary->stop();
+}
+
+
+void ReplicatingImageStore::deliver(const std::string& key, std::istream& istr, Poco::UInt64 size)
+{
+	// <site>/<camera>/...
+	const auto siteEnd = key.find('/');
+	const auto cameraEnd = key.find('/', siteEnd + 1);
+
+	Poco::URI uri;
+	uri.setPath(_peerPath + '/' + key.substr(0, cameraEnd));
+	uri.addQueryParameter("token"s, _token);
+
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_POST, uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+	request.setContentType("image/jpeg"s);
+	request.setContentLength64(static_cast<Poco::Int64>(size));
+	request.set(REPLICA_KEY_HEADER, key);
+
+	HTTPSessionPool::SessionPtr pSession = _sessionPool.get();
+	std::ostream& ostr = pSession->sendRequest(request);
+	Poco::StreamCopier::copyStream64(istr, ostr);
+
+	Poco::Net::HTTPResponse response;
+	std::istream& rs = pSession->receiveResponse(response);
+	Poco::NullOutputStream nullStream;
+	Poco::StreamCopier::copyStream(rs, nullStream);
+	if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_OK)
+	{
+		throw Poco::Net::HTTPException(Poco::format("Peer rejected %s with status %d %s"s, key, static_cast<int>(response.getStatus()), response.getReason()));
+	}
+	_sessionPool.release(std::move(pSession));
+}
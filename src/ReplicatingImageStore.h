@@ -0,0 +1,84 @@
+//
+// ReplicatingImageStore.h
+//
+// Definition of the ReplicatingImageStore class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ReplicatingImageStore_INCLUDED
+#define ReplicatingImageStore_INCLUDED
+
+
+#include "ImageStore.h"
+#include "HTTPSessionPool.h"
+#include "Outbox.h"
+#include "Poco/URI.h"
+
+
+class ReplicatingImageStore: public ImageStore, private Outbox::Delivery
+	/// An ImageStore that forwards every stored image to a peer
+	/// AxisCameraUpload server, so that cameras need to upload
+	/// an image only once for redundant storage.
+	///
+	/// Images are stored in a primary ImageStore. The image data is
+	/// copied while the primary store reads it, and once stored, the
+	/// copy is added to a local Outbox, from which it is sent to the
+	/// peer asynchronously over persistent connections.
+	///
+	/// Replicated images are posted to the peer with the image key in
+	/// the X-Replica-Key header. The peer stores the image under the
+	/// same key, and ignores images it already has, so retried
+	/// deliveries do not result in duplicate images.
+{
+public:
+	using Ptr = Poco::SharedPtr<ReplicatingImageStore>;
+
+	static const std::string REPLICA_KEY_HEADER;
+
+	ReplicatingImageStore(ImageStore::Ptr pPrimary, const Poco::URI& peer, const std::string& token, FileImageStore::Ptr pOutboxStore, int connections, Poco::Timespan timeout, Poco::Timespan retryDelay, Poco::Timespan maxRetryDelay);
+		/// Creates the ReplicatingImageStore.
+		///
+		/// The peer URI gives the host, port and path prefix
+		/// of the peer server (e.g., http://peer:9980/upload).
+
+	~ReplicatingImageStore();
+		/// Destroys the ReplicatingImageStore.
+
+	int pending() const;
+		/// Returns the number of images not yet sent to the peer.
+
+	// ImageStore
+	std::string store(const std::string& key, std::istream& istr) override;
+	std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size) override;
+	bool exists(const std::string& key) override;
+	void list(const std::string& directory, std::vector<std::string>& names) override;
+	void sync() override;
+	void start() override;
+	void stop() override;
+
+protected:
+	// Outbox::Delivery
+	void deliver(const std::string& key, std::istream& istr, Poco::UInt64 size) override;
+
+private:
+	ImageStore::Ptr _pPrimary;
+	std::string _peerPath;
+	std::string _token;
+	HTTPSessionPool _sessionPool;
+	Outbox _outbox;
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline int ReplicatingImageStore::pending() const
+{
+	return _outbox.pending();
+}
+
+
+#endif // ReplicatingImageStore_INCLUDED
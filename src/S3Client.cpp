@@ -0,0 +1,201 @@
+//
+// S3Client.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "S3Client.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Net/NetException.h"
+#include "Poco/HMACEngine.h"
+#include "Poco/SHA2Engine.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/Format.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Ascii.h"
+#include "Poco/URI.h"
+
+
+using namespace std::string_literals;
+
+
+S3Client::S3Client(const Params& params):
+	_params(params)
+{
+	Poco::URI uri(params.endpoint);
+	if (uri.getScheme() != "http")
+	{
+		throw Poco::NotImplementedException("Unsupported object store endpoint (only http is supported)"s, params.endpoint);
+	}
+	_pSessionPool = std::make_unique<HTTPSessionPool>(uri.getHost(), uri.getPort(), params.timeout, params.maxIdleConnections);
+	_hostHeader = _pSessionPool->hostHeader();
+}
+
+
+S3Client::~S3Client()
+{
+}
+
+
+void S3Client::putObject(const std::string& objectKey, std::istream& istr, Poco::UInt64 size, const std::string& contentType)
+{
+	const std::string path = "/"s + _params.bucket + "/"s + encodePath(objectKey);
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_PUT, path, Poco::Net::HTTPMessage::HTTP_1_1);
+	request.setContentType(contentType);
+	request.setContentLength64(static_cast<Poco::Int64>(size));
+	sign(request, path);
+
+	HTTPSessionPool::SessionPtr pSession = _pSessionPool->get();
+	std::ostream& ostr = pSession->sendRequest(request);
+	Poco::StreamCopier::copyStream64(istr, ostr);
+
+	Poco::Net::HTTPResponse response;
+	std::istream& rs = pSession->receiveResponse(response);
+	std::string body;
+	Poco::StreamCopier::copyToString(rs, body);
+	if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_OK)
+	{
+		throw Poco::Net::HTTPException(Poco::format("PUT %s failed with status %d %s"s, objectKey, static_cast<int>(response.getStatus()), response.getReason()));
+	}
+	_pSessionPool->release(std::move(pSession));
+}
+
+
+bool S3Client::getObject(const std::string& objectKey, std::string& data)
+{
+	const std::string path = "/"s + _params.bucket + "/"s + encodePath(objectKey);
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, path, Poco::Net::HTTPMessage::HTTP_1_1);
+	sign(request, path);
+
+	HTTPSessionPool::SessionPtr pSession = _pSessionPool->get();
+	pSession->sendRequest(request);
+
+	Poco::Net::HTTPResponse response;
+	std::istream& rs = pSession->receiveResponse(response);
+	std::string body;
+	Poco::StreamCopier::copyToString(rs, body);
+	if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK)
+	{
+		data.swap(body);
+		_pSessionPool->release(std::move(pSession));
+		return true;
+	}
+	else if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_NOT_FOUND)
+	{
+		_pSessionPool->release(std::move(pSession));
+		return false;
+	}
+	throw Poco::Net::HTTPException(Poco::format("GET %s failed with status %d %s"s, objectKey, static_cast<int>(response.getStatus()), response.getReason()));
+}
+
+
+bool S3Client::headObject(const std::string& objectKey)
+{
+	const std::string path = "/"s + _params.bucket + "/"s + encodePath(objectKey);
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_HEAD, path, Poco::Net::HTTPMessage::HTTP_1_1);
+	sign(request, path);
+
+	HTTPSessionPool::SessionPtr pSession = _pSessionPool->get();
+	pSession->sendRequest(request);
+
+	Poco::Net::HTTPResponse response;
+	pSession->receiveResponse(response);
+	if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK || response.getStatus() == Poco::Net::HTTPResponse::HTTP_NOT_FOUND)
+	{
+		_pSessionPool->release(std::move(pSession));
+		return response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK;
+	}
+	throw Poco::Net::HTTPException(Poco::format("HEAD %s failed with status %d %s"s, objectKey, static_cast<int>(response.getStatus()), response.getReason()));
+}
+
+
+void S3Client::sign(Poco::Net::HTTPRequest& request, const std::string& canonicalPath) const
+{
+	static const std::string PAYLOAD_HASH("UNSIGNED-PAYLOAD");
+	static const std::string SIGNED_HEADERS("host;x-amz-content-sha256;x-amz-date");
+
+	const std::string amzDate = Poco::DateTimeFormatter::format(Poco::Timestamp(), "%Y%m%dT%H%M%SZ"s);
+	const std::string date = amzDate.substr(0, 8);
+	const std::string scope = date + "/"s + _params.region + "/s3/aws4_request"s;
+
+	request.setHost(_hostHeader);
+	request.set("x-amz-date"s, amzDate);
+	request.set("x-amz-content-sha256"s, PAYLOAD_HASH);
+
+	std::string canonicalRequest;
+	canonicalRequest += request.getMethod();
+	canonicalRequest += '\n';
+	canonicalRequest += canonicalPath;
+	canonicalRequest += "\n\n"; // no query string
+	canonicalRequest += "host:"s + _hostHeader + '\n';
+	canonicalRequest += "x-amz-content-sha256:"s + PAYLOAD_HASH + '\n';
+	canonicalRequest += "x-amz-date:"s + amzDate + "\n\n"s;
+	canonicalRequest += SIGNED_HEADERS;
+	canonicalRequest += '\n';
+	canonicalRequest += PAYLOAD_HASH;
+
+	std::string stringToSign("AWS4-HMAC-SHA256\n");
+	stringToSign += amzDate;
+	stringToSign += '\n';
+	stringToSign += scope;
+	stringToSign += '\n';
+	stringToSign += sha256Hex(canonicalRequest);
+
+	std::string signingKey = hmac("AWS4"s + _params.secretKey, date);
+	signingKey = hmac(signingKey, _params.region);
+	signingKey = hmac(signingKey, "s3"s);
+	signingKey = hmac(signingKey, "aws4_request"s);
+	const std::string signature = hmac(signingKey, stringToSign);
+
+	std::string authorization("AWS4-HMAC-SHA256 Credential=");
+	authorization += _params.accessKey;
+	authorization += '/';
+	authorization += scope;
+	authorization += ", SignedHeaders=";
+	authorization += SIGNED_HEADERS;
+	authorization += ", Signature=";
+	authorization += Poco::DigestEngine::digestToHex(Poco::DigestEngine::Digest(signature.begin(), signature.end()));
+	request.set("Authorization"s, authorization);
+}
+
+
+std::string S3Client::hmac(const std::string& key, const std::string& data)
+{
+	Poco::HMACEngine<Poco::SHA2Engine256> engine(key);
+	engine.update(data);
+	const Poco::DigestEngine::Digest& digest = engine.digest();
+	return std::string(digest.begin(), digest.end());
+}
+
+
+std::string S3Client::sha256Hex(const std::string& data)
+{
+	Poco::SHA2Engine engine(Poco::SHA2Engine::SHA_256);
+	engine.update(data);
+	return Poco::DigestEngine::digestToHex(engine.digest());
+}
+
+
+std::string S3Client::encodePath(const std::string& path)
+{
+	static const char HEX[] = "0123456789ABCDEF";
+
+	std::string encoded;
+	encoded.reserve(path.size());
+	for (unsigned char c: path)
+	{
+		if (Poco::Ascii::isAlphaNumeric(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/')
+		{
+			encoded += static_cast<char>(c);
+		}
+		else
+		{
+			encoded += '%';
+			encoded += HEX[c >> 4];
+			encoded += HEX[c & 0x0F];
+		}
+	}
+	return encoded;
+}
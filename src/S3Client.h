@@ -0,0 +1,88 @@
+//
+// S3Client.h
+//
+// Definition of the S3Client class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef S3Client_INCLUDED
+#define S3Client_INCLUDED
+
+
+#include "HTTPSessionPool.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Timespan.h"
+#include <memory>
+#include <string>
+
+
+class S3Client
+	/// A minimal client for S3-compatible object stores (e.g., MinIO),
+	/// supporting the PUT, GET and HEAD object operations with path-style
+	/// bucket addressing and AWS Signature Version 4.
+	///
+	/// S3Client keeps a pool of persistent (keep-alive) HTTP connections
+	/// to the object store, so that uploading many small objects does
+	/// not require a new connection for every request.
+	///
+	/// S3Client is thread-safe.
+{
+public:
+	struct Params
+	{
+		std::string endpoint;        /// e.g. "http://localhost:9000"
+		std::string region = "us-east-1";
+		std::string bucket;
+		std::string accessKey;
+		std::string secretKey;
+		Poco::Timespan timeout = Poco::Timespan(30, 0);
+		int maxIdleConnections = 8;
+	};
+
+	explicit S3Client(const Params& params);
+		/// Creates the S3Client.
+
+	~S3Client();
+		/// Destroys the S3Client and closes all pooled connections.
+
+	void putObject(const std::string& objectKey, std::istream& istr, Poco::UInt64 size, const std::string& contentType);
+		/// Uploads size bytes from istr to the object with the given key.
+		/// Throws a Poco::Net::HTTPException if the request fails.
+
+	bool getObject(const std::string& objectKey, std::string& data);
+		/// Downloads the object with the given key into data.
+		/// Returns false if the object does not exist.
+
+	bool headObject(const std::string& objectKey);
+		/// Returns true if the object with the given key exists.
+
+	const std::string& bucket() const;
+		/// Returns the name of the bucket.
+
+	static std::string encodePath(const std::string& path);
+		/// URI-encodes a path as required for SigV4 canonical requests.
+
+protected:
+	void sign(Poco::Net::HTTPRequest& request, const std::string& canonicalPath) const;
+	static std::string hmac(const std::string& key, const std::string& data);
+	static std::string sha256Hex(const std::string& data);
+
+private:
+	Params _params;
+	std::unique_ptr<HTTPSessionPool> _pSessionPool;
+	std::string _hostHeader;
+};
+
+
+//
+// inlines
+//
+inline const std::string& S3Client::bucket() const
+{
+	return _params.bucket;
+}
+
+
+#endif // S3Client_INCLUDED
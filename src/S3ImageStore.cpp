@@ -0,0 +1,71 @@
+//
+// S3ImageStore.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "S3ImageStore.h"
+#include <sstream>
+
+
+using namespace std::string_literals;
+
+
+S3ImageStore::S3ImageStore(const S3Client::Params& params, const std::string& prefix, FileImageStore::Ptr pBuffer, int uploadThreads, Poco::Timespan retryDelay, Poco::Timespan maxRetryDelay):
+	_client(params),
+	_prefix(prefix),
+	_outbox("S3ImageStore"s, pBuffer, *this, uploadThreads, retryDelay, maxRetryDelay)
+{
+	if (!_prefix.empty() && _prefix.back() != '/') _prefix += '/';
+}
+
+
+S3ImageStore::~S3ImageStore()
+{
+}
+
+
+std::string S3ImageStore::store(const std::string& key, std::istream& istr)
+{
+	return _outbox.add(key, istr);
+}
+
+
+std::unique_ptr<std::istream> S3ImageStore::open(const std::string& key, Poco::UInt64& size)
+{
+	auto pStream = _outbox.open(key, size);
+	if (pStream) return pStream;
+
+	std::string data;
+	if (_client.getObject(_prefix + key, data))
+	{
+		size = data.size();
+		return std::make_unique<std::istringstream>(std::move(data));
+	}
+	return nullptr;
+}
+
+
+bool S3ImageStore::exists(const std::string& key)
+{
+	return _outbox.contains(key) || _client.headObject(_prefix + key);
+}
+
+
+void S3ImageStore::start()
+{
+	_outbox.start();
+}
+
+
+void S3ImageStore::stop()
+{
+	_outbox.stop();
+}
+
+
+void S3ImageStore::deliver(const std::string& key, std::istream& istr, Poco::UInt64 size)
+{
+	_client.putObject(_prefix + key, istr, size, "image/jpeg"s);
+}
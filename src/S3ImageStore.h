@@ -0,0 +1,70 @@
+//
+// S3ImageStore.h
+//
+// Definition of the S3ImageStore class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef S3ImageStore_INCLUDED
+#define S3ImageStore_INCLUDED
+
+
+#include "ImageStore.h"
+#include "S3Client.h"
+#include "Outbox.h"
+
+
+class S3ImageStore: public ImageStore, private Outbox::Delivery
+	/// An ImageStore keeping images in a bucket of an
+	/// S3-compatible object store.
+	///
+	/// Object keys are the image keys below an optional prefix
+	/// (a '/' is appended to the prefix if missing), so the
+	/// bucket mirrors the site/camera/date layout of
+	/// a FileImageStore.
+	///
+	/// Uploaded images are first written to a local Outbox and
+	/// then uploaded to the object store in the background over
+	/// pooled persistent connections, so that camera uploads are
+	/// not throttled by the latency of the object store.
+{
+public:
+	S3ImageStore(const S3Client::Params& params, const std::string& prefix, FileImageStore::Ptr pBuffer, int uploadThreads, Poco::Timespan retryDelay, Poco::Timespan maxRetryDelay);
+		/// Creates the S3ImageStore, buffering images in the given local store.
+
+	~S3ImageStore();
+		/// Destroys the S3ImageStore.
+
+	int pending() const;
+		/// Returns the number of images not yet uploaded.
+
+	// ImageStore
+	std::string store(const std::string& key, std::istream& istr) override;
+	std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size) override;
+	bool exists(const std::string& key) override;
+	void start() override;
+	void stop() override;
+
+protected:
+	// Outbox::Delivery
+	void deliver(const std::string& key, std::istream& istr, Poco::UInt64 size) override;
+
+private:
+	S3Client _client;
+	std::string _prefix;
+	Outbox _outbox;
+};
+
+
+//
+// inlines
+//
+inline int S3ImageStore::pending() const
+{
+	return _outbox.pending();
+}
+
+
+#endif // S3ImageStore_INCLUDED
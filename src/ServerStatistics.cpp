@@ -0,0 +1,293 @@
+//
+// ServerStatistics.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ServerStatistics.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/URI.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sys/statvfs.h>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const double WINDOW_SECONDS[] = {60, 300, 900};
+	const Poco::Timestamp::TimeDiff SLOW_REQUEST_WINDOW = 300*Poco::Timestamp::resolution();
+}
+
+
+const Poco::Timestamp::TimeDiff ServerStatistics::TICK_INTERVAL = 5*Poco::Timestamp::resolution();
+
+
+void ServerStatistics::Rate::tick(double seconds)
+{
+	const double rate = _count.exchange(0, std::memory_order_relaxed)/seconds;
+	for (int i = 0; i < WINDOW_COUNT; i++)
+	{
+		const double alpha = std::exp(-seconds/WINDOW_SECONDS[i]);
+		_rates[i].store(_rates[i].load(std::memory_order_relaxed)*alpha + rate*(1 - alpha), std::memory_order_relaxed);
+	}
+}
+
+
+ServerStatistics::RequestTimer::RequestTimer(ServerStatistics* pStatistics, const Poco::Net::HTTPServerRequest& request):
+	_pStatistics(pStatistics),
+	_request(request)
+{
+	if (_pStatistics) _stopwatch.start();
+}
+
+
+ServerStatistics::RequestTimer::~RequestTimer()
+{
+	if (!_pStatistics) return;
+
+	try
+	{
+		RequestInfo info;
+		info.duration = _stopwatch.elapsed();
+		info.client = _request.clientAddress().toString();
+		info.method = _request.getMethod();
+		info.path = Poco::URI(_request.getURI()).getPath();
+		info.status = static_cast<int>(_request.response().getStatus());
+		_pStatistics->request(info);
+	}
+	catch (...)
+	{
+	}
+}
+
+
+ServerStatistics::ServerStatistics(const std::string& storagePath, std::size_t maxSites, std::size_t slowRequests):
+	_storagePath(storagePath),
+	_sites(maxSites),
+	_maxSlowRequests(slowRequests),
+	_thread("ServerStatistics"s)
+{
+}
+
+
+ServerStatistics::~ServerStatistics()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+void ServerStatistics::addGauge(const std::string& name, Gauge gauge)
+{
+	_gauges.emplace_back(name, gauge);
+}
+
+
+void ServerStatistics::start()
+{
+	_stop.reset();
+	_thread.start(*this);
+	_running = true;
+}
+
+
+void ServerStatistics::stop()
+{
+	if (!_running) return;
+
+	_stop.set();
+	_thread.join();
+	_running = false;
+}
+
+
+void ServerStatistics::upload(const std::string& site, Poco::UInt64 bytes)
+{
+	_total.uploads.add();
+	_total.bytes.add(bytes);
+	SiteStatistics* pSite = _sites.get(site);
+	if (pSite)
+	{
+		pSite->uploads.add();
+		pSite->bytes.add(bytes);
+	}
+}
+
+
+void ServerStatistics::request(const RequestInfo& info)
+{
+	if (_maxSlowRequests == 0 || info.duration <= _slowThreshold.load(std::memory_order_relaxed)) return;
+
+	Poco::FastMutex::ScopedLock lock(_slowMutex);
+
+	if (_slowRequests.size() >= _maxSlowRequests)
+	{
+		auto fastest = std::min_element(_slowRequests.begin(), _slowRequests.end(), [](const RequestInfo& a, const RequestInfo& b)
+			{
+				return a.duration < b.duration;
+			});
+		if (fastest->duration >= info.duration) return;
+		*fastest = info;
+	}
+	else
+	{
+		_slowRequests.push_back(info);
+	}
+
+	if (_slowRequests.size() >= _maxSlowRequests)
+	{
+		auto fastest = std::min_element(_slowRequests.begin(), _slowRequests.end(), [](const RequestInfo& a, const RequestInfo& b)
+			{
+				return a.duration < b.duration;
+			});
+		_slowThreshold = fastest->duration;
+	}
+}
+
+
+void ServerStatistics::run()
+{
+	Poco::Stopwatch sw;
+	sw.start();
+	while (!_stop.tryWait(static_cast<long>(TICK_INTERVAL/1000)))
+	{
+		const double seconds = sw.elapsed()/1000000.0;
+		sw.restart();
+		if (seconds <= 0) continue;
+
+		_total.uploads.tick(seconds);
+		_total.bytes.tick(seconds);
+		_sites.forEach([seconds](const std::string&, SiteStatistics& site)
+			{
+				site.uploads.tick(seconds);
+				site.bytes.tick(seconds);
+			});
+		expireSlowRequests();
+	}
+}
+
+
+void ServerStatistics::expireSlowRequests()
+{
+	Poco::FastMutex::ScopedLock lock(_slowMutex);
+
+	_slowRequests.erase(std::remove_if(_slowRequests.begin(), _slowRequests.end(), [](const RequestInfo& info)
+		{
+			return info.time.isElapsed(SLOW_REQUEST_WINDOW);
+		}), _slowRequests.end());
+	if (_slowRequests.size() < _maxSlowRequests) _slowThreshold = 0;
+}
+
+
+Poco::JSON::Object::Ptr ServerStatistics::toJSON() const
+{
+	Poco::JSON::Object::Ptr pStatus = new Poco::JSON::Object;
+	pStatus->set("time"s, Poco::DateTimeFormatter::format(Poco::Timestamp(), Poco::DateTimeFormat::ISO8601_FORMAT));
+	pStatus->set("uptime"s, uptime().totalSeconds());
+
+	const Poco::Net::TCPServer* pServer = _pServer;
+	if (pServer)
+	{
+		Poco::JSON::Object::Ptr pServerObject = new Poco::JSON::Object;
+		pServerObject->set("connections"s, pServer->currentConnections());
+		pServerObject->set("maxConcurrentConnections"s, pServer->maxConcurrentConnections());
+		pServerObject->set("totalConnections"s, pServer->totalConnections());
+		pServerObject->set("queuedConnections"s, pServer->queuedConnections());
+		pServerObject->set("refusedConnections"s, pServer->refusedConnections());
+		pServerObject->set("threads"s, pServer->currentThreads());
+		pServerObject->set("maxThreads"s, pServer->maxThreads());
+		pStatus->set("server"s, pServerObject);
+	}
+
+	Poco::JSON::Object::Ptr pQueues = new Poco::JSON::Object;
+	for (const auto& gauge: _gauges)
+	{
+		pQueues->set(gauge.first, gauge.second());
+	}
+	pStatus->set("queues"s, pQueues);
+
+	Poco::JSON::Object::Ptr pUploads = new Poco::JSON::Object;
+	pUploads->set("images"s, rateToJSON(_total.uploads));
+	pUploads->set("bytes"s, rateToJSON(_total.bytes));
+	pStatus->set("uploads"s, pUploads);
+
+	std::map<std::string, const SiteStatistics*> sites;
+	_sites.forEach([&sites](const std::string& name, const SiteStatistics& site)
+		{
+			sites[name] = &site;
+		});
+	Poco::JSON::Array::Ptr pSites = new Poco::JSON::Array;
+	for (const auto& site: sites)
+	{
+		Poco::JSON::Object::Ptr pSite = new Poco::JSON::Object;
+		pSite->set("site"s, site.first);
+		pSite->set("images"s, rateToJSON(site.second->uploads));
+		pSite->set("bytes"s, rateToJSON(site.second->bytes));
+		pSites->add(pSite);
+	}
+	pStatus->set("sites"s, pSites);
+
+	struct statvfs st;
+	if (!_storagePath.empty() && ::statvfs(_storagePath.c_str(), &st) == 0)
+	{
+		Poco::JSON::Object::Ptr pDisk = new Poco::JSON::Object;
+		const Poco::UInt64 total = static_cast<Poco::UInt64>(st.f_blocks)*st.f_frsize;
+		const Poco::UInt64 available = static_cast<Poco::UInt64>(st.f_bavail)*st.f_frsize;
+		const Poco::UInt64 used = total - static_cast<Poco::UInt64>(st.f_bfree)*st.f_frsize;
+		pDisk->set("path"s, _storagePath);
+		pDisk->set("total"s, total);
+		pDisk->set("used"s, used);
+		pDisk->set("available"s, available);
+		pDisk->set("usedPercent"s, total > 0 ? 100.0*used/total : 0.0);
+		pStatus->set("disk"s, pDisk);
+	}
+
+	std::vector<RequestInfo> slowRequests;
+	{
+		Poco::FastMutex::ScopedLock lock(_slowMutex);
+		slowRequests = _slowRequests;
+	}
+	std::sort(slowRequests.begin(), slowRequests.end(), [](const RequestInfo& a, const RequestInfo& b)
+		{
+			return a.duration > b.duration;
+		});
+	Poco::JSON::Array::Ptr pSlow = new Poco::JSON::Array;
+	for (const auto& info: slowRequests)
+	{
+		Poco::JSON::Object::Ptr pRequest = new Poco::JSON::Object;
+		pRequest->set("time"s, Poco::DateTimeFormatter::format(info.time, Poco::DateTimeFormat::ISO8601_FRAC_FORMAT));
+		pRequest->set("client"s, info.client);
+		pRequest->set("method"s, info.method);
+		pRequest->set("path"s, info.path);
+		pRequest->set("status"s, info.status);
+		pRequest->set("duration"s, info.duration/1000.0);
+		pSlow->add(pRequest);
+	}
+	pStatus->set("slowRequests"s, pSlow);
+
+	return pStatus;
+}
+
+
+Poco::JSON::Object::Ptr ServerStatistics::rateToJSON(const Rate& rate)
+{
+	Poco::JSON::Object::Ptr pRate = new Poco::JSON::Object;
+	pRate->set("total"s, rate.total());
+	pRate->set("perMinute1"s, rate.perMinute(Rate::WINDOW_1MIN));
+	pRate->set("perMinute5"s, rate.perMinute(Rate::WINDOW_5MIN));
+	pRate->set("perMinute15"s, rate.perMinute(Rate::WINDOW_15MIN));
+	return pRate;
+}
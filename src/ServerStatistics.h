@@ -0,0 +1,205 @@
+//
+// ServerStatistics.h
+//
+// Definition of the ServerStatistics class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ServerStatistics_INCLUDED
+#define ServerStatistics_INCLUDED
+
+
+#include "AtomicTable.h"
+#include "Poco/Net/TCPServer.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/Mutex.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+class ServerStatistics: public Poco::Runnable
+	/// ServerStatistics collects the runtime statistics shown on
+	/// the status page: connections and threads of the HTTP server,
+	/// queue depths, upload rates (in total and per site), disk usage
+	/// of the storage volume and the slowest recent requests.
+	///
+	/// Upload rates are exponentially weighted moving averages over
+	/// 1, 5 and 15 minutes, like the Unix load average. Uploads only
+	/// increment atomic counters; a background thread updates the
+	/// averages every few seconds. Recording a request only takes a
+	/// lock if it is slower than the slowest requests recorded so far.
+{
+public:
+	using Gauge = std::function<Poco::Int64()>;
+
+	class Rate
+		/// Moving averages of the rate of an event.
+	{
+	public:
+		enum
+		{
+			WINDOW_1MIN,
+			WINDOW_5MIN,
+			WINDOW_15MIN,
+			WINDOW_COUNT
+		};
+
+		void add(Poco::UInt64 n = 1);
+			/// Counts n events.
+
+		void tick(double seconds);
+			/// Updates the averages with the events counted since the
+			/// last tick. Must only be called by a single thread.
+
+		double perMinute(int window) const;
+			/// Returns the average number of events per minute
+			/// in the given window.
+
+		Poco::UInt64 total() const;
+			/// Returns the total number of events.
+
+	private:
+		std::atomic<Poco::UInt64> _count{0};
+		std::atomic<Poco::UInt64> _total{0};
+		std::atomic<double> _rates[WINDOW_COUNT] = {{0}, {0}, {0}};
+	};
+
+	struct SiteStatistics
+	{
+		Rate uploads;
+		Rate bytes;
+	};
+
+	struct RequestInfo
+	{
+		Poco::Timestamp time;
+		std::string client;
+		std::string method;
+		std::string path;
+			/// Request path, without the query (which contains the token).
+		int status = 0;
+		Poco::Timestamp::TimeDiff duration = 0;
+	};
+
+	class RequestTimer
+		/// Measures the time taken to handle a request and
+		/// records it when the RequestTimer is destroyed.
+	{
+	public:
+		RequestTimer(ServerStatistics* pStatistics, const Poco::Net::HTTPServerRequest& request);
+			/// Starts timing the request. Does nothing if pStatistics is null.
+
+		~RequestTimer();
+			/// Records the request.
+
+	private:
+		ServerStatistics* _pStatistics;
+		const Poco::Net::HTTPServerRequest& _request;
+		Poco::Stopwatch _stopwatch;
+	};
+
+	ServerStatistics(const std::string& storagePath, std::size_t maxSites, std::size_t slowRequests);
+		/// Creates the ServerStatistics. Per-site statistics are kept for
+		/// up to maxSites sites, and the slowRequests slowest requests
+		/// of the last five minutes are kept.
+
+	~ServerStatistics();
+		/// Destroys the ServerStatistics.
+
+	void addGauge(const std::string& name, Gauge gauge);
+		/// Adds a queue depth or similar value to be reported.
+		/// Must be called before start().
+
+	void setServer(const Poco::Net::TCPServer* pServer);
+		/// Sets the server whose connections and threads are reported,
+		/// or nullptr if there is none.
+
+	void start();
+		/// Starts updating the moving averages.
+
+	void stop();
+		/// Stops updating the moving averages.
+
+	void upload(const std::string& site, Poco::UInt64 bytes);
+		/// Records an image upload from the given site.
+
+	void request(const RequestInfo& info);
+		/// Records a handled request.
+
+	Poco::Timespan uptime() const;
+		/// Returns the time since the ServerStatistics has been created.
+
+	Poco::JSON::Object::Ptr toJSON() const;
+		/// Returns the statistics as JSON object.
+
+	static const Poco::Timestamp::TimeDiff TICK_INTERVAL;
+
+protected:
+	void run();
+	void expireSlowRequests();
+	static Poco::JSON::Object::Ptr rateToJSON(const Rate& rate);
+
+private:
+	std::string _storagePath;
+	Poco::Timestamp _startTime;
+	std::atomic<const Poco::Net::TCPServer*> _pServer{nullptr};
+	std::vector<std::pair<std::string, Gauge>> _gauges;
+	SiteStatistics _total;
+	AtomicTable<SiteStatistics> _sites;
+	std::size_t _maxSlowRequests;
+	std::vector<RequestInfo> _slowRequests;
+	std::atomic<Poco::Timestamp::TimeDiff> _slowThreshold{0};
+	mutable Poco::FastMutex _slowMutex;
+	Poco::Thread _thread;
+	Poco::Event _stop;
+	bool _running = false;
+};
+
+
+//
+// inlines
+//
+inline void ServerStatistics::Rate::add(Poco::UInt64 n)
+{
+	_count.fetch_add(n, std::memory_order_relaxed);
+	_total.fetch_add(n, std::memory_order_relaxed);
+}
+
+
+inline double ServerStatistics::Rate::perMinute(int window) const
+{
+	return _rates[window].load(std::memory_order_relaxed)*60;
+}
+
+
+inline Poco::UInt64 ServerStatistics::Rate::total() const
+{
+	return _total.load(std::memory_order_relaxed);
+}
+
+
+inline void ServerStatistics::setServer(const Poco::Net::TCPServer* pServer)
+{
+	_pServer = pServer;
+}
+
+
+inline Poco::Timespan ServerStatistics::uptime() const
+{
+	return Poco::Timespan(_startTime.elapsed());
+}
+
+
+#endif // ServerStatistics_INCLUDED
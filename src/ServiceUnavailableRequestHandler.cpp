@@ -0,0 +1,38 @@
+//
+// ServiceUnavailableRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ServiceUnavailableRequestHandler.h"
+#include "ImageUploadRequestHandler.h"
+#include "Poco/Util/Application.h"
+#include "Poco/NumberFormatter.h"
+
+
+using namespace std::string_literals;
+
+
+ServiceUnavailableRequestHandler::ServiceUnavailableRequestHandler(int retryAfter):
+	_retryAfter(retryAfter)
+{
+}
+
+
+ServiceUnavailableRequestHandler::~ServiceUnavailableRequestHandler()
+{
+}
+
+
+void ServiceUnavailableRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	auto& app = Poco::Util::Application::instance();
+	app.logger().warning("Rejecting request from %s: %s %s (server busy)"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
+
+	// The request body is not read, so the connection
+	// cannot be used for further requests.
+	response.setKeepAlive(false);
+	response.set("Retry-After"s, Poco::NumberFormatter::format(_retryAfter));
+	ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE, "Server busy, please retry later"s);
+}
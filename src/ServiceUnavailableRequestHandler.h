@@ -0,0 +1,38 @@
+//
+// ServiceUnavailableRequestHandler.h
+//
+// Definition of the ServiceUnavailableRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ServiceUnavailableRequestHandler_INCLUDED
+#define ServiceUnavailableRequestHandler_INCLUDED
+
+
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+
+class ServiceUnavailableRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Rejects a request with 503 Service Unavailable and a
+	/// Retry-After header, without reading the request body.
+{
+public:
+	ServiceUnavailableRequestHandler(int retryAfter);
+		/// Creates the ServiceUnavailableRequestHandler, asking
+		/// clients to retry after the given number of seconds.
+
+	~ServiceUnavailableRequestHandler();
+		/// Destroys the ServiceUnavailableRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+private:
+	int _retryAfter;
+};
+
+
+#endif // ServiceUnavailableRequestHandler_INCLUDED
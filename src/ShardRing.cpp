@@ -0,0 +1,103 @@
+//
+// ShardRing.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "ShardRing.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+
+
+using namespace std::string_literals;
+
+
+const std::string ShardRing::FORWARDED_HEADER("X-Shard-Forwarded");
+
+
+ShardRing::ShardRing(const std::vector<std::string>& nodes, const std::string& self, int virtualNodes, Mode mode, Poco::Timespan timeout, int maxIdleConnections):
+	_self(nodes.size()),
+	_mode(mode)
+{
+	if (nodes.empty()) throw Poco::InvalidArgumentException("No cluster nodes configured"s);
+	if (virtualNodes < 1) virtualNodes = 1;
+
+	_nodes.reserve(nodes.size());
+	for (const auto& address: nodes)
+	{
+		auto pos = address.rfind(':');
+		if (pos == std::string::npos || pos == 0)
+			throw Poco::InvalidArgumentException("Invalid cluster node address (expected host:port)"s, address);
+
+		Node node;
+		node.address = address;
+		node.pSessionPool = std::make_unique<HTTPSessionPool>(address.substr(0, pos), static_cast<Poco::UInt16>(Poco::NumberParser::parseUnsigned(address.substr(pos + 1))), timeout, maxIdleConnections);
+		if (address == self) _self = _nodes.size();
+		_nodes.push_back(std::move(node));
+	}
+	if (_self == _nodes.size())
+		throw Poco::InvalidArgumentException("This node is not in the list of cluster nodes"s, self);
+
+	_ring.reserve(_nodes.size()*virtualNodes);
+	for (std::size_t i = 0; i < _nodes.size(); i++)
+	{
+		for (int v = 0; v < virtualNodes; v++)
+		{
+			Point point;
+			point.hash = hash(_nodes[i].address + '#' + Poco::NumberFormatter::format(v));
+			point.node = i;
+			_ring.push_back(point);
+		}
+	}
+	std::sort(_ring.begin(), _ring.end());
+}
+
+
+ShardRing::~ShardRing()
+{
+}
+
+
+ShardRing::Node& ShardRing::owner(const std::string& site, const std::string& camera)
+{
+	Point point;
+	point.hash = hash(site + '/' + camera);
+	point.node = 0;
+
+	auto it = std::lower_bound(_ring.begin(), _ring.end(), point);
+	if (it == _ring.end()) it = _ring.begin();
+	return _nodes[it->node];
+}
+
+
+ShardRing::Mode ShardRing::parseMode(const std::string& mode)
+{
+	if (mode == "redirect")
+		return MODE_REDIRECT;
+	else if (mode == "proxy")
+		return MODE_PROXY;
+	else
+		throw Poco::InvalidArgumentException("Invalid cluster mode"s, mode);
+}
+
+
+Poco::UInt64 ShardRing::hash(const std::string& data)
+{
+	// FNV-1a, followed by the SplitMix64 finalizer
+	// to spread similar names over the whole ring.
+	Poco::UInt64 h = 14695981039346656037ULL;
+	for (unsigned char c: data)
+	{
+		h ^= c;
+		h *= 1099511628211ULL;
+	}
+	h ^= h >> 30;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 27;
+	h *= 0x94D049BB133111EBULL;
+	h ^= h >> 31;
+	return h;
+}
@@ -0,0 +1,108 @@
+//
+// ShardRing.h
+//
+// Definition of the ShardRing class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef ShardRing_INCLUDED
+#define ShardRing_INCLUDED
+
+
+#include "HTTPSessionPool.h"
+#include "Poco/Types.h"
+#include <memory>
+#include <vector>
+#include <string>
+
+
+class ShardRing
+	/// ShardRing distributes cameras over a static set of
+	/// AxisCameraUpload nodes using consistent hashing.
+	///
+	/// Every node is placed on a hash ring at a number of points
+	/// (virtual nodes). A camera, identified by site and camera name,
+	/// is owned by the node with the first point at or after the hash
+	/// of the camera. Adding a node therefore only moves the cameras
+	/// between the new node's points and their predecessors.
+	///
+	/// Nodes receiving requests for cameras they do not own either
+	/// redirect the client to the owner, or proxy the request.
+{
+public:
+	enum Mode
+	{
+		MODE_REDIRECT, /// Reply with 307 Temporary Redirect to the owner.
+		MODE_PROXY     /// Forward the request to the owner.
+	};
+
+	struct Node
+	{
+		std::string address;  /// host:port
+		std::unique_ptr<HTTPSessionPool> pSessionPool;
+	};
+
+	static const std::string FORWARDED_HEADER;
+		/// Header added to proxied requests. Nodes always handle
+		/// requests carrying this header locally.
+
+	ShardRing(const std::vector<std::string>& nodes, const std::string& self, int virtualNodes, Mode mode, Poco::Timespan timeout, int maxIdleConnections);
+		/// Creates the ShardRing from the given node addresses (host:port).
+		/// The address of this node must be one of the given addresses.
+
+	~ShardRing();
+		/// Destroys the ShardRing.
+
+	Node& owner(const std::string& site, const std::string& camera);
+		/// Returns the node owning the given camera.
+
+	bool isSelf(const Node& node) const;
+		/// Returns true if the given node is this node.
+
+	Mode mode() const;
+		/// Returns the mode for handling requests for cameras
+		/// owned by other nodes.
+
+	static Mode parseMode(const std::string& mode);
+		/// Parses a mode ("redirect" or "proxy").
+
+	static Poco::UInt64 hash(const std::string& data);
+		/// Returns the 64-bit hash value of the given data.
+
+private:
+	struct Point
+	{
+		Poco::UInt64 hash;
+		std::size_t node;
+
+		bool operator < (const Point& other) const
+		{
+			return hash < other.hash;
+		}
+	};
+
+	std::vector<Node> _nodes;
+	std::vector<Point> _ring;
+	std::size_t _self;
+	Mode _mode;
+};
+
+
+//
+// inlines
+//
+inline bool ShardRing::isSelf(const Node& node) const
+{
+	return &node == &_nodes[_self];
+}
+
+
+inline ShardRing::Mode ShardRing::mode() const
+{
+	return _mode;
+}
+
+
+#endif // ShardRing_INCLUDED
@@ -0,0 +1,483 @@
+//
+// SoakTest.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "SoakTest.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/NullStream.h"
+#include "Poco/FileStream.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Timezone.h"
+#include "Poco/Logger.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <ftw.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	Poco::UInt64 diskUsageTotal = 0;
+
+	int addDiskUsage(const char* path, const struct stat* pStat, int flag, struct FTW* pFtw)
+	{
+		if (flag == FTW_F || flag == FTW_D) diskUsageTotal += static_cast<Poco::UInt64>(pStat->st_blocks)*512;
+		return 0;
+	}
+}
+
+
+SoakTest::SoakTest(const Poco::Util::AbstractConfiguration& config):
+	_url(config.getString("soak.url"s, "http://localhost:"s + config.getString("http.port"s, "9980"s))),
+	_token(config.getString("upload.token"s, ""s)),
+	_storagePath(config.getString("upload.path"s, ""s)),
+	_pidFile(config.getString("soak.pidFile"s, ""s)),
+	_duration(config.getDouble("soak.duration"s, 86400)),
+	_timeScale(config.getDouble("soak.timeScale"s, 1)),
+	_sites(config.getInt("soak.sites"s, 4)),
+	_camerasPerSite(config.getInt("soak.cameras"s, 16)),
+	_imageSize(config.getUInt("soak.imageSize"s, 262144)),
+	_snapshotInterval(config.getDouble("soak.snapshotInterval"s, 60)),
+	_eventRate(config.getDouble("soak.eventRate"s, 2)),
+	_eventImages(config.getInt("soak.eventImages"s, 10)),
+	_eventImageInterval(config.getDouble("soak.eventImageInterval"s, 200)/1000),
+	_reconnectInterval(config.getDouble("soak.reconnectInterval"s, 3600)),
+	_threadCount(config.getInt("soak.threads"s, 32)),
+	_sampleInterval(config.getDouble("soak.sampleInterval"s, 60)),
+	_sloP99(config.getInt64("soak.slo.p99"s, 1000)*1000),
+	_sloRSSGrowth(config.getUInt64("soak.slo.rssGrowth"s, 64*1024*1024)),
+	_sloMaxErrorRate(config.getDouble("soak.slo.maxErrorRate"s, 0.001))
+{
+	if (_timeScale <= 0) throw Poco::InvalidArgumentException("soak.timeScale must be positive"s);
+	if (_snapshotInterval <= 0) throw Poco::InvalidArgumentException("soak.snapshotInterval must be positive"s);
+	if (_sampleInterval <= 0) throw Poco::InvalidArgumentException("soak.sampleInterval must be positive"s);
+}
+
+
+SoakTest::~SoakTest()
+{
+}
+
+
+bool SoakTest::run(std::ostream& ostr)
+{
+	// random data between JPEG start and end of image markers
+	_random.seed();
+	_image.resize(std::max<std::size_t>(_imageSize, 4));
+	for (auto& c: _image) c = _random.nextChar();
+	_image[0] = '\xFF';
+	_image[1] = '\xD8';
+	_image[_image.size() - 2] = '\xFF';
+	_image[_image.size() - 1] = '\xD9';
+
+	for (int s = 0; s < _sites; s++)
+	{
+		for (int c = 0; c < _camerasPerSite; c++)
+		{
+			auto pCamera = std::make_unique<Camera>();
+			pCamera->site = "site"s + Poco::NumberFormatter::format0(s + 1, 2);
+			pCamera->name = "camera"s + Poco::NumberFormatter::format0(c + 1, 3);
+			_cameras.push_back(std::move(pCamera));
+		}
+	}
+
+	ostr << "Soak test: " << _cameras.size() << " cameras uploading to " << _url.toString()
+		<< " for " << _duration << " s at " << _timeScale << "x speed\n\n";
+	ostr << "elapsed s   uploads    errors  rejected  p99 ms    RSS MB     fds  threads   disk MB\n";
+
+	_start.update();
+	for (std::size_t i = 0; i < _cameras.size(); i++)
+	{
+		scheduleSnapshot(i, _start);
+		if (_eventRate > 0) scheduleEvents(i);
+	}
+	scheduleRollover(_start);
+	if (_reconnectInterval > 0) scheduleReconnect(_start);
+
+	_stopped = false;
+	for (int i = 0; i < std::max(_threadCount, 1); i++)
+	{
+		_threads.push_back(std::make_unique<Poco::Thread>("SoakTest"s));
+		_threads.back()->start(*this);
+	}
+
+	std::vector<Sample> samples;
+	const Poco::Timestamp end = toReal(_duration);
+	double nextSample = _sampleInterval;
+	Poco::Timestamp now;
+	while (now < end)
+	{
+		while (!_schedule.empty() && _schedule.begin()->first <= now)
+		{
+			const Scheduled scheduled = _schedule.begin()->second;
+			const Poco::Timestamp due = _schedule.begin()->first;
+			_schedule.erase(_schedule.begin());
+			switch (scheduled.action)
+			{
+			case ACTION_SNAPSHOT:
+				dispatch(Upload{scheduled.camera, false});
+				scheduleSnapshot(scheduled.camera, due);
+				break;
+			case ACTION_EVENT:
+				dispatch(Upload{scheduled.camera, true});
+				break;
+			case ACTION_ROLLOVER:
+				for (std::size_t i = 0; i < _cameras.size(); i++) dispatch(Upload{i, false});
+				scheduleRollover(due);
+				break;
+			case ACTION_RECONNECT:
+				for (std::size_t i = 0; i < _cameras.size(); i++)
+				{
+					_cameras[i]->reconnect = true;
+					dispatch(Upload{i, false});
+				}
+				scheduleReconnect(due);
+				break;
+			}
+		}
+
+		if (now >= toReal(nextSample))
+		{
+			samples.push_back(sample());
+			writeSample(ostr, samples.back());
+			nextSample += _sampleInterval;
+		}
+
+		Poco::Timestamp wakeUp = std::min(end, toReal(nextSample));
+		if (!_schedule.empty()) wakeUp = std::min(wakeUp, _schedule.begin()->first);
+		now.update();
+		if (wakeUp > now)
+		{
+			Poco::Thread::sleep(static_cast<long>(std::min<Poco::Timestamp::TimeDiff>((wakeUp - now)/1000 + 1, 1000)));
+			now.update();
+		}
+	}
+
+	_stopped = true;
+	_queueCondition.broadcast();
+	for (auto& pThread: _threads)
+	{
+		pThread->join();
+	}
+	_threads.clear();
+
+	// summary
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	const std::size_t queued = _queue.size();
+	const Poco::Timestamp::TimeDiff p50 = percentile(_latencies, 0.5);
+	const Poco::Timestamp::TimeDiff p99 = percentile(_latencies, 0.99);
+	const Poco::Timestamp::TimeDiff max = _latencies.empty() ? 0 : *std::max_element(_latencies.begin(), _latencies.end());
+	ostr << "\nUploads: " << _uploads << ", errors: " << _errors << ", rejected: " << _rejected << ", not sent: " << queued << "\n";
+	ostr << "Latency: p50 " << p50/1000 << " ms, p99 " << p99/1000 << " ms, max " << max/1000 << " ms\n";
+
+	bool passed = true;
+	const Poco::UInt64 failed = _errors + _rejected + queued;
+	const Poco::UInt64 attempted = _uploads + failed;
+	if (_uploads == 0)
+	{
+		ostr << "FAILED: no upload was accepted\n";
+		passed = false;
+	}
+	else if (static_cast<double>(failed) > _sloMaxErrorRate*attempted)
+	{
+		ostr << "FAILED: " << failed << " of " << attempted << " uploads failed, were rejected or not sent, more than "
+			<< _sloMaxErrorRate*100 << "%\n";
+		passed = false;
+	}
+	if (p99 > _sloP99)
+	{
+		ostr << "FAILED: p99 upload latency " << p99/1000 << " ms exceeds " << _sloP99/1000 << " ms\n";
+		passed = false;
+	}
+
+	// Samples taken while the PID file or /proc could not be read
+	// have no RSS; growth is measured between the others.
+	std::vector<const Sample*> rssSamples;
+	for (const auto& s: samples)
+	{
+		if (s.rss > 0) rssSamples.push_back(&s);
+	}
+	if (rssSamples.size() < 2)
+	{
+		ostr << "FAILED: RSS of the server could not be sampled" << (_pidFile.empty() ? " (soak.pidFile not set)"s : ""s) << "\n";
+		passed = false;
+	}
+	else
+	{
+		const Sample& first = *rssSamples.front();
+		const Sample& last = *rssSamples.back();
+		const Poco::Int64 growth = static_cast<Poco::Int64>(last.rss) - static_cast<Poco::Int64>(first.rss);
+		ostr << "RSS: " << first.rss/1024/1024 << " MB -> " << last.rss/1024/1024 << " MB, fds: " << first.fds << " -> " << last.fds
+			<< ", threads: " << first.threads << " -> " << last.threads
+			<< ", disk: " << first.diskUsage/1024/1024 << " MB -> " << last.diskUsage/1024/1024 << " MB\n";
+		if (growth > static_cast<Poco::Int64>(_sloRSSGrowth))
+		{
+			ostr << "FAILED: RSS grew by " << growth/1024/1024 << " MB, more than " << _sloRSSGrowth/1024/1024 << " MB\n";
+			passed = false;
+		}
+	}
+	if (passed) ostr << "PASSED\n";
+	ostr << std::flush;
+	return passed;
+}
+
+
+void SoakTest::run()
+{
+	while (!_stopped)
+	{
+		Upload next;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+
+			if (_queue.empty())
+			{
+				_queueCondition.tryWait(_mutex, 1000);
+				continue;
+			}
+			next = _queue.front();
+			_queue.pop_front();
+		}
+		upload(next);
+	}
+}
+
+
+void SoakTest::scheduleSnapshot(std::size_t camera, Poco::Timestamp after)
+{
+	// Cameras take snapshots at multiples of the interval.
+	const double t = (std::floor(toSchedule(after)/_snapshotInterval) + 1)*_snapshotInterval;
+	_schedule.emplace(toReal(t), Scheduled{ACTION_SNAPSHOT, camera});
+}
+
+
+void SoakTest::scheduleEvents(std::size_t camera)
+{
+	// Events arrive as a Poisson process; a new event
+	// can only start after the last image of the previous one.
+	const double meanInterval = 3600/_eventRate;
+	double t = 0;
+	while (true)
+	{
+		t -= std::log(1 - _random.nextDouble())*meanInterval;
+		if (t >= _duration) break;
+		for (int i = 0; i < _eventImages; i++)
+		{
+			_schedule.emplace(toReal(t), Scheduled{ACTION_EVENT, camera});
+			t += _eventImageInterval;
+		}
+	}
+}
+
+
+void SoakTest::scheduleRollover(Poco::Timestamp after)
+{
+	// one second after the next full hour in local time
+	const Poco::Timestamp::TimeVal tzd = static_cast<Poco::Timestamp::TimeVal>(Poco::Timezone::tzd())*Poco::Timestamp::resolution();
+	const Poco::Timestamp::TimeVal hour = 3600*Poco::Timestamp::resolution();
+	const Poco::Timestamp::TimeVal local = after.epochMicroseconds() + tzd;
+	const Poco::Timestamp::TimeVal next = (local/hour + 1)*hour - tzd + Poco::Timestamp::resolution();
+	_schedule.emplace(Poco::Timestamp(next), Scheduled{ACTION_ROLLOVER, 0});
+}
+
+
+void SoakTest::scheduleReconnect(Poco::Timestamp after)
+{
+	const double t = (std::floor(toSchedule(after)/_reconnectInterval) + 1)*_reconnectInterval;
+	_schedule.emplace(toReal(t), Scheduled{ACTION_RECONNECT, 0});
+}
+
+
+void SoakTest::dispatch(const Upload& upload)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	_queue.push_back(upload);
+	_queueCondition.signal();
+}
+
+
+void SoakTest::upload(const Upload& upload)
+{
+	Camera& camera = *_cameras[upload.camera];
+	Poco::FastMutex::ScopedLock cameraLock(camera.mutex);
+
+	if (camera.reconnect.exchange(false) || !camera.pSession)
+	{
+		camera.pSession = std::make_unique<Poco::Net::HTTPClientSession>(_url.getHost(), _url.getPort());
+		camera.pSession->setKeepAlive(true);
+		camera.pSession->setTimeout(Poco::Timespan(30, 0));
+	}
+
+	Poco::URI uri;
+	uri.setPath("/"s + (upload.event ? "event"s : "upload"s) + "/"s + camera.site + "/"s + camera.name);
+	uri.addQueryParameter("token"s, _token);
+
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_POST, uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+	request.setContentType("image/jpeg"s);
+	request.setContentLength64(static_cast<Poco::Int64>(_image.size()));
+	request.setKeepAlive(true);
+
+	Poco::Stopwatch stopwatch;
+	stopwatch.start();
+	try
+	{
+		std::ostream& ostr = camera.pSession->sendRequest(request);
+		ostr.write(_image.data(), _image.size());
+		Poco::Net::HTTPResponse response;
+		std::istream& istr = camera.pSession->receiveResponse(response);
+		Poco::NullOutputStream nullStream;
+		Poco::StreamCopier::copyStream(istr, nullStream);
+		stopwatch.stop();
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_latencies.push_back(stopwatch.elapsed());
+		if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK)
+		{
+			_uploads++;
+		}
+		else if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE)
+		{
+			_rejected++;
+		}
+		else
+		{
+			_errors++;
+		}
+	}
+	catch (Poco::Exception& exc)
+	{
+		Poco::Logger::get("SoakTest"s).debug("Upload from %s/%s failed: %s"s, camera.site, camera.name, exc.displayText());
+		camera.pSession.reset();
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_latencies.push_back(stopwatch.elapsed());
+		_errors++;
+	}
+}
+
+
+SoakTest::Sample SoakTest::sample()
+{
+	Sample result;
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		std::vector<Poco::Timestamp::TimeDiff> window(_latencies.begin() + _sampleStart, _latencies.end());
+		_sampleStart = _latencies.size();
+		result.p99 = percentile(window, 0.99);
+		result.uploads = _uploads;
+		result.errors = _errors;
+		result.rejected = _rejected;
+	}
+
+	// The PID file is read every time, as the server
+	// may have been restarted with a socket handoff.
+	if (!_pidFile.empty())
+	{
+		try
+		{
+			std::string pid;
+			Poco::FileInputStream pidStream(_pidFile);
+			pidStream >> pid;
+			const std::string procPath = "/proc/"s + pid;
+
+			Poco::FileInputStream statusStream(procPath + "/status"s);
+			std::string line;
+			while (std::getline(statusStream, line))
+			{
+				// e.g. "VmRSS:	   10240 kB"
+				std::istringstream fields(line);
+				std::string name;
+				Poco::UInt64 value = 0;
+				fields >> name >> value;
+				if (name == "VmRSS:") result.rss = value*1024;
+				else if (name == "Threads:") result.threads = static_cast<int>(value);
+			}
+			result.fds = countEntries(procPath + "/fd"s);
+		}
+		catch (Poco::Exception& exc)
+		{
+			Poco::Logger::get("SoakTest"s).warning("Cannot read process metrics: %s"s, exc.displayText());
+		}
+	}
+	if (!_storagePath.empty()) result.diskUsage = diskUsage(_storagePath);
+	return result;
+}
+
+
+void SoakTest::writeSample(std::ostream& ostr, const Sample& sample)
+{
+	std::string line;
+	line += Poco::NumberFormatter::format(toSchedule(sample.time), 9, 0);
+	line += Poco::NumberFormatter::format(sample.uploads, 10);
+	line += Poco::NumberFormatter::format(sample.errors, 10);
+	line += Poco::NumberFormatter::format(sample.rejected, 10);
+	line += Poco::NumberFormatter::format(sample.p99/1000.0, 8, 0);
+	line += Poco::NumberFormatter::format(sample.rss/(1024.0*1024.0), 10, 1);
+	line += Poco::NumberFormatter::format(sample.fds, 8);
+	line += Poco::NumberFormatter::format(sample.threads, 9);
+	line += Poco::NumberFormatter::format(sample.diskUsage/(1024.0*1024.0), 10, 0);
+	ostr << line << std::endl;
+}
+
+
+Poco::Timestamp SoakTest::toReal(double scheduleSeconds) const
+{
+	return _start + static_cast<Poco::Timestamp::TimeDiff>(scheduleSeconds*Poco::Timestamp::resolution()/_timeScale);
+}
+
+
+double SoakTest::toSchedule(Poco::Timestamp time) const
+{
+	return static_cast<double>(time - _start)*_timeScale/Poco::Timestamp::resolution();
+}
+
+
+Poco::Timestamp::TimeDiff SoakTest::percentile(std::vector<Poco::Timestamp::TimeDiff>& latencies, double p)
+{
+	if (latencies.empty()) return 0;
+
+	std::size_t n = static_cast<std::size_t>(std::ceil(p*latencies.size()));
+	if (n > 0) n--;
+	std::nth_element(latencies.begin(), latencies.begin() + n, latencies.end());
+	return latencies[n];
+}
+
+
+Poco::UInt64 SoakTest::diskUsage(const std::string& path)
+{
+	// only called from the main thread
+	diskUsageTotal = 0;
+	::nftw(path.c_str(), addDiskUsage, 32, FTW_PHYS);
+	return diskUsageTotal;
+}
+
+
+int SoakTest::countEntries(const std::string& path)
+{
+	int count = 0;
+	DIR* pDir = ::opendir(path.c_str());
+	if (pDir)
+	{
+		while (struct dirent* pEntry = ::readdir(pDir))
+		{
+			if (pEntry->d_name[0] != '.') count++;
+		}
+		::closedir(pDir);
+	}
+	return count;
+}
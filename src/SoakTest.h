@@ -0,0 +1,188 @@
+//
+// SoakTest.h
+//
+// Definition of the SoakTest class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef SoakTest_INCLUDED
+#define SoakTest_INCLUDED
+
+
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Random.h"
+#include "Poco/URI.h"
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+class SoakTest: public Poco::Runnable
+	/// SoakTest uploads images to a running server following the
+	/// pattern of a camera installation over a day, and checks
+	/// upload latency and the resource usage of the server against
+	/// service level objectives.
+	///
+	/// The simulated cameras upload periodic snapshots (aligned to
+	/// the snapshot interval, as configured on the cameras), bursts
+	/// of event images at random times, a snapshot from every camera
+	/// right after each full hour (when the server creates the
+	/// directories for the new hour), and periodically all drop
+	/// their connections and reconnect at the same time.
+	///
+	/// At every sample interval, the disk usage of the storage
+	/// directory and the RSS, open file descriptors and threads of
+	/// the server process (from /proc) are recorded. The test fails
+	/// if the 99th percentile of the upload latency, or the growth of
+	/// the RSS since the first sample, exceeds its objective, if the
+	/// share of failed, rejected and unsent uploads exceeds the maximum
+	/// error rate, or if the RSS of the server cannot be sampled.
+	/// Latencies include failed and rejected uploads (up to the
+	/// failure or timeout), so that failures show in the tail.
+	///
+	/// The test is configured with the following properties:
+	///   - soak.url: server URL (default: http://localhost:<http.port>)
+	///   - soak.pidFile: PID file of the server (see --pidfile); required for the RSS objective
+	///   - soak.duration: test duration in seconds (default: 86400)
+	///   - soak.timeScale: speed-up factor for the schedule (default: 1)
+	///   - soak.sites: number of sites (default: 4)
+	///   - soak.cameras: number of cameras per site (default: 16)
+	///   - soak.imageSize: size of an image in bytes (default: 262144)
+	///   - soak.snapshotInterval: seconds between periodic snapshots (default: 60)
+	///   - soak.eventRate: events per camera and hour (default: 2)
+	///   - soak.eventImages: images per event (default: 10)
+	///   - soak.eventImageInterval: milliseconds between event images (default: 200)
+	///   - soak.reconnectInterval: seconds between reconnect storms, 0 to disable (default: 3600)
+	///   - soak.threads: number of upload threads (default: 32)
+	///   - soak.sampleInterval: seconds between samples (default: 60)
+	///   - soak.slo.p99: maximum 99th percentile upload latency in milliseconds (default: 1000)
+	///   - soak.slo.rssGrowth: maximum RSS growth in bytes (default: 67108864)
+	///   - soak.slo.maxErrorRate: maximum share of uploads not accepted (default: 0.001)
+	///
+	/// Durations and intervals are in schedule time, which runs
+	/// timeScale times faster than real time. Hour rollovers follow
+	/// the real clock, as the server names its directories by it.
+{
+public:
+	struct Sample
+	{
+		Poco::Timestamp time;
+		Poco::UInt64 uploads = 0;
+		Poco::UInt64 errors = 0;
+		Poco::UInt64 rejected = 0;
+		Poco::Timestamp::TimeDiff p99 = 0;
+		Poco::UInt64 rss = 0;
+		int fds = 0;
+		int threads = 0;
+		Poco::UInt64 diskUsage = 0;
+	};
+
+	explicit SoakTest(const Poco::Util::AbstractConfiguration& config);
+		/// Creates the SoakTest.
+
+	~SoakTest();
+		/// Destroys the SoakTest.
+
+	bool run(std::ostream& ostr);
+		/// Runs the test, writing a line for every sample and a
+		/// summary to ostr. Returns true if all objectives are met.
+
+protected:
+	struct Camera
+	{
+		std::string site;
+		std::string name;
+		std::unique_ptr<Poco::Net::HTTPClientSession> pSession;
+		std::atomic<bool> reconnect{false};
+		Poco::FastMutex mutex;
+	};
+
+	struct Upload
+	{
+		std::size_t camera;
+		bool event;
+	};
+
+	void run();
+	void scheduleSnapshot(std::size_t camera, Poco::Timestamp after);
+	void scheduleEvents(std::size_t camera);
+	void scheduleRollover(Poco::Timestamp after);
+	void scheduleReconnect(Poco::Timestamp after);
+	void dispatch(const Upload& upload);
+	void upload(const Upload& upload);
+	Sample sample();
+	void writeSample(std::ostream& ostr, const Sample& sample);
+	Poco::Timestamp toReal(double scheduleSeconds) const;
+	double toSchedule(Poco::Timestamp time) const;
+	static Poco::Timestamp::TimeDiff percentile(std::vector<Poco::Timestamp::TimeDiff>& latencies, double p);
+	static Poco::UInt64 diskUsage(const std::string& path);
+	static int countEntries(const std::string& path);
+
+private:
+	enum Action
+	{
+		ACTION_SNAPSHOT,
+		ACTION_EVENT,
+		ACTION_ROLLOVER,
+		ACTION_RECONNECT
+	};
+
+	struct Scheduled
+	{
+		Action action;
+		std::size_t camera;
+	};
+
+	Poco::URI _url;
+	std::string _token;
+	std::string _storagePath;
+	std::string _pidFile;
+	double _duration;
+	double _timeScale;
+	int _sites;
+	int _camerasPerSite;
+	std::size_t _imageSize;
+	double _snapshotInterval;
+	double _eventRate;
+	int _eventImages;
+	double _eventImageInterval;
+	double _reconnectInterval;
+	int _threadCount;
+	double _sampleInterval;
+	Poco::Timestamp::TimeDiff _sloP99;
+	Poco::UInt64 _sloRSSGrowth;
+	double _sloMaxErrorRate;
+
+	std::string _image;
+	std::vector<std::unique_ptr<Camera>> _cameras;
+	std::multimap<Poco::Timestamp, Scheduled> _schedule;
+	Poco::Timestamp _start;
+	Poco::Random _random;
+
+	std::deque<Upload> _queue;
+	std::vector<std::unique_ptr<Poco::Thread>> _threads;
+	std::atomic<bool> _stopped{true};
+	std::vector<Poco::Timestamp::TimeDiff> _latencies;
+	std::size_t _sampleStart = 0;
+	Poco::UInt64 _uploads = 0;
+	Poco::UInt64 _errors = 0;
+	Poco::UInt64 _rejected = 0;
+	mutable Poco::FastMutex _mutex;
+	Poco::Condition _queueCondition;
+};
+
+
+#endif // SoakTest_INCLUDED
@@ -0,0 +1,284 @@
+//
+// SocketHandoff.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "SocketHandoff.h"
+#include "Poco/Net/ServerSocketImpl.h"
+#include "Poco/Util/ServerApplication.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const char SOCKET_MESSAGE = 'S';
+	const char RELEASED_MESSAGE = 'R';
+
+	class InheritedServerSocketImpl: public Poco::Net::ServerSocketImpl
+	{
+	public:
+		InheritedServerSocketImpl(int fd)
+		{
+			reset(fd);
+		}
+	};
+
+	sockaddr_un unixAddress(const std::string& path)
+	{
+		sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(addr.sun_path))
+			throw Poco::InvalidArgumentException("Handoff socket path too long"s, path);
+		std::memcpy(addr.sun_path, path.data(), path.size());
+		return addr;
+	}
+
+	void sendSocket(int peerFd, int socketFd)
+	{
+		char message = SOCKET_MESSAGE;
+		struct iovec iov;
+		iov.iov_base = &message;
+		iov.iov_len = 1;
+
+		union
+		{
+			char buffer[CMSG_SPACE(sizeof(int))];
+			struct cmsghdr align;
+		} control;
+		std::memset(&control, 0, sizeof(control));
+
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+
+		struct cmsghdr* pCmsg = CMSG_FIRSTHDR(&msg);
+		pCmsg->cmsg_level = SOL_SOCKET;
+		pCmsg->cmsg_type = SCM_RIGHTS;
+		pCmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		std::memcpy(CMSG_DATA(pCmsg), &socketFd, sizeof(int));
+
+		ssize_t n;
+		do
+		{
+			n = ::sendmsg(peerFd, &msg, MSG_NOSIGNAL);
+		}
+		while (n < 0 && errno == EINTR);
+		if (n != 1) throw Poco::IOException("Cannot send listening socket"s, Poco::Error::getMessage(errno));
+	}
+
+	int receiveSocket(int fd)
+	{
+		char message = 0;
+		struct iovec iov;
+		iov.iov_base = &message;
+		iov.iov_len = 1;
+
+		union
+		{
+			char buffer[CMSG_SPACE(sizeof(int))];
+			struct cmsghdr align;
+		} control;
+		std::memset(&control, 0, sizeof(control));
+
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+
+		ssize_t n;
+		do
+		{
+			n = ::recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+		}
+		while (n < 0 && errno == EINTR);
+		if (n != 1 || message != SOCKET_MESSAGE) throw Poco::IOException("Cannot receive listening socket"s);
+
+		struct cmsghdr* pCmsg = CMSG_FIRSTHDR(&msg);
+		if (!pCmsg || pCmsg->cmsg_level != SOL_SOCKET || pCmsg->cmsg_type != SCM_RIGHTS || pCmsg->cmsg_len != CMSG_LEN(sizeof(int)))
+			throw Poco::IOException("Handoff message does not contain a socket"s);
+
+		int socketFd;
+		std::memcpy(&socketFd, CMSG_DATA(pCmsg), sizeof(int));
+		return socketFd;
+	}
+}
+
+
+SocketHandoff::HandoffServerSocket::HandoffServerSocket(int fd):
+	Poco::Net::ServerSocket(new InheritedServerSocketImpl(fd), true)
+{
+}
+
+
+SocketHandoff::SocketHandoff(const std::string& path):
+	_path(path),
+	_thread("SocketHandoff"s),
+	_logger(Poco::Logger::get("SocketHandoff"s))
+{
+}
+
+
+SocketHandoff::~SocketHandoff()
+{
+	try
+	{
+		stop();
+		release();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+int SocketHandoff::takeOver(const std::string& path, Poco::Timespan timeout)
+{
+	const sockaddr_un addr = unixAddress(path);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) throw Poco::IOException("Cannot create handoff socket"s, Poco::Error::getMessage(errno));
+
+	if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		// no running server (or a stale socket file left by a crashed one)
+		::close(fd);
+		return -1;
+	}
+
+	int socketFd = -1;
+	try
+	{
+		socketFd = receiveSocket(fd);
+
+		// Wait until the old server has drained its connections
+		// and stopped its image store. It either confirms this,
+		// or simply exits.
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int rc;
+		do
+		{
+			rc = ::poll(&pfd, 1, static_cast<int>(timeout.totalMilliseconds()));
+		}
+		while (rc < 0 && errno == EINTR);
+		if (rc == 0) throw Poco::TimeoutException("Timeout waiting for the running server to release the listening socket"s);
+		if (rc < 0) throw Poco::IOException("Cannot wait for handoff"s, Poco::Error::getMessage(errno));
+
+		char message = 0;
+		if (::read(fd, &message, 1) == 1 && message != RELEASED_MESSAGE)
+			throw Poco::IOException("Unexpected handoff message"s);
+	}
+	catch (...)
+	{
+		if (socketFd >= 0) ::close(socketFd);
+		::close(fd);
+		throw;
+	}
+	::close(fd);
+	return socketFd;
+}
+
+
+void SocketHandoff::start(const Poco::Net::ServerSocket& socket)
+{
+	const sockaddr_un addr = unixAddress(_path);
+
+	_listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (_listenFd < 0) throw Poco::IOException("Cannot create handoff socket"s, Poco::Error::getMessage(errno));
+
+	// The previous server does not remove its socket
+	// file after handing off, so replace it.
+	::unlink(_path.c_str());
+	if (::bind(_listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(_listenFd, 1) != 0)
+	{
+		int err = errno;
+		::close(_listenFd);
+		_listenFd = -1;
+		throw Poco::IOException("Cannot listen on handoff socket "s + _path, Poco::Error::getMessage(err));
+	}
+
+	_socketFd = socket.impl()->sockfd();
+	_stopped = false;
+	_thread.start(*this);
+}
+
+
+void SocketHandoff::stop()
+{
+	if (_stopped) return;
+
+	_stopped = true;
+	_thread.join();
+	::close(_listenFd);
+	_listenFd = -1;
+
+	// After a handoff, the socket file belongs to the new process.
+	if (!_handedOff) ::unlink(_path.c_str());
+}
+
+
+void SocketHandoff::release()
+{
+	if (_peerFd >= 0)
+	{
+		char message = RELEASED_MESSAGE;
+		if (::write(_peerFd, &message, 1) != 1)
+		{
+			_logger.warning("Cannot notify new process: %s"s, Poco::Error::getMessage(errno));
+		}
+		::close(_peerFd);
+		_peerFd = -1;
+	}
+}
+
+
+void SocketHandoff::run()
+{
+	while (!_stopped)
+	{
+		struct pollfd pfd;
+		pfd.fd = _listenFd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (::poll(&pfd, 1, 500) <= 0) continue;
+
+		int peerFd = ::accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (peerFd < 0) continue;
+
+		try
+		{
+			sendSocket(peerFd, _socketFd);
+		}
+		catch (Poco::Exception& exc)
+		{
+			_logger.error("Socket handoff failed: %s"s, exc.displayText());
+			::close(peerFd);
+			continue;
+		}
+
+		_logger.notice("Listening socket handed off to new process, shutting down."s);
+		_peerFd = peerFd;
+		_handedOff = true;
+		Poco::Util::ServerApplication::terminate();
+		break;
+	}
+}
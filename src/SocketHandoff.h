@@ -0,0 +1,100 @@
+//
+// SocketHandoff.h
+//
+// Definition of the SocketHandoff class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef SocketHandoff_INCLUDED
+#define SocketHandoff_INCLUDED
+
+
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Timespan.h"
+#include "Poco/Logger.h"
+#include <atomic>
+#include <string>
+
+
+class SocketHandoff: public Poco::Runnable
+	/// SocketHandoff passes the listening socket of a running server
+	/// to a newly started server process over a Unix domain socket,
+	/// so that the server can be restarted (e.g., for an upgrade)
+	/// without ever refusing connections.
+	///
+	/// The running server listens on the handoff path. A new process
+	/// connects to it with takeOver() and receives the listening socket
+	/// (SCM_RIGHTS). The running server then stops accepting
+	/// connections, drains in-flight requests and stops its image
+	/// store, and finally calls release(), which lets the new process
+	/// continue its startup. Connections arriving in the meantime wait
+	/// in the listen backlog of the shared socket.
+{
+public:
+	class HandoffServerSocket: public Poco::Net::ServerSocket
+		/// A ServerSocket for an inherited, already listening socket.
+	{
+	public:
+		HandoffServerSocket(int fd);
+			/// Creates the HandoffServerSocket, taking ownership of fd.
+	};
+
+	explicit SocketHandoff(const std::string& path);
+		/// Creates the SocketHandoff for the given Unix domain socket path.
+
+	~SocketHandoff();
+		/// Destroys the SocketHandoff, stopping and releasing it if necessary.
+
+	static int takeOver(const std::string& path, Poco::Timespan timeout);
+		/// Connects to a server listening on the given handoff path
+		/// and receives its listening socket. Waits (at most timeout)
+		/// until the server has released its resources.
+		///
+		/// Returns the file descriptor of the listening socket, or -1
+		/// if no server is listening on path.
+
+	void start(const Poco::Net::ServerSocket& socket);
+		/// Starts listening for new processes on the handoff path.
+		/// When the socket has been handed off, the server is
+		/// asked to terminate.
+
+	void stop();
+		/// Stops listening for new processes.
+
+	bool handedOff() const;
+		/// Returns true if the socket has been handed off
+		/// to a new process.
+
+	void release();
+		/// Tells the new process that this server has stopped
+		/// using shared resources (storage, journal, etc.).
+
+protected:
+	void run();
+
+private:
+	std::string _path;
+	int _listenFd = -1;
+	int _socketFd = -1;
+	int _peerFd = -1;
+	Poco::Thread _thread;
+	std::atomic<bool> _stopped{true};
+	std::atomic<bool> _handedOff{false};
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline bool SocketHandoff::handedOff() const
+{
+	return _handedOff;
+}
+
+
+#endif // SocketHandoff_INCLUDED
@@ -0,0 +1,192 @@
+//
+// SpoolIndex.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "SpoolIndex.h"
+#include "ImageKey.h"
+#include "Poco/LocalDateTime.h"
+
+
+SpoolIndex::SpoolIndex(Poco::Timespan migrationDelay):
+	_migrationDelay(migrationDelay)
+{
+}
+
+
+SpoolIndex::~SpoolIndex()
+{
+}
+
+
+void SpoolIndex::add(const std::string& directory)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	if (_entries.find(directory) == _entries.end())
+	{
+		Entry entry;
+		entry.due = dueTime(directory);
+		_entries.emplace(directory, entry);
+	}
+}
+
+
+void SpoolIndex::beginWrite(const std::string& directory)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _entries.find(directory);
+	if (it == _entries.end())
+	{
+		Entry entry;
+		entry.due = dueTime(directory);
+		it = _entries.emplace(directory, entry).first;
+	}
+	it->second.writers++;
+	it->second.generation++;
+}
+
+
+void SpoolIndex::endWrite(const std::string& directory)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _entries.find(directory);
+	if (it != _entries.end() && it->second.writers > 0)
+	{
+		it->second.writers--;
+	}
+}
+
+
+bool SpoolIndex::contains(const std::string& directory) const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	return _entries.find(directory) != _entries.end();
+}
+
+
+bool SpoolIndex::nextDue(const Poco::Timestamp& now, std::string& directory)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto due = _entries.end();
+	for (auto it = _entries.begin(); it != _entries.end(); ++it)
+	{
+		if (!it->second.migrating && it->second.writers == 0 && it->second.due <= now && (due == _entries.end() || it->second.due < due->second.due))
+		{
+			due = it;
+		}
+	}
+	if (due != _entries.end())
+	{
+		due->second.migrating = true;
+		directory = due->first;
+		return true;
+	}
+	return false;
+}
+
+
+bool SpoolIndex::writeGeneration(const std::string& directory, Poco::UInt64& generation) const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _entries.find(directory);
+	if (it == _entries.end())
+	{
+		generation = 0;
+		return true;
+	}
+	generation = it->second.generation;
+	return it->second.writers == 0;
+}
+
+
+bool SpoolIndex::removeIfUnchanged(const std::string& directory, Poco::UInt64 generation, const std::function<void()>& remove)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _entries.find(directory);
+	const Poco::UInt64 current = it != _entries.end() ? it->second.generation : 0;
+	if (current != generation) return false;
+	remove();
+	return true;
+}
+
+
+bool SpoolIndex::finishMigration(const std::string& directory, const std::function<bool()>& removeDirectory)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _entries.find(directory);
+	if (it == _entries.end()) return true;
+
+	if (it->second.writers == 0)
+	{
+		if (removeDirectory())
+		{
+			_entries.erase(it);
+			return true;
+		}
+		return false;
+	}
+	it->second.migrating = false;
+	it->second.due = Poco::Timestamp() + Poco::Timespan::SECONDS;
+	return false;
+}
+
+
+void SpoolIndex::retryMigration(const std::string& directory, Poco::Timespan delay)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _entries.find(directory);
+	if (it != _entries.end())
+	{
+		it->second.migrating = false;
+		it->second.due = Poco::Timestamp() + delay.totalMicroseconds();
+	}
+}
+
+
+Poco::Timespan SpoolIndex::failMigration(const std::string& directory, Poco::Timespan delay, Poco::Timespan maxDelay)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _entries.find(directory);
+	if (it == _entries.end()) return 0;
+
+	const int failures = it->second.failures++;
+	Poco::Timespan::TimeDiff backoff = delay.totalMicroseconds() << (failures < 16 ? failures : 16);
+	if (backoff > maxDelay.totalMicroseconds() || backoff <= 0) backoff = maxDelay.totalMicroseconds();
+	it->second.migrating = false;
+	it->second.due = Poco::Timestamp() + backoff;
+	return backoff;
+}
+
+
+std::size_t SpoolIndex::size() const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	return _entries.size();
+}
+
+
+Poco::Timestamp SpoolIndex::dueTime(const std::string& directory) const
+{
+	Poco::LocalDateTime hour;
+	if (ImageKey::parseDirectory(directory, hour))
+	{
+		return hour.timestamp() + Poco::Timespan::HOURS + _migrationDelay.totalMicroseconds();
+	}
+	else
+	{
+		return Poco::Timestamp() + _migrationDelay.totalMicroseconds();
+	}
+}
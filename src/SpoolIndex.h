@@ -0,0 +1,114 @@
+//
+// SpoolIndex.h
+//
+// Definition of the SpoolIndex class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef SpoolIndex_INCLUDED
+#define SpoolIndex_INCLUDED
+
+
+#include "Poco/Timestamp.h"
+#include "Poco/Timespan.h"
+#include "Poco/Mutex.h"
+#include <functional>
+#include <unordered_map>
+#include <string>
+
+
+class SpoolIndex
+	/// SpoolIndex keeps track of the hour directories currently
+	/// present in the spool tier of a SpoolingImageStore.
+	///
+	/// Lookups use the index to decide which tier to check first.
+	/// The SpoolMigrator uses it to find hour directories that
+	/// are due for migration to the bulk tier.
+	///
+	/// An hour directory becomes due for migration once its hour has
+	/// passed, plus a configurable delay. Directories with pending
+	/// writes are not migrated, and no file is removed from the spool
+	/// if a write to its directory has started since it was copied.
+{
+public:
+	SpoolIndex(Poco::Timespan migrationDelay);
+		/// Creates the SpoolIndex.
+
+	~SpoolIndex();
+		/// Destroys the SpoolIndex.
+
+	void add(const std::string& directory);
+		/// Adds an existing hour directory to the index.
+
+	void beginWrite(const std::string& directory);
+		/// Registers a write to the given hour directory,
+		/// adding the directory to the index if necessary.
+		///
+		/// Must be called before the directory is created.
+
+	void endWrite(const std::string& directory);
+		/// Unregisters a write registered with beginWrite().
+
+	bool contains(const std::string& directory) const;
+		/// Returns true if the given hour directory is in the spool tier.
+
+	bool nextDue(const Poco::Timestamp& now, std::string& directory);
+		/// Finds an hour directory due for migration that is neither
+		/// being written to nor already being migrated, and marks it
+		/// as being migrated. Returns false if no directory is due.
+
+	bool writeGeneration(const std::string& directory, Poco::UInt64& generation) const;
+		/// Stores the number of writes started so far to the given
+		/// hour directory in generation. Returns false if there are
+		/// pending writes to the directory.
+
+	bool removeIfUnchanged(const std::string& directory, Poco::UInt64 generation, const std::function<void()>& remove);
+		/// Calls remove with the index locked if no write to the given
+		/// hour directory has started since writeGeneration() returned
+		/// generation. Returns false, without calling remove, otherwise.
+
+	bool finishMigration(const std::string& directory, const std::function<bool()>& removeDirectory);
+		/// Completes the migration of the given hour directory.
+		///
+		/// If there are no pending writes to the directory, calls removeDirectory
+		/// with the index locked and, if it returns true, removes the directory
+		/// from the index. If removeDirectory returns false, the directory stays
+		/// marked as being migrated until failMigration() is called. If there
+		/// are pending writes, the directory is scheduled for another migration
+		/// pass. Returns true if the directory has been removed.
+
+	void retryMigration(const std::string& directory, Poco::Timespan delay);
+		/// Schedules another migration attempt for the given hour
+		/// directory after the given delay.
+
+	Poco::Timespan failMigration(const std::string& directory, Poco::Timespan delay, Poco::Timespan maxDelay);
+		/// Schedules another migration attempt for the given hour
+		/// directory after a failed one. The delay is doubled for
+		/// every consecutive failure, up to maxDelay. Returns the
+		/// delay until the next attempt.
+
+	std::size_t size() const;
+		/// Returns the number of hour directories in the index.
+
+protected:
+	Poco::Timestamp dueTime(const std::string& directory) const;
+
+private:
+	struct Entry
+	{
+		Poco::Timestamp due;
+		int writers = 0;
+		Poco::UInt64 generation = 0;
+		int failures = 0;
+		bool migrating = false;
+	};
+
+	Poco::Timespan _migrationDelay;
+	std::unordered_map<std::string, Entry> _entries;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+#endif // SpoolIndex_INCLUDED
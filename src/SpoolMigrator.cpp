@@ -0,0 +1,160 @@
+//
+// SpoolMigrator.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "SpoolMigrator.h"
+#include "ImageKey.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <unistd.h>
+#include <cerrno>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const Poco::Timespan MAX_RETRY_DELAY(3600, 0);
+}
+
+
+SpoolMigrator::SpoolMigrator(SpoolIndex& index, FileImageStore& spool, ImageStore& bulk, int threads, Poco::Timespan retryDelay):
+	_index(index),
+	_spool(spool),
+	_bulk(bulk),
+	_threadCount(threads > 0 ? threads : 1),
+	_retryDelay(retryDelay),
+	_stopped(Poco::Event::EVENT_MANUALRESET),
+	_logger(Poco::Logger::get("SpoolMigrator"s))
+{
+}
+
+
+SpoolMigrator::~SpoolMigrator()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+void SpoolMigrator::start()
+{
+	_stopped.reset();
+	for (int i = 0; i < _threadCount; i++)
+	{
+		_threads.push_back(std::make_unique<Poco::Thread>("SpoolMigrator"s));
+		_threads.back()->start(*this);
+	}
+}
+
+
+void SpoolMigrator::stop()
+{
+	_stopped.set();
+	for (auto& pThread: _threads)
+	{
+		pThread->join();
+	}
+	_threads.clear();
+}
+
+
+void SpoolMigrator::run()
+{
+	while (!_stopped.tryWait(0))
+	{
+		std::string directory;
+		if (_index.nextDue(Poco::Timestamp(), directory))
+		{
+			migrate(directory);
+		}
+		else
+		{
+			_stopped.tryWait(1000);
+		}
+	}
+}
+
+
+void SpoolMigrator::migrate(const std::string& directory)
+{
+	try
+	{
+		// A write started while images are copied may leave a
+		// partial file in the spool, so files are only removed if
+		// no write to the directory has started since the copy.
+		Poco::UInt64 generation;
+		if (!_index.writeGeneration(directory, generation))
+		{
+			_index.retryMigration(directory, Poco::Timespan(1, 0));
+			return;
+		}
+
+		std::vector<std::string> names;
+		_spool.list(directory, names);
+		for (const auto& name: names)
+		{
+			if (_stopped.tryWait(0))
+			{
+				_index.retryMigration(directory, 0);
+				return;
+			}
+
+			// Stray files are left alone; they keep the directory
+			// from being removed, which is logged below.
+			const std::string key = directory + '/' + name;
+			if (!ImageKey::isValid(key)) continue;
+			Poco::UInt64 size;
+			auto pStream = _spool.open(key, size);
+			if (pStream)
+			{
+				_bulk.store(key, *pStream);
+			}
+		}
+
+		// The copies must be durable before the spool files are removed.
+		_bulk.sync();
+		for (const auto& name: names)
+		{
+			const std::string key = directory + '/' + name;
+			if (!ImageKey::isValid(key)) continue;
+			if (!_index.removeIfUnchanged(directory, generation, [this, &key]() { _spool.remove(key); }))
+			{
+				_logger.debug("%s has been written to during migration, retrying."s, directory);
+				_index.retryMigration(directory, Poco::Timespan(1, 0));
+				return;
+			}
+		}
+
+		const std::string path = _spool.root() + directory;
+		int err = 0;
+		if (_index.finishMigration(directory, [&path, &err]()
+			{
+				if (::rmdir(path.c_str()) == 0 || errno == ENOENT) return true;
+				err = errno;
+				return false;
+			}))
+		{
+			_logger.information("Migrated %s (%z images) to bulk storage."s, directory, names.size());
+		}
+		else if (err != 0)
+		{
+			const Poco::Timespan delay = _index.failMigration(directory, _retryDelay, MAX_RETRY_DELAY);
+			_logger.error("Cannot remove spool directory %s, retrying in %d seconds: %s"s, path, static_cast<int>(delay.totalSeconds()), Poco::Error::getMessage(err));
+		}
+	}
+	catch (Poco::Exception& exc)
+	{
+		const Poco::Timespan delay = _index.failMigration(directory, _retryDelay, MAX_RETRY_DELAY);
+		_logger.error("Failed to migrate %s, retrying in %d seconds: %s"s, directory, static_cast<int>(delay.totalSeconds()), exc.displayText());
+	}
+}
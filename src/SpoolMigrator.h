@@ -0,0 +1,65 @@
+//
+// SpoolMigrator.h
+//
+// Definition of the SpoolMigrator class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef SpoolMigrator_INCLUDED
+#define SpoolMigrator_INCLUDED
+
+
+#include "SpoolIndex.h"
+#include "FileImageStore.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/Logger.h"
+#include <memory>
+#include <vector>
+
+
+class SpoolMigrator: public Poco::Runnable
+	/// SpoolMigrator moves completed hour directories from the
+	/// spool tier to the bulk tier of a SpoolingImageStore,
+	/// using a fixed number of worker threads.
+	///
+	/// Each image is copied to the bulk tier before it is removed
+	/// from the spool, so an image can always be found in at least
+	/// one tier. Failed migrations are retried after a delay that
+	/// doubles with every consecutive failure, up to an hour.
+	/// Files that are not images are neither copied nor removed.
+{
+public:
+	SpoolMigrator(SpoolIndex& index, FileImageStore& spool, ImageStore& bulk, int threads, Poco::Timespan retryDelay);
+		/// Creates the SpoolMigrator.
+
+	~SpoolMigrator();
+		/// Destroys the SpoolMigrator, stopping it if necessary.
+
+	void start();
+		/// Starts the worker threads.
+
+	void stop();
+		/// Stops the worker threads. A migration in progress
+		/// is interrupted after the current image.
+
+protected:
+	void run();
+	void migrate(const std::string& directory);
+
+private:
+	SpoolIndex& _index;
+	FileImageStore& _spool;
+	ImageStore& _bulk;
+	int _threadCount;
+	Poco::Timespan _retryDelay;
+	std::vector<std::unique_ptr<Poco::Thread>> _threads;
+	Poco::Event _stopped;
+	Poco::Logger& _logger;
+};
+
+
+#endif // SpoolMigrator_INCLUDED
@@ -0,0 +1,125 @@
+//
+// SpoolingImageStore.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "SpoolingImageStore.h"
+#include "ImageKey.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/File.h"
+
+
+SpoolingImageStore::SpoolingImageStore(FileImageStore::Ptr pSpool, ImageStore::Ptr pBulk, int migrationThreads, Poco::Timespan migrationDelay, Poco::Timespan retryDelay):
+	_pSpool(pSpool),
+	_pBulk(pBulk),
+	_index(migrationDelay),
+	_migrator(_index, *_pSpool, *_pBulk, migrationThreads, retryDelay)
+{
+}
+
+
+SpoolingImageStore::~SpoolingImageStore()
+{
+}
+
+
+std::string SpoolingImageStore::store(const std::string& key, std::istream& istr)
+{
+	const std::string directory = ImageKey::directory(key);
+	_index.beginWrite(directory);
+	try
+	{
+		std::string path = _pSpool->store(key, istr);
+		_index.endWrite(directory);
+		return path;
+	}
+	catch (...)
+	{
+		_index.endWrite(directory);
+		throw;
+	}
+}
+
+
+std::unique_ptr<std::istream> SpoolingImageStore::open(const std::string& key, Poco::UInt64& size)
+{
+	// While an hour directory is being migrated, an image may
+	// already be in the bulk tier, but is only removed from the
+	// spool once it has been completely copied.
+	if (_index.contains(ImageKey::directory(key)))
+	{
+		auto pStream = _pSpool->open(key, size);
+		if (pStream) return pStream;
+		return _pBulk->open(key, size);
+	}
+	else
+	{
+		auto pStream = _pBulk->open(key, size);
+		if (pStream) return pStream;
+		return _pSpool->open(key, size);
+	}
+}
+
+
+bool SpoolingImageStore::exists(const std::string& key)
+{
+	return _pSpool->exists(key) || _pBulk->exists(key);
+}
+
+
+void SpoolingImageStore::list(const std::string& directory, std::vector<std::string>& names)
+{
+	_pSpool->list(directory, names);
+	_pBulk->list(directory, names);
+}
+
+
+void SpoolingImageStore::sync()
+{
+	_pSpool->sync();
+	_pBulk->sync();
+}
+
+
+void SpoolingImageStore::start()
+{
+	scan(std::string(), 0);
+	_pSpool->start();
+	_pBulk->start();
+	_migrator.start();
+}
+
+
+void SpoolingImageStore::stop()
+{
+	_migrator.stop();
+	_pBulk->stop();
+	_pSpool->stop();
+}
+
+
+void SpoolingImageStore::scan(const std::string& directory, int depth)
+{
+	// site/camera/YYYY/MM/DD/HH
+	const int HOUR_DEPTH = 6;
+
+	if (depth == HOUR_DEPTH)
+	{
+		_index.add(directory);
+		return;
+	}
+
+	Poco::File dir(_pSpool->root() + directory);
+	if (!dir.exists()) return;
+
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(dir); it != end; ++it)
+	{
+		if (it->isDirectory())
+		{
+			scan(directory.empty() ? it.name() : directory + '/' + it.name(), depth + 1);
+		}
+	}
+}
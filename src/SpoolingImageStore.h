@@ -0,0 +1,58 @@
+//
+// SpoolingImageStore.h
+//
+// Definition of the SpoolingImageStore class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef SpoolingImageStore_INCLUDED
+#define SpoolingImageStore_INCLUDED
+
+
+#include "ImageStore.h"
+#include "FileImageStore.h"
+#include "SpoolIndex.h"
+#include "SpoolMigrator.h"
+
+
+class SpoolingImageStore: public ImageStore
+	/// A two-tier ImageStore.
+	///
+	/// Images are always stored to a spool tier on fast local
+	/// storage, so that slow bulk storage (e.g., NFS or HDD) does
+	/// not stall request handlers. Completed hour directories
+	/// are moved to the bulk tier in the background by a
+	/// SpoolMigrator.
+	///
+	/// Lookups use a SpoolIndex to find images in either tier.
+{
+public:
+	SpoolingImageStore(FileImageStore::Ptr pSpool, ImageStore::Ptr pBulk, int migrationThreads, Poco::Timespan migrationDelay, Poco::Timespan retryDelay);
+		/// Creates the SpoolingImageStore.
+
+	~SpoolingImageStore();
+		/// Destroys the SpoolingImageStore.
+
+	// ImageStore
+	std::string store(const std::string& key, std::istream& istr) override;
+	std::unique_ptr<std::istream> open(const std::string& key, Poco::UInt64& size) override;
+	bool exists(const std::string& key) override;
+	void list(const std::string& directory, std::vector<std::string>& names) override;
+	void sync() override;
+	void start() override;
+	void stop() override;
+
+protected:
+	void scan(const std::string& directory, int depth);
+
+private:
+	FileImageStore::Ptr _pSpool;
+	ImageStore::Ptr _pBulk;
+	SpoolIndex _index;
+	SpoolMigrator _migrator;
+};
+
+
+#endif // SpoolingImageStore_INCLUDED
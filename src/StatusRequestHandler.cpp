@@ -0,0 +1,161 @@
+//
+// StatusRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "StatusRequestHandler.h"
+#include "ImageUploadRequestHandler.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/Net/HTMLForm.h"
+#include "Poco/Util/Application.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/URI.h"
+#include <sstream>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	void appendCell(std::string& html, const std::string& text, const char* tag = "td")
+	{
+		html += "<"s + tag + ">"s;
+		html += Poco::Net::htmlize(text);
+		html += "</"s + tag + ">"s;
+	}
+
+	void appendValues(std::string& html, const std::string& title, Poco::JSON::Object::Ptr pObject)
+	{
+		if (!pObject) return;
+
+		html += "<h2>"s + title + "</h2><table>"s;
+		for (const auto& value: *pObject)
+		{
+			html += "<tr>"s;
+			appendCell(html, value.first, "th");
+			appendCell(html, value.second.toString());
+			html += "</tr>"s;
+		}
+		html += "</table>"s;
+	}
+
+	void appendRates(std::string& html, const std::string& name, Poco::JSON::Object::Ptr pImages, Poco::JSON::Object::Ptr pBytes)
+	{
+		html += "<tr>"s;
+		appendCell(html, name, "th");
+		appendCell(html, pImages->get("total"s).toString());
+		for (const auto& window: {"perMinute1"s, "perMinute5"s, "perMinute15"s})
+		{
+			appendCell(html, Poco::NumberFormatter::format(pImages->getValue<double>(window), 1));
+		}
+		for (const auto& window: {"perMinute1"s, "perMinute5"s, "perMinute15"s})
+		{
+			appendCell(html, Poco::NumberFormatter::format(pBytes->getValue<double>(window)/(1024*1024), 2));
+		}
+		html += "</tr>"s;
+	}
+}
+
+
+const std::string StatusRequestHandler::PATH("/status");
+
+
+StatusRequestHandler::StatusRequestHandler(const ServerStatistics& statistics):
+	_statistics(statistics)
+{
+}
+
+
+StatusRequestHandler::~StatusRequestHandler()
+{
+}
+
+
+void StatusRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	auto& app = Poco::Util::Application::instance();
+
+	if (!ImageUploadRequestHandler::authorize(request, app.config().getString("upload.token"s, ""s)))
+	{
+		app.logger().warning("Invalid or missing token for request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing or invalid upload token"s);
+	}
+
+	Poco::JSON::Object::Ptr pStatus = _statistics.toJSON();
+	response.set("Cache-Control"s, "no-cache"s);
+	if (wantsJSON(request))
+	{
+		std::ostringstream ostr;
+		pStatus->stringify(ostr, 2);
+		const std::string json = ostr.str();
+		response.setContentType("application/json"s);
+		response.sendBuffer(json.data(), json.size());
+	}
+	else
+	{
+		const std::string html = formatHTML(*pStatus);
+		response.setContentType("text/html"s);
+		response.sendBuffer(html.data(), html.size());
+	}
+}
+
+
+bool StatusRequestHandler::wantsJSON(const Poco::Net::HTTPServerRequest& request)
+{
+	Poco::URI uri(request.getURI());
+	Poco::Net::HTMLForm params;
+	params.read(uri.getRawQuery());
+	const std::string format = params.get("format"s, ""s);
+	if (!format.empty()) return format == "json";
+
+	return request.get("Accept"s, ""s).find("application/json"s) != std::string::npos;
+}
+
+
+std::string StatusRequestHandler::formatHTML(const Poco::JSON::Object& status)
+{
+	std::string html("<!DOCTYPE html>\n<html><head><title>Image Upload Server Status</title>"
+		"<style>body{font-family:sans-serif} table{border-collapse:collapse;margin-bottom:1em} "
+		"th,td{border:1px solid #ccc;padding:2px 8px;text-align:right} th{text-align:left}</style>"
+		"</head><body><header><h1>Image Upload Server Status</h1></header><section>");
+
+	html += "<p>"s + Poco::Net::htmlize(status.get("time"s).toString());
+	html += ", up "s + status.get("uptime"s).toString() + " seconds</p>"s;
+
+	appendValues(html, "Server"s, status.getObject("server"s));
+	appendValues(html, "Queues"s, status.getObject("queues"s));
+
+	html += "<h2>Uploads</h2><table><tr><th rowspan=\"2\">Site</th><th rowspan=\"2\">Images</th>"
+		"<th colspan=\"3\">Images/min (1, 5, 15 min)</th><th colspan=\"3\">MB/min (1, 5, 15 min)</th></tr>"
+		"<tr><th>1</th><th>5</th><th>15</th><th>1</th><th>5</th><th>15</th></tr>"s;
+	Poco::JSON::Object::Ptr pUploads = status.getObject("uploads"s);
+	appendRates(html, "All sites"s, pUploads->getObject("images"s), pUploads->getObject("bytes"s));
+	Poco::JSON::Array::Ptr pSites = status.getArray("sites"s);
+	for (std::size_t i = 0; i < pSites->size(); i++)
+	{
+		Poco::JSON::Object::Ptr pSite = pSites->getObject(static_cast<unsigned>(i));
+		appendRates(html, pSite->get("site"s).toString(), pSite->getObject("images"s), pSite->getObject("bytes"s));
+	}
+	html += "</table>"s;
+
+	appendValues(html, "Disk"s, status.getObject("disk"s));
+
+	html += "<h2>Slowest Requests (last 5 minutes)</h2><table><tr><th>Time</th><th>Client</th><th>Request</th><th>Status</th><th>Duration (ms)</th></tr>"s;
+	Poco::JSON::Array::Ptr pSlow = status.getArray("slowRequests"s);
+	for (std::size_t i = 0; i < pSlow->size(); i++)
+	{
+		Poco::JSON::Object::Ptr pRequest = pSlow->getObject(static_cast<unsigned>(i));
+		html += "<tr>"s;
+		appendCell(html, pRequest->get("time"s).toString());
+		appendCell(html, pRequest->get("client"s).toString());
+		appendCell(html, pRequest->get("method"s).toString() + " "s + pRequest->get("path"s).toString());
+		appendCell(html, pRequest->get("status"s).toString());
+		appendCell(html, Poco::NumberFormatter::format(pRequest->getValue<double>("duration"s), 1));
+		html += "</tr>"s;
+	}
+	html += "</table></section></body></html>"s;
+	return html;
+}
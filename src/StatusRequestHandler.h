@@ -0,0 +1,47 @@
+//
+// StatusRequestHandler.h
+//
+// Definition of the StatusRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef StatusRequestHandler_INCLUDED
+#define StatusRequestHandler_INCLUDED
+
+
+#include "ServerStatistics.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include <string>
+
+
+class StatusRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Sends the status page with the runtime statistics of the
+	/// server, as HTML or, if requested with format=json or
+	/// an Accept header containing application/json, as JSON.
+{
+public:
+	StatusRequestHandler(const ServerStatistics& statistics);
+		/// Creates the StatusRequestHandler.
+
+	~StatusRequestHandler();
+		/// Destroys the StatusRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+	static const std::string PATH;
+		/// The path of the status page ("/status").
+
+protected:
+	static bool wantsJSON(const Poco::Net::HTTPServerRequest& request);
+	static std::string formatHTML(const Poco::JSON::Object& status);
+
+private:
+	const ServerStatistics& _statistics;
+};
+
+
+#endif // StatusRequestHandler_INCLUDED
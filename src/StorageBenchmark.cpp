@@ -0,0 +1,123 @@
+//
+// StorageBenchmark.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "StorageBenchmark.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Random.h"
+#include "Poco/Path.h"
+#include "Poco/File.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+
+using namespace std::string_literals;
+
+
+StorageBenchmark::StorageBenchmark(const Poco::Util::AbstractConfiguration& config):
+	_path(config.getString("benchmark.path"s, Poco::Path(Poco::Path::temp()).pushDirectory("AxisCameraUploadBenchmark"s).toString())),
+	_images(config.getInt("benchmark.images"s, 1000)),
+	_imageSize(config.getUInt("benchmark.imageSize"s, 262144)),
+	_bufferSize(config.getUInt("upload.bufferSize"s, 262144)),
+	_alignment(config.getUInt("upload.directAlignment"s, 4096))
+{
+}
+
+
+StorageBenchmark::~StorageBenchmark()
+{
+}
+
+
+void StorageBenchmark::run(std::ostream& ostr)
+{
+	std::string data(_imageSize, '\0');
+	Poco::Random rnd;
+	rnd.seed();
+	for (auto& c: data) c = rnd.nextChar();
+
+	ostr << "Storage benchmark: " << _images << " images of " << _imageSize << " bytes in " << _path << "\n\n";
+	ostr << "mode        images/s        MB/s      cached\n";
+	runWriteMode(ImageWriter::WRITE_BUFFERED, data, ostr);
+	runWriteMode(ImageWriter::WRITE_DONTNEED, data, ostr);
+	runWriteMode(ImageWriter::WRITE_DIRECT, data, ostr);
+}
+
+
+void StorageBenchmark::runWriteMode(ImageWriter::WriteMode mode, const std::string& data, std::ostream& ostr)
+{
+	Poco::Path dir(_path);
+	dir.makeDirectory();
+	dir.pushDirectory(ImageWriter::formatWriteMode(mode));
+	Poco::File(dir).createDirectories();
+
+	AlignedBufferPool pool(_bufferSize, _alignment, 4);
+	ImageWriter writer(mode, pool);
+	std::vector<std::string> paths;
+	paths.reserve(_images);
+
+	Poco::Stopwatch sw;
+	sw.start();
+	for (int i = 0; i < _images; i++)
+	{
+		Poco::Path p(dir, Poco::NumberFormatter::format0(i, 6) + ".jpg"s);
+		paths.push_back(p.toString());
+		Poco::MemoryInputStream istr(data.data(), data.size());
+		writer.write(istr, paths.back());
+	}
+	sw.stop();
+
+	Poco::UInt64 resident = 0;
+	for (const auto& path: paths)
+	{
+		resident += residentBytes(path);
+	}
+	Poco::File(dir).remove(true);
+
+	const double seconds = sw.elapsed()/1000000.0;
+	const double totalBytes = static_cast<double>(data.size())*_images;
+	std::string line = ImageWriter::formatWriteMode(mode);
+	line.resize(10, ' ');
+	line += Poco::NumberFormatter::format(seconds > 0 ? _images/seconds : 0.0, 12, 1);
+	line += Poco::NumberFormatter::format(seconds > 0 ? totalBytes/seconds/(1024*1024) : 0.0, 12, 1);
+	line += Poco::NumberFormatter::format(totalBytes > 0 ? 100.0*resident/totalBytes : 0.0, 11, 1);
+	line += "%";
+	ostr << line << std::endl;
+}
+
+
+Poco::UInt64 StorageBenchmark::residentBytes(const std::string& path)
+{
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return 0;
+
+	Poco::UInt64 resident = 0;
+	struct stat st;
+	if (::fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void* pAddr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (pAddr != MAP_FAILED)
+		{
+			const long pageSize = ::sysconf(_SC_PAGESIZE);
+			std::vector<unsigned char> pages((st.st_size + pageSize - 1)/pageSize);
+			if (::mincore(pAddr, st.st_size, pages.data()) == 0)
+			{
+				for (auto p: pages)
+				{
+					if (p & 1) resident += pageSize;
+				}
+			}
+			::munmap(pAddr, st.st_size);
+		}
+	}
+	::close(fd);
+	return resident;
+}
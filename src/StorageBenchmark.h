@@ -0,0 +1,54 @@
+//
+// StorageBenchmark.h
+//
+// Definition of the StorageBenchmark class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef StorageBenchmark_INCLUDED
+#define StorageBenchmark_INCLUDED
+
+
+#include "ImageWriter.h"
+#include "Poco/Util/AbstractConfiguration.h"
+#include <ostream>
+#include <string>
+
+
+class StorageBenchmark
+	/// StorageBenchmark measures the cost of storing images on the
+	/// local disk with the different write modes supported by
+	/// ImageWriter, and how much of the written data remains
+	/// in the page cache afterwards.
+	///
+	/// The benchmark is configured with the following properties:
+	///   - benchmark.path: directory for benchmark files (default: temporary directory)
+	///   - benchmark.images: number of images written per mode (default: 1000)
+	///   - benchmark.imageSize: size of an image in bytes (default: 262144)
+{
+public:
+	explicit StorageBenchmark(const Poco::Util::AbstractConfiguration& config);
+		/// Creates the StorageBenchmark.
+
+	~StorageBenchmark();
+		/// Destroys the StorageBenchmark.
+
+	void run(std::ostream& ostr);
+		/// Runs the benchmark and writes the results to ostr.
+
+protected:
+	void runWriteMode(ImageWriter::WriteMode mode, const std::string& data, std::ostream& ostr);
+	static Poco::UInt64 residentBytes(const std::string& path);
+
+private:
+	std::string _path;
+	int _images;
+	std::size_t _imageSize;
+	std::size_t _bufferSize;
+	std::size_t _alignment;
+};
+
+
+#endif // StorageBenchmark_INCLUDED
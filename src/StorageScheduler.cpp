@@ -0,0 +1,166 @@
+//
+// StorageScheduler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "StorageScheduler.h"
+#include "Poco/Exception.h"
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const std::string PRIORITY_NAMES[StorageScheduler::PRIORITY_COUNT] =
+	{
+		"event"s,
+		"periodic"s
+	};
+}
+
+
+StorageScheduler::StorageScheduler(int slots, int eventWeight, int periodicWeight, std::size_t quantum, int maxSiteSlots):
+	_free(slots > 0 ? slots : 1),
+	_maxSiteSlots(maxSiteSlots)
+{
+	_weights[PRIORITY_EVENT] = eventWeight > 0 ? eventWeight : 1;
+	_weights[PRIORITY_PERIODIC] = periodicWeight > 0 ? periodicWeight : 1;
+	for (int i = 0; i < PRIORITY_COUNT; i++)
+	{
+		_current[i] = 0;
+		_queues.emplace_back(quantum);
+	}
+}
+
+
+StorageScheduler::~StorageScheduler()
+{
+}
+
+
+void StorageScheduler::acquire(Priority priority, const std::string& site, std::size_t size)
+{
+	Waiter waiter;
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		// Free slots are only left while all waiting
+		// handlers are from sites at their limit.
+		if (_free > 0 && eligible(site))
+		{
+			_free--;
+			enter(site);
+			return;
+		}
+		waiter.site = site;
+		_queues[priority].push(site, &waiter, size);
+	}
+
+	// The slot is handed over by dispatch().
+	waiter.ready.wait();
+}
+
+
+void StorageScheduler::release(const std::string& site)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto it = _siteSlots.find(site);
+	if (it != _siteSlots.end() && --it->second == 0)
+	{
+		_siteSlots.erase(it);
+	}
+	_free++;
+	dispatch();
+}
+
+
+int StorageScheduler::waiting(Priority priority) const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	return static_cast<int>(_queues[priority].size());
+}
+
+
+void StorageScheduler::dispatch()
+{
+	unsigned excluded = 0;
+	while (_free > 0)
+	{
+		int priority = next(excluded);
+		if (priority < 0) break;
+
+		Waiter* pWaiter;
+		if (_queues[priority].pop(pWaiter, [this](const std::string& site) { return eligible(site); }))
+		{
+			_free--;
+			enter(pWaiter->site);
+			pWaiter->ready.set();
+		}
+		else
+		{
+			// all sites waiting in this class are at their limit
+			excluded |= 1u << priority;
+		}
+	}
+}
+
+
+int StorageScheduler::next(unsigned excluded)
+{
+	// Smooth weighted round-robin over the classes with waiters:
+	// every class gains its weight, the class with the most credit
+	// is chosen and pays the total weight.
+	int best = -1;
+	int total = 0;
+	for (int i = 0; i < PRIORITY_COUNT; i++)
+	{
+		if (_queues[i].empty())
+		{
+			_current[i] = 0;
+		}
+		else if ((excluded & (1u << i)) == 0)
+		{
+			_current[i] += _weights[i];
+			total += _weights[i];
+			if (best < 0 || _current[i] > _current[best]) best = i;
+		}
+	}
+	if (best >= 0) _current[best] -= total;
+	return best;
+}
+
+
+bool StorageScheduler::eligible(const std::string& site) const
+{
+	if (_maxSiteSlots <= 0) return true;
+
+	auto it = _siteSlots.find(site);
+	return it == _siteSlots.end() || it->second < _maxSiteSlots;
+}
+
+
+void StorageScheduler::enter(const std::string& site)
+{
+	_siteSlots[site]++;
+}
+
+
+StorageScheduler::Priority StorageScheduler::parsePriority(const std::string& priority)
+{
+	for (int i = 0; i < PRIORITY_COUNT; i++)
+	{
+		if (priority == PRIORITY_NAMES[i]) return static_cast<Priority>(i);
+	}
+	throw Poco::InvalidArgumentException("Invalid priority class"s, priority);
+}
+
+
+const std::string& StorageScheduler::formatPriority(Priority priority)
+{
+	return PRIORITY_NAMES[priority];
+}
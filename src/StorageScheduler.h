@@ -0,0 +1,122 @@
+//
+// StorageScheduler.h
+//
+// Definition of the StorageScheduler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef StorageScheduler_INCLUDED
+#define StorageScheduler_INCLUDED
+
+
+#include "DeficitRoundRobin.h"
+#include "Poco/Event.h"
+#include "Poco/Mutex.h"
+#include <unordered_map>
+#include <vector>
+#include <string>
+
+
+class StorageScheduler
+	/// StorageScheduler limits the number of images being stored
+	/// at the same time, and decides which waiting request handler
+	/// may store its image next.
+	///
+	/// Every request belongs to a priority class. Each class has its
+	/// own queue of waiting handlers, and free storage slots are
+	/// given to the classes by smooth weighted round-robin, so that
+	/// event images overtake periodic snapshots under load without
+	/// starving them completely.
+	///
+	/// Within a class, waiting handlers are served fairly across
+	/// sites by deficit round-robin, weighted by image size, so that
+	/// a site with many cameras cannot starve a small one. Optionally,
+	/// the number of slots used by a single site is limited.
+{
+public:
+	enum Priority
+	{
+		PRIORITY_EVENT,    /// Event-triggered images (e.g., motion detection).
+		PRIORITY_PERIODIC, /// Periodic snapshots.
+		PRIORITY_COUNT
+	};
+
+	class Slot
+		/// Acquires a storage slot from a StorageScheduler, waiting
+		/// if necessary, and releases it upon destruction.
+	{
+	public:
+		Slot(StorageScheduler& scheduler, Priority priority, const std::string& site, std::size_t size):
+			_scheduler(scheduler),
+			_site(site)
+		{
+			_scheduler.acquire(priority, site, size);
+		}
+
+		~Slot()
+		{
+			_scheduler.release(_site);
+		}
+
+	private:
+		Slot(const Slot&) = delete;
+		Slot& operator = (const Slot&) = delete;
+
+		StorageScheduler& _scheduler;
+		std::string _site;
+	};
+
+	StorageScheduler(int slots, int eventWeight, int periodicWeight, std::size_t quantum, int maxSiteSlots);
+		/// Creates the StorageScheduler with the given number of
+		/// storage slots and the relative weights of the classes.
+		///
+		/// The quantum is the number of bytes credited to a site on
+		/// each turn. If maxSiteSlots is not zero, no more than
+		/// maxSiteSlots images from the same site are stored at the
+		/// same time.
+
+	~StorageScheduler();
+		/// Destroys the StorageScheduler.
+
+	void acquire(Priority priority, const std::string& site, std::size_t size);
+		/// Waits until a storage slot is available for an image
+		/// of the given size, class and site, and acquires it.
+
+	void release(const std::string& site);
+		/// Releases a slot acquired with acquire().
+
+	int waiting(Priority priority) const;
+		/// Returns the number of handlers waiting in the given class.
+
+	static Priority parsePriority(const std::string& priority);
+		/// Parses a priority class name ("event" or "periodic").
+
+	static const std::string& formatPriority(Priority priority);
+		/// Returns the name of the given priority class.
+
+protected:
+	struct Waiter
+	{
+		std::string site;
+		Poco::Event ready;
+	};
+
+	int next(unsigned excluded);
+	void dispatch();
+	bool eligible(const std::string& site) const;
+	void enter(const std::string& site);
+
+private:
+	int _free;
+	int _maxSiteSlots;
+	int _weights[PRIORITY_COUNT];
+	int _current[PRIORITY_COUNT];
+	std::vector<DeficitRoundRobin<Waiter*>> _queues;
+	std::unordered_map<std::string, int> _siteSlots;
+	mutable Poco::FastMutex _mutex;
+};
+
+
+#endif // StorageScheduler_INCLUDED
@@ -0,0 +1,383 @@
+//
+// StorageStrategyBenchmark.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "StorageStrategyBenchmark.h"
+#include "AlignedBufferPool.h"
+#include "ImageWriter.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/StringTokenizer.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Random.h"
+#include "Poco/Path.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include "Poco/Error.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	class StrategyWorker: public Poco::Runnable
+		/// Writes the images of a subset of the cameras.
+	{
+	public:
+		StrategyWorker(StorageStrategyBenchmark::Strategy strategy, const std::string& root, const std::vector<int>& cameras, const std::string& data, std::size_t bufferSize, std::size_t alignment, int images, int imagesPerHour, int batch):
+			_strategy(strategy),
+			_root(root),
+			_cameras(cameras),
+			_data(data),
+			_pool(bufferSize, alignment, 1),
+			_writer(strategy == StorageStrategyBenchmark::STRATEGY_DIRECT ? ImageWriter::WRITE_DIRECT : ImageWriter::WRITE_BUFFERED, _pool),
+			_images(images),
+			_imagesPerHour(imagesPerHour > 0 ? imagesPerHour : 1),
+			_batch(batch > 0 ? batch : 1),
+			_segments(cameras.size())
+		{
+		}
+
+		void run()
+		{
+			try
+			{
+				for (int i = 0; i < _images; i++)
+				{
+					for (std::size_t c = 0; c < _cameras.size(); c++)
+					{
+						if (_strategy == StorageStrategyBenchmark::STRATEGY_FILE || _strategy == StorageStrategyBenchmark::STRATEGY_DIRECT)
+							writeFile(c, i);
+						else
+							writeSegment(c, i);
+						_result.images++;
+						_result.bytes += _data.size();
+					}
+				}
+				syncSegments();
+				for (auto& segment: _segments)
+				{
+					if (segment.fd >= 0) closeFile(segment.fd);
+					segment.fd = -1;
+				}
+			}
+			catch (Poco::Exception& exc)
+			{
+				_error = exc.displayText();
+			}
+		}
+
+		const StorageStrategyBenchmark::Result& result() const
+		{
+			return _result;
+		}
+
+		const std::string& error() const
+		{
+			return _error;
+		}
+
+	protected:
+		struct Segment
+		{
+			int hour = -1;
+			int fd = -1;
+			bool dirty = false;
+		};
+
+		std::string hourDirectory(std::size_t camera, int hour) const
+		{
+			// <root>/site<NN>/camera<NNN>/<hour>/
+			return _root + "site"s + Poco::NumberFormatter::format0(_cameras[camera]/8, 2) + "/camera"s + Poco::NumberFormatter::format0(_cameras[camera], 3) + "/"s + Poco::NumberFormatter::format0(hour, 4) + "/"s;
+		}
+
+		void writeFile(std::size_t camera, int image)
+		{
+			const std::string dir = hourDirectory(camera, image/_imagesPerHour);
+			createDirectories(dir);
+
+			const std::string path = dir + Poco::NumberFormatter::format0(image, 6) + ".jpg"s;
+			Poco::MemoryInputStream istr(_data.data(), _data.size());
+			_result.metadataCalls += 2; // open and close in ImageWriter
+			_writer.write(istr, path);
+
+			// ImageWriter does not sync, so the file is
+			// reopened to make the image durable.
+			int fd = openFile(path, O_RDONLY | O_CLOEXEC);
+			try
+			{
+				sync(fd, path);
+			}
+			catch (...)
+			{
+				closeFile(fd);
+				throw;
+			}
+			closeFile(fd);
+		}
+
+		void writeSegment(std::size_t camera, int image)
+		{
+			Segment& segment = _segments[camera];
+			const int hour = image/_imagesPerHour;
+			const std::string dir = hourDirectory(camera, hour);
+			if (segment.hour != hour)
+			{
+				if (segment.fd >= 0)
+				{
+					if (segment.dirty) sync(segment.fd, dir);
+					closeFile(segment.fd);
+				}
+				segment.fd = -1;
+				createDirectories(dir);
+				segment.fd = openFile(dir + "images.segment"s, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC);
+				segment.hour = hour;
+				segment.dirty = false;
+			}
+
+			Poco::UInt64 size = _data.size();
+			struct iovec iov[2];
+			iov[0].iov_base = &size;
+			iov[0].iov_len = sizeof(size);
+			iov[1].iov_base = const_cast<char*>(_data.data());
+			iov[1].iov_len = _data.size();
+			const ssize_t total = static_cast<ssize_t>(sizeof(size) + _data.size());
+			ssize_t n;
+			do
+			{
+				n = ::writev(segment.fd, iov, 2);
+			}
+			while (n < 0 && errno == EINTR);
+			if (n != total) throw Poco::WriteFileException(dir, n < 0 ? Poco::Error::getMessage(errno) : "short write"s);
+
+			if (_strategy == StorageStrategyBenchmark::STRATEGY_SEGMENT)
+			{
+				sync(segment.fd, dir);
+			}
+			else
+			{
+				segment.dirty = true;
+				if (++_unsynced >= _batch) syncSegments();
+			}
+		}
+
+		void syncSegments()
+		{
+			for (auto& segment: _segments)
+			{
+				if (segment.dirty)
+				{
+					sync(segment.fd, _root);
+					segment.dirty = false;
+				}
+			}
+			_unsynced = 0;
+		}
+
+		void createDirectories(const std::string& path)
+		{
+			// the same system calls as Poco::File::createDirectories()
+			struct stat st;
+			_result.metadataCalls++;
+			if (::stat(path.c_str(), &st) == 0) return;
+
+			Poco::Path p(path);
+			p.makeDirectory();
+			if (p.depth() > 0)
+			{
+				createDirectories(p.parent().toString());
+			}
+			_result.metadataCalls++;
+			if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+				throw Poco::CreateFileException(path, Poco::Error::getMessage(errno));
+		}
+
+		int openFile(const std::string& path, int flags)
+		{
+			_result.metadataCalls++;
+			int fd = ::open(path.c_str(), flags, 0644);
+			if (fd < 0) throw Poco::CreateFileException(path, Poco::Error::getMessage(errno));
+			return fd;
+		}
+
+		void closeFile(int fd)
+		{
+			_result.metadataCalls++;
+			::close(fd);
+		}
+
+		void sync(int fd, const std::string& path)
+		{
+			Poco::Stopwatch sw;
+			sw.start();
+			if (::fdatasync(fd) != 0) throw Poco::WriteFileException(path, Poco::Error::getMessage(errno));
+			_result.syncLatencies.push_back(sw.elapsed());
+		}
+
+	private:
+		StorageStrategyBenchmark::Strategy _strategy;
+		std::string _root;
+		std::vector<int> _cameras;
+		const std::string& _data;
+		AlignedBufferPool _pool;
+		ImageWriter _writer;
+		int _images;
+		int _imagesPerHour;
+		int _batch;
+		int _unsynced = 0;
+		std::vector<Segment> _segments;
+		StorageStrategyBenchmark::Result _result;
+		std::string _error;
+	};
+
+	Poco::Int64 percentile(std::vector<Poco::Int64>& values, double p)
+	{
+		if (values.empty()) return 0;
+
+		std::size_t n = static_cast<std::size_t>(std::ceil(p*values.size()));
+		if (n > 0) n--;
+		std::nth_element(values.begin(), values.begin() + n, values.end());
+		return values[n];
+	}
+}
+
+
+StorageStrategyBenchmark::StorageStrategyBenchmark(const Poco::Util::AbstractConfiguration& config):
+	_path(config.getString("benchmark.path"s, Poco::Path(Poco::Path::temp()).pushDirectory("AxisCameraUploadBenchmark"s).toString())),
+	_cameras(config.getInt("benchmark.cameras"s, 16)),
+	_threads(config.getInt("benchmark.threads"s, 4)),
+	_images(config.getInt("benchmark.images"s, 200)),
+	_imagesPerHour(config.getInt("benchmark.imagesPerHour"s, 60)),
+	_batch(config.getInt("benchmark.batch"s, 8)),
+	_bufferSize(config.getUInt("upload.bufferSize"s, 262144)),
+	_alignment(config.getUInt("upload.directAlignment"s, 4096))
+{
+	Poco::StringTokenizer sizes(config.getString("benchmark.imageSizes"s, "262144"s), ","s, Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+	for (const auto& size: sizes)
+	{
+		_imageSizes.push_back(static_cast<std::size_t>(Poco::NumberParser::parseUnsigned64(size)));
+	}
+	if (_cameras < 1) _cameras = 1;
+	if (_threads < 1) _threads = 1;
+	if (_threads > _cameras) _threads = _cameras;
+}
+
+
+StorageStrategyBenchmark::~StorageStrategyBenchmark()
+{
+}
+
+
+void StorageStrategyBenchmark::run(std::ostream& ostr)
+{
+	ostr << "Storage strategy benchmark: " << _cameras << " cameras, " << _images << " images each, "
+		<< _threads << " threads, in " << _path << "\n\n";
+	ostr << "strategy   size KB    images/s        MB/s  sync p50 ms  sync p99 ms  meta/image\n";
+	for (auto imageSize: _imageSizes)
+	{
+		runStrategy(STRATEGY_FILE, imageSize, ostr);
+		runStrategy(STRATEGY_DIRECT, imageSize, ostr);
+		runStrategy(STRATEGY_SEGMENT, imageSize, ostr);
+		runStrategy(STRATEGY_BATCH, imageSize, ostr);
+	}
+}
+
+
+void StorageStrategyBenchmark::runStrategy(Strategy strategy, std::size_t imageSize, std::ostream& ostr)
+{
+	Poco::Path dir(_path);
+	dir.makeDirectory();
+	dir.pushDirectory(formatStrategy(strategy));
+	Poco::File(dir).createDirectories();
+
+	std::string data(imageSize, '\0');
+	Poco::Random rnd;
+	rnd.seed();
+	for (auto& c: data) c = rnd.nextChar();
+
+	std::vector<std::unique_ptr<StrategyWorker>> workers;
+	std::vector<std::unique_ptr<Poco::Thread>> threads;
+	for (int t = 0; t < _threads; t++)
+	{
+		std::vector<int> cameras;
+		for (int c = t; c < _cameras; c += _threads) cameras.push_back(c);
+		workers.push_back(std::make_unique<StrategyWorker>(strategy, dir.toString(), cameras, data, _bufferSize, _alignment, _images, _imagesPerHour, _batch));
+		threads.push_back(std::make_unique<Poco::Thread>());
+	}
+
+	Poco::Stopwatch sw;
+	sw.start();
+	for (std::size_t t = 0; t < threads.size(); t++)
+	{
+		threads[t]->start(*workers[t]);
+	}
+	for (auto& pThread: threads)
+	{
+		pThread->join();
+	}
+	sw.stop();
+	Poco::File(dir).remove(true);
+
+	Result total;
+	std::string error;
+	for (const auto& pWorker: workers)
+	{
+		const Result& result = pWorker->result();
+		total.images += result.images;
+		total.bytes += result.bytes;
+		total.metadataCalls += result.metadataCalls;
+		total.syncLatencies.insert(total.syncLatencies.end(), result.syncLatencies.begin(), result.syncLatencies.end());
+		if (error.empty()) error = pWorker->error();
+	}
+
+	std::string line = formatStrategy(strategy);
+	line.resize(9, ' ');
+	line += Poco::NumberFormatter::format(imageSize/1024.0, 9, 0);
+	if (!error.empty())
+	{
+		line += "  failed: "s;
+		line += error;
+	}
+	else
+	{
+		const double seconds = sw.elapsed()/1000000.0;
+		line += Poco::NumberFormatter::format(seconds > 0 ? total.images/seconds : 0.0, 12, 1);
+		line += Poco::NumberFormatter::format(seconds > 0 ? total.bytes/seconds/(1024*1024) : 0.0, 12, 1);
+		line += Poco::NumberFormatter::format(percentile(total.syncLatencies, 0.5)/1000.0, 13, 2);
+		line += Poco::NumberFormatter::format(percentile(total.syncLatencies, 0.99)/1000.0, 13, 2);
+		line += Poco::NumberFormatter::format(total.images > 0 ? static_cast<double>(total.metadataCalls)/total.images : 0.0, 12, 2);
+	}
+	ostr << line << std::endl;
+}
+
+
+std::string StorageStrategyBenchmark::formatStrategy(Strategy strategy)
+{
+	switch (strategy)
+	{
+	case STRATEGY_FILE:
+		return "file"s;
+	case STRATEGY_DIRECT:
+		return "direct"s;
+	case STRATEGY_SEGMENT:
+		return "segment"s;
+	case STRATEGY_BATCH:
+		return "batch"s;
+	}
+	return ""s;
+}
@@ -0,0 +1,100 @@
+//
+// StorageStrategyBenchmark.h
+//
+// Definition of the StorageStrategyBenchmark class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef StorageStrategyBenchmark_INCLUDED
+#define StorageStrategyBenchmark_INCLUDED
+
+
+#include "Poco/Util/AbstractConfiguration.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+class StorageStrategyBenchmark
+	/// StorageStrategyBenchmark compares strategies for storing
+	/// images on the local disk, with several cameras uploading
+	/// concurrently and every image made durable before it is
+	/// acknowledged.
+	///
+	/// The following strategies are compared:
+	///   - file: a file per image in an hourly directory per camera,
+	///     written by an ImageWriter through the page cache (like
+	///     FileImageStore), then reopened and synced with fdatasync().
+	///     FileImageStore itself does not sync every image; the sync
+	///     is added so that all strategies are measured as durable.
+	///   - direct: like file, but written in ImageWriter's direct mode
+	///     (O_DIRECT, falling back to dontneed if not supported).
+	///   - segment: images appended to a segment file per camera
+	///     and hour, synced after every image.
+	///   - batch: like segment, but each thread syncs its segment
+	///     files once for a batch of images (group commit).
+	///
+	/// For every strategy and image size, the throughput, the latency
+	/// of fdatasync() calls and the number of metadata system calls
+	/// (open, close, stat, mkdir) per image are reported.
+	///
+	/// The benchmark is configured with the following properties:
+	///   - benchmark.path: directory for benchmark files (default: temporary directory)
+	///   - benchmark.imageSizes: comma-separated list of image sizes in bytes (default: 262144)
+	///   - benchmark.cameras: number of cameras (default: 16)
+	///   - benchmark.threads: number of writing threads (default: 4)
+	///   - benchmark.images: number of images per camera (default: 200)
+	///   - benchmark.imagesPerHour: images per camera and hour directory or segment (default: 60)
+	///   - benchmark.batch: images per sync for the batch strategy (default: 8)
+	///
+	/// upload.bufferSize and upload.directAlignment configure the
+	/// ImageWriter buffers, like for the upload server.
+{
+public:
+	enum Strategy
+	{
+		STRATEGY_FILE,
+		STRATEGY_DIRECT,
+		STRATEGY_SEGMENT,
+		STRATEGY_BATCH
+	};
+
+	struct Result
+	{
+		Poco::UInt64 images = 0;
+		Poco::UInt64 bytes = 0;
+		Poco::UInt64 metadataCalls = 0;
+		std::vector<Poco::Int64> syncLatencies;
+	};
+
+	explicit StorageStrategyBenchmark(const Poco::Util::AbstractConfiguration& config);
+		/// Creates the StorageStrategyBenchmark.
+
+	~StorageStrategyBenchmark();
+		/// Destroys the StorageStrategyBenchmark.
+
+	void run(std::ostream& ostr);
+		/// Runs the benchmark and writes the results to ostr.
+
+	static std::string formatStrategy(Strategy strategy);
+		/// Returns the name of the given strategy.
+
+protected:
+	void runStrategy(Strategy strategy, std::size_t imageSize, std::ostream& ostr);
+
+private:
+	std::string _path;
+	std::vector<std::size_t> _imageSizes;
+	int _cameras;
+	int _threads;
+	int _images;
+	int _imagesPerHour;
+	int _batch;
+	std::size_t _bufferSize;
+	std::size_t _alignment;
+};
+
+
+#endif // StorageStrategyBenchmark_INCLUDED
@@ -0,0 +1,309 @@
+//
+// TimeLapseGenerator.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "TimeLapseGenerator.h"
+#include "ImageKey.h"
+#include "JpegScanner.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DirectoryIterator.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Path.h"
+#include "Poco/File.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <vector>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	const Poco::UInt64 MAX_FRAME_SIZE = 64*1024*1024;
+	const int MAX_FPS = 60;
+	const std::string VIDEO_SUFFIX(".avi");
+
+	std::string formatTime(const Poco::LocalDateTime& time)
+	{
+		return Poco::DateTimeFormatter::format(time, "%Y-%m-%dT%H:%M:%S"s);
+	}
+}
+
+
+TimeLapseGenerator::TimeLapseGenerator(ImageStore& store, const std::string& outputPath, std::size_t maxJobs):
+	_store(store),
+	_outputPath(Poco::Path(outputPath).makeDirectory().toString()),
+	_maxJobs(maxJobs > 0 ? maxJobs : 1),
+	_thread("TimeLapseGenerator"s),
+	_logger(Poco::Logger::get("TimeLapseGenerator"s))
+{
+}
+
+
+TimeLapseGenerator::~TimeLapseGenerator()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+void TimeLapseGenerator::start()
+{
+	Poco::File dir(_outputPath);
+	dir.createDirectories();
+	Poco::DirectoryIterator end;
+	for (Poco::DirectoryIterator it(dir); it != end; ++it)
+	{
+		const std::string& name = it.name();
+		if (name.find(VIDEO_SUFFIX) != std::string::npos)
+		{
+			Poco::File(it.path()).remove();
+		}
+	}
+
+	_stopped = false;
+	_thread.start(*this);
+}
+
+
+void TimeLapseGenerator::stop()
+{
+	if (_stopped) return;
+
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_stopped = true;
+		_jobQueued.broadcast();
+	}
+	_thread.join();
+}
+
+
+unsigned TimeLapseGenerator::submit(const std::string& site, const std::string& camera, const Poco::LocalDateTime& from, const Poco::LocalDateTime& to, Poco::Timespan interval, int fps)
+{
+	if (!ImageKey::isValid(ImageKey::format(site, camera, from))) throw Poco::InvalidArgumentException("Invalid site or camera"s);
+	if (!(from < to)) throw Poco::InvalidArgumentException("Empty time range"s);
+	if (interval < 0) throw Poco::InvalidArgumentException("Invalid interval"s);
+	if (fps < 1 || fps > MAX_FPS) throw Poco::InvalidArgumentException("Invalid frame rate"s);
+
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	if (_jobs.size() >= _maxJobs)
+	{
+		auto it = std::find_if(_jobs.begin(), _jobs.end(), [](const Job& job)
+			{
+				return job.status == STATUS_DONE || job.status == STATUS_FAILED;
+			});
+		if (it == _jobs.end()) throw Poco::IllegalStateException("Too many time-lapse jobs"s);
+
+		Poco::File video(path(it->id));
+		if (video.exists()) video.remove();
+		_jobs.erase(it);
+	}
+
+	Job job;
+	job.id = _nextId++;
+	job.site = site;
+	job.camera = camera;
+	job.from = from;
+	job.to = to;
+	job.interval = interval;
+	job.fps = fps;
+	_jobs.push_back(job);
+	_jobQueued.signal();
+	return job.id;
+}
+
+
+bool TimeLapseGenerator::find(unsigned id, Job& job) const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	for (const auto& j: _jobs)
+	{
+		if (j.id == id)
+		{
+			job = j;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+std::string TimeLapseGenerator::path(unsigned id) const
+{
+	return _outputPath + Poco::NumberFormatter::format(id) + VIDEO_SUFFIX;
+}
+
+
+Poco::JSON::Array::Ptr TimeLapseGenerator::toJSON() const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	Poco::JSON::Array::Ptr pJobs = new Poco::JSON::Array;
+	for (const auto& job: _jobs)
+	{
+		pJobs->add(toJSON(job));
+	}
+	return pJobs;
+}
+
+
+Poco::JSON::Object::Ptr TimeLapseGenerator::toJSON(const Job& job)
+{
+	Poco::JSON::Object::Ptr pJob = new Poco::JSON::Object;
+	pJob->set("id"s, job.id);
+	pJob->set("site"s, job.site);
+	pJob->set("camera"s, job.camera);
+	pJob->set("from"s, formatTime(job.from));
+	pJob->set("to"s, formatTime(job.to));
+	pJob->set("interval"s, job.interval.totalSeconds());
+	pJob->set("fps"s, job.fps);
+	pJob->set("status"s, formatStatus(job.status));
+	pJob->set("frames"s, job.frames);
+	if (job.status == STATUS_FAILED) pJob->set("error"s, job.error);
+	return pJob;
+}
+
+
+std::string TimeLapseGenerator::formatStatus(Status status)
+{
+	switch (status)
+	{
+	case STATUS_QUEUED:
+		return "queued"s;
+	case STATUS_RUNNING:
+		return "running"s;
+	case STATUS_DONE:
+		return "done"s;
+	case STATUS_FAILED:
+		return "failed"s;
+	}
+	return ""s;
+}
+
+
+void TimeLapseGenerator::run()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+
+			auto it = _jobs.end();
+			while (!_stopped)
+			{
+				it = std::find_if(_jobs.begin(), _jobs.end(), [](const Job& j) { return j.status == STATUS_QUEUED; });
+				if (it != _jobs.end()) break;
+				_jobQueued.wait(_mutex);
+			}
+			if (_stopped) return;
+
+			it->status = STATUS_RUNNING;
+			job = *it;
+		}
+
+		try
+		{
+			generate(job);
+			job.status = STATUS_DONE;
+			_logger.information("Time-lapse video %u of %s/%s completed (%u frames)."s, job.id, job.site, job.camera, job.frames);
+		}
+		catch (Poco::Exception& exc)
+		{
+			job.status = STATUS_FAILED;
+			job.error = exc.displayText();
+			_logger.error("Time-lapse video %u of %s/%s failed: %s"s, job.id, job.site, job.camera, job.error);
+		}
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		for (auto& j: _jobs)
+		{
+			if (j.id == job.id) j = job;
+		}
+	}
+}
+
+
+void TimeLapseGenerator::generate(Job& job)
+{
+	AviWriter writer(path(job.id), job.fps);
+
+	// Image names sort by upload time, so the time range
+	// and intervals can be compared as names.
+	const std::string toName = ImageKey::fileName(ImageKey::format(job.site, job.camera, job.to));
+	Poco::LocalDateTime next = job.from;
+	std::string nextName = ImageKey::fileName(ImageKey::format(job.site, job.camera, next));
+
+	std::vector<std::string> names;
+	std::string data;
+	bool full = false;
+	Poco::LocalDateTime hour(job.from.year(), job.from.month(), job.from.day(), job.from.hour());
+	while (hour < job.to && !full)
+	{
+		if (_stopped) throw Poco::IllegalStateException("Server stopped"s);
+
+		const std::string directory = ImageKey::directory(ImageKey::format(job.site, job.camera, hour));
+		names.clear();
+		_store.list(directory, names);
+		std::sort(names.begin(), names.end());
+		names.erase(std::unique(names.begin(), names.end()), names.end());
+
+		for (const auto& name: names)
+		{
+			if (name < nextName) continue;
+			if (name >= toName) break;
+			if (!ImageKey::isValid(directory + '/' + name)) continue;
+
+			const std::size_t frames = writer.frames();
+			if (!addFrame(writer, directory + '/' + name, data))
+			{
+				_logger.warning("Time-lapse video %u reached the maximum size of AVI files at %s."s, job.id, name);
+				full = true;
+				break;
+			}
+			if (writer.frames() > frames && job.interval > 0)
+			{
+				while (nextName <= name)
+				{
+					next += job.interval;
+					nextName = ImageKey::fileName(ImageKey::format(job.site, job.camera, next));
+				}
+			}
+		}
+		hour += Poco::Timespan(Poco::Timespan::HOURS);
+	}
+
+	if (writer.frames() == 0) throw Poco::NotFoundException("No images in the given time range"s);
+	writer.close();
+	job.frames = writer.frames();
+}
+
+
+bool TimeLapseGenerator::addFrame(AviWriter& writer, const std::string& key, std::string& data)
+{
+	Poco::UInt64 size = 0;
+	auto pStream = _store.open(key, size);
+	if (!pStream || size > MAX_FRAME_SIZE) return true;
+
+	data.resize(static_cast<std::size_t>(size));
+	pStream->read(&data[0], static_cast<std::streamsize>(data.size()));
+	if (static_cast<std::size_t>(pStream->gcount()) != data.size() || !JpegScanner::isValid(data.data(), data.size()))
+	{
+		_logger.warning("Skipping malformed image %s."s, key);
+		return true;
+	}
+	return writer.addFrame(data.data(), data.size());
+}
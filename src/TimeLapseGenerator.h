@@ -0,0 +1,129 @@
+//
+// TimeLapseGenerator.h
+//
+// Definition of the TimeLapseGenerator class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef TimeLapseGenerator_INCLUDED
+#define TimeLapseGenerator_INCLUDED
+
+
+#include "ImageStore.h"
+#include "AviWriter.h"
+#include "Poco/JSON/Array.h"
+#include "Poco/JSON/Object.h"
+#include "Poco/LocalDateTime.h"
+#include "Poco/Timespan.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/Logger.h"
+#include <atomic>
+#include <deque>
+#include <string>
+
+
+class TimeLapseGenerator: public Poco::Runnable
+	/// TimeLapseGenerator assembles time-lapse videos from
+	/// stored images in the background.
+	///
+	/// A job takes the images of a camera in a time range, at most
+	/// one per interval, and writes them as the frames of a Motion
+	/// JPEG video (see AviWriter) to the output directory. The JPEG
+	/// data of the images is copied unchanged, one image at a time,
+	/// so the memory used by a job does not depend on the length
+	/// of the time range.
+	///
+	/// Jobs are run one at a time, in the order submitted. Up to
+	/// maxJobs jobs are kept; when a new job is submitted, the oldest
+	/// completed job and its video are removed. Jobs are not kept
+	/// across restarts; videos left in the output directory are
+	/// removed by start().
+{
+public:
+	enum Status
+	{
+		STATUS_QUEUED,
+		STATUS_RUNNING,
+		STATUS_DONE,
+		STATUS_FAILED
+	};
+
+	struct Job
+	{
+		unsigned id = 0;
+		std::string site;
+		std::string camera;
+		Poco::LocalDateTime from;
+		Poco::LocalDateTime to;
+		Poco::Timespan interval;
+		int fps = 10;
+		Status status = STATUS_QUEUED;
+		Poco::UInt32 frames = 0;
+		std::string error;
+	};
+
+	TimeLapseGenerator(ImageStore& store, const std::string& outputPath, std::size_t maxJobs);
+		/// Creates the TimeLapseGenerator, reading images from store
+		/// and writing videos to the directory at outputPath.
+
+	~TimeLapseGenerator();
+		/// Destroys the TimeLapseGenerator, stopping it if necessary.
+
+	void start();
+		/// Starts the background thread.
+
+	void stop();
+		/// Stops the background thread. A running job is
+		/// interrupted and fails.
+
+	unsigned submit(const std::string& site, const std::string& camera, const Poco::LocalDateTime& from, const Poco::LocalDateTime& to, Poco::Timespan interval, int fps);
+		/// Queues a job for the images of the given camera uploaded
+		/// in [from, to), taking the first image of every interval
+		/// (or all images if interval is 0), played back with fps
+		/// frames per second. Returns the ID of the job.
+		///
+		/// Throws a Poco::InvalidArgumentException if the parameters
+		/// are not valid, or a Poco::IllegalStateException if maxJobs
+		/// jobs are queued or running.
+
+	bool find(unsigned id, Job& job) const;
+		/// Looks up the job with the given ID.
+		/// Returns false if there is no such job.
+
+	std::string path(unsigned id) const;
+		/// Returns the path of the video of the given job.
+
+	Poco::JSON::Array::Ptr toJSON() const;
+		/// Returns all jobs as JSON array, oldest first.
+
+	static Poco::JSON::Object::Ptr toJSON(const Job& job);
+		/// Returns the given job as JSON object.
+
+	static std::string formatStatus(Status status);
+		/// Returns the name of the given status.
+
+protected:
+	void run();
+	void generate(Job& job);
+	bool addFrame(AviWriter& writer, const std::string& key, std::string& data);
+
+private:
+	ImageStore& _store;
+	const std::string _outputPath;
+	const std::size_t _maxJobs;
+	std::deque<Job> _jobs;
+	unsigned _nextId = 1;
+	Poco::Thread _thread;
+	mutable Poco::FastMutex _mutex;
+	Poco::Condition _jobQueued;
+	std::atomic<bool> _stopped{true};
+	Poco::Logger& _logger;
+};
+
+
+#endif // TimeLapseGenerator_INCLUDED
@@ -0,0 +1,175 @@
+//
+// TimeLapseRequestHandler.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "TimeLapseRequestHandler.h"
+#include "ImageUploadRequestHandler.h"
+#include "Poco/Net/HTMLForm.h"
+#include "Poco/JSON/Stringifier.h"
+#include "Poco/Util/Application.h"
+#include "Poco/DateTimeParser.h"
+#include "Poco/DateTime.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Exception.h"
+#include "Poco/URI.h"
+#include <algorithm>
+#include <sstream>
+
+
+using namespace std::string_literals;
+
+
+const std::string TimeLapseRequestHandler::PATH("/timelapse");
+
+
+TimeLapseRequestHandler::TimeLapseRequestHandler(TimeLapseGenerator& generator):
+	_generator(generator)
+{
+}
+
+
+TimeLapseRequestHandler::~TimeLapseRequestHandler()
+{
+}
+
+
+void TimeLapseRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	auto& app = Poco::Util::Application::instance();
+
+	if (!ImageUploadRequestHandler::authorize(request, app.config().getString("upload.token"s, ""s)))
+	{
+		app.logger().warning("Invalid or missing token for request from %s: %s %s"s, request.clientAddress().toString(), request.getMethod(), request.getURI());
+		ImageUploadRequestHandler::ignoreContent(request);
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing or invalid upload token"s);
+	}
+
+	const std::string path = Poco::URI(request.getURI()).getPath();
+	if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_POST && path == PATH)
+	{
+		submitJob(request, response);
+	}
+	else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET && path == PATH)
+	{
+		sendJSON(response, _generator.toJSON());
+	}
+	else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET)
+	{
+		sendJob(request, response, path.substr(PATH.size() + 1));
+	}
+	else
+	{
+		ImageUploadRequestHandler::ignoreContent(request);
+		ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED, "Method not allowed"s);
+	}
+}
+
+
+bool TimeLapseRequestHandler::matches(const std::string& method, const std::string& path)
+{
+	// POST or GET /timelapse, GET /timelapse/<id>; anything else
+	// (e.g., uploads from a site named "timelapse") is not ours.
+	if (path.compare(0, PATH.size(), PATH) != 0) return false;
+	if (path.size() == PATH.size())
+	{
+		return method == Poco::Net::HTTPRequest::HTTP_POST || method == Poco::Net::HTTPRequest::HTTP_GET;
+	}
+	if (method != Poco::Net::HTTPRequest::HTTP_GET || path[PATH.size()] != '/' || path.size() == PATH.size() + 1) return false;
+	return std::all_of(path.begin() + PATH.size() + 1, path.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+
+void TimeLapseRequestHandler::submitJob(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	Poco::Net::HTMLForm params(request, request.stream());
+	unsigned id;
+	try
+	{
+		id = _generator.submit(
+			params.get("site"s),
+			params.get("camera"s),
+			parseTime(params.get("from"s)),
+			parseTime(params.get("to"s)),
+			Poco::Timespan(Poco::NumberParser::parse(params.get("interval"s, "0"s)), 0),
+			Poco::NumberParser::parse(params.get("fps"s, "10"s)));
+	}
+	catch (Poco::NotFoundException& exc)
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Missing parameter: "s + exc.message());
+	}
+	catch (Poco::SyntaxException& exc)
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "Invalid parameter: "s + exc.message());
+	}
+	catch (Poco::InvalidArgumentException& exc)
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, exc.message());
+	}
+	catch (Poco::IllegalStateException& exc)
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE, exc.message());
+	}
+
+	TimeLapseGenerator::Job job;
+	_generator.find(id, job);
+	response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_ACCEPTED);
+	response.set("Location"s, PATH + '/' + Poco::NumberFormatter::format(id));
+	sendJSON(response, TimeLapseGenerator::toJSON(job));
+}
+
+
+void TimeLapseRequestHandler::sendJob(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const std::string& id)
+{
+	unsigned n;
+	TimeLapseGenerator::Job job;
+	if (!Poco::NumberParser::tryParseUnsigned(id, n) || !_generator.find(n, job))
+	{
+		return ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_NOT_FOUND, "Time-lapse job not found"s);
+	}
+
+	if (job.status == TimeLapseGenerator::STATUS_DONE)
+	{
+		try
+		{
+			response.set("Content-Disposition"s, "attachment; filename=\"timelapse-"s + id + ".avi\""s);
+			response.sendFile(_generator.path(n), "video/x-msvideo"s);
+		}
+		catch (Poco::FileException&)
+		{
+			// removed in the meantime
+			ImageUploadRequestHandler::sendResponse(request, Poco::Net::HTTPResponse::HTTP_NOT_FOUND, "Time-lapse video not found"s);
+		}
+	}
+	else
+	{
+		sendJSON(response, TimeLapseGenerator::toJSON(job));
+	}
+}
+
+
+void TimeLapseRequestHandler::sendJSON(Poco::Net::HTTPServerResponse& response, const Poco::Dynamic::Var& json)
+{
+	std::ostringstream ostr;
+	Poco::JSON::Stringifier::stringify(json, ostr, 2);
+	const std::string data = ostr.str();
+	response.set("Cache-Control"s, "no-cache"s);
+	response.setContentType("application/json"s);
+	response.sendBuffer(data.data(), data.size());
+}
+
+
+Poco::LocalDateTime TimeLapseRequestHandler::parseTime(const std::string& time)
+{
+	Poco::DateTime dateTime;
+	int tzd;
+	if (!Poco::DateTimeParser::tryParse("%Y-%m-%dT%H:%M:%S"s, time, dateTime, tzd))
+	{
+		throw Poco::SyntaxException(time);
+	}
+	// Image keys use the local time of the server.
+	return Poco::LocalDateTime(dateTime.year(), dateTime.month(), dateTime.day(), dateTime.hour(), dateTime.minute(), dateTime.second());
+}
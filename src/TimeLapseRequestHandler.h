@@ -0,0 +1,60 @@
+//
+// TimeLapseRequestHandler.h
+//
+// Definition of the TimeLapseRequestHandler class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef TimeLapseRequestHandler_INCLUDED
+#define TimeLapseRequestHandler_INCLUDED
+
+
+#include "TimeLapseGenerator.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Dynamic/Var.h"
+#include <string>
+
+
+class TimeLapseRequestHandler: public Poco::Net::HTTPRequestHandler
+	/// Submits time-lapse jobs to a TimeLapseGenerator and
+	/// serves their state and videos:
+	///
+	///   - POST /timelapse with site, camera, from, to and optionally
+	///     interval (seconds) and fps submits a job (202 Accepted).
+	///     Times are local times in the format YYYY-MM-DDTHH:MM:SS.
+	///   - GET /timelapse lists all jobs as JSON.
+	///   - GET /timelapse/<id> sends the video of a completed job,
+	///     or the state of the job as JSON if it is not completed.
+{
+public:
+	TimeLapseRequestHandler(TimeLapseGenerator& generator);
+		/// Creates the TimeLapseRequestHandler.
+
+	~TimeLapseRequestHandler();
+		/// Destroys the TimeLapseRequestHandler.
+
+	void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+
+	static bool matches(const std::string& method, const std::string& path);
+		/// Returns true if a request with the given method and path
+		/// is one of the time-lapse requests listed above.
+
+	static const std::string PATH;
+		/// The path of the time-lapse jobs ("/timelapse").
+
+protected:
+	void submitJob(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+	void sendJob(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, const std::string& id);
+	static void sendJSON(Poco::Net::HTTPServerResponse& response, const Poco::Dynamic::Var& json);
+	static Poco::LocalDateTime parseTime(const std::string& time);
+
+private:
+	TimeLapseGenerator& _generator;
+};
+
+
+#endif // TimeLapseRequestHandler_INCLUDED
@@ -0,0 +1,209 @@
+//
+// TimingWheel.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "TimingWheel.h"
+#include "Poco/Exception.h"
+
+
+using namespace std::string_literals;
+
+
+TimingWheel::TimingWheel(Poco::Timespan tick):
+	_tick(tick.totalMicroseconds() > 0 ? tick : Poco::Timespan(0, 1000)),
+	_thread("TimingWheel"s),
+	_logger(Poco::Logger::get("TimingWheel"s))
+{
+}
+
+
+TimingWheel::~TimingWheel()
+{
+	try
+	{
+		stop();
+	}
+	catch (...)
+	{
+	}
+
+	for (auto& timer: _timers)
+	{
+		delete timer.second;
+	}
+}
+
+
+void TimingWheel::start()
+{
+	if (_running) return;
+
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		// Ticks are counted from the start, so that time spent
+		// stopped does not count towards pending timers.
+		_epoch.update();
+		_epoch -= static_cast<Poco::Clock::ClockDiff>(_current*_tick.totalMicroseconds());
+	}
+	_stop.reset();
+	_thread.start(*this);
+	_running = true;
+}
+
+
+void TimingWheel::stop()
+{
+	if (!_running) return;
+
+	_stop.set();
+	_thread.join();
+	_running = false;
+}
+
+
+TimingWheel::TimerId TimingWheel::schedule(Poco::Timespan delay, Callback callback)
+{
+	Node* pNode = new Node;
+	pNode->callback = std::move(callback);
+
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	// Round up, so that a timer never expires early.
+	const Poco::UInt64 ticks = delay.totalMicroseconds() > 0 ? (delay.totalMicroseconds() + _tick.totalMicroseconds() - 1)/_tick.totalMicroseconds() : 0;
+	pNode->expires = _current + (ticks > 0 ? ticks : 1);
+	pNode->id = _nextId++;
+	_timers[pNode->id] = pNode;
+	insert(pNode);
+	return pNode->id;
+}
+
+
+bool TimingWheel::cancel(TimerId id)
+{
+	Node* pNode = nullptr;
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+
+		auto it = _timers.find(id);
+		if (it == _timers.end()) return false;
+		pNode = it->second;
+		_timers.erase(it);
+		unlink(pNode);
+	}
+	delete pNode;
+	return true;
+}
+
+
+std::size_t TimingWheel::size() const
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	return _timers.size();
+}
+
+
+void TimingWheel::run()
+{
+	std::vector<Node*> expired;
+	do
+	{
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+
+			const Poco::UInt64 now = static_cast<Poco::UInt64>(_epoch.elapsed()/_tick.totalMicroseconds());
+			while (_current < now)
+			{
+				advance(expired);
+			}
+		}
+
+		for (Node* pNode: expired)
+		{
+			try
+			{
+				pNode->callback();
+			}
+			catch (Poco::Exception& exc)
+			{
+				_logger.log(exc);
+			}
+			catch (std::exception& exc)
+			{
+				_logger.error("Timer callback failed: %s"s, std::string(exc.what()));
+			}
+			delete pNode;
+		}
+		expired.clear();
+	}
+	while (!_stop.tryWait(static_cast<long>(_tick.totalMilliseconds() > 0 ? _tick.totalMilliseconds() : 1)));
+}
+
+
+void TimingWheel::advance(std::vector<Node*>& expired)
+{
+	_current++;
+
+	// When the first level wraps around, the next slot of the
+	// level above is moved down, and so on.
+	for (int level = 1; level < LEVELS; level++)
+	{
+		if ((_current >> (level*SLOT_BITS)) << (level*SLOT_BITS) != _current) break;
+		cascade(level);
+	}
+
+	Node& list = _slots[0][_current & (SLOTS - 1)];
+	while (list.pNext != &list)
+	{
+		Node* pNode = list.pNext;
+		unlink(pNode);
+		if (pNode->expires <= _current)
+		{
+			_timers.erase(pNode->id);
+			expired.push_back(pNode);
+		}
+		else
+		{
+			// Beyond the range of the wheel when scheduled.
+			insert(pNode);
+		}
+	}
+}
+
+
+void TimingWheel::cascade(int level)
+{
+	Node& list = _slots[level][(_current >> (level*SLOT_BITS)) & (SLOTS - 1)];
+	Node pending;
+	while (list.pNext != &list)
+	{
+		Node* pNode = list.pNext;
+		unlink(pNode);
+		link(pending, pNode);
+	}
+	while (pending.pNext != &pending)
+	{
+		Node* pNode = pending.pNext;
+		unlink(pNode);
+		insert(pNode);
+	}
+}
+
+
+void TimingWheel::insert(Node* pNode)
+{
+	const Poco::UInt64 maxDelta = (Poco::UInt64(1) << (LEVELS*SLOT_BITS)) - 1;
+	const Poco::UInt64 expires = pNode->expires - _current > maxDelta ? _current + maxDelta : pNode->expires;
+	const Poco::UInt64 delta = expires - _current;
+
+	int level = 0;
+	while (level < LEVELS - 1 && delta >= (Poco::UInt64(1) << ((level + 1)*SLOT_BITS)))
+	{
+		level++;
+	}
+	link(_slots[level][(expires >> (level*SLOT_BITS)) & (SLOTS - 1)], pNode);
+}
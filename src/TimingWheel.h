@@ -0,0 +1,140 @@
+//
+// TimingWheel.h
+//
+// Definition of the TimingWheel class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef TimingWheel_INCLUDED
+#define TimingWheel_INCLUDED
+
+
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/Mutex.h"
+#include "Poco/Clock.h"
+#include "Poco/Timespan.h"
+#include "Poco/Logger.h"
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+
+class TimingWheel: public Poco::Runnable
+	/// TimingWheel runs large numbers of timers (e.g., one or more
+	/// per camera) on a single background thread.
+	///
+	/// Timers are kept in a hierarchical timing wheel with LEVELS
+	/// levels of SLOTS slots each. A slot of the first level covers
+	/// one tick, a slot of each further level covers all slots of the
+	/// level below. Scheduling and cancelling a timer take constant
+	/// time, regardless of the number of timers. Timers further in
+	/// the future than the wheel covers (SLOTS^LEVELS ticks) are
+	/// moved down the wheel as time advances.
+	///
+	/// Timer callbacks are called on the background thread, without
+	/// holding any locks, so they may schedule or cancel timers.
+	/// Callbacks must not block, as they delay all other timers.
+{
+public:
+	using TimerId = Poco::UInt64;
+	using Callback = std::function<void()>;
+
+	enum
+	{
+		SLOT_BITS = 6,
+		SLOTS = 1 << SLOT_BITS,
+		LEVELS = 4
+	};
+
+	explicit TimingWheel(Poco::Timespan tick = Poco::Timespan(0, 100000));
+		/// Creates the TimingWheel with the given resolution.
+
+	~TimingWheel();
+		/// Destroys the TimingWheel. Pending timers are discarded.
+
+	void start();
+		/// Starts running timers.
+
+	void stop();
+		/// Stops running timers. Pending timers are kept and
+		/// run when the TimingWheel is started again.
+
+	TimerId schedule(Poco::Timespan delay, Callback callback);
+		/// Schedules the callback to be called once, after the given
+		/// delay (rounded up to the next tick). Returns the ID of the
+		/// timer, which is never 0.
+
+	bool cancel(TimerId id);
+		/// Cancels the timer with the given ID. Returns false if the
+		/// timer has already expired or has been cancelled.
+
+	std::size_t size() const;
+		/// Returns the number of pending timers.
+
+	Poco::Timespan tick() const;
+		/// Returns the resolution of the TimingWheel.
+
+protected:
+	struct Node
+	{
+		Node* pPrev = this;
+		Node* pNext = this;
+		Poco::UInt64 expires = 0;
+		TimerId id = 0;
+		Callback callback;
+	};
+
+	void run();
+	void advance(std::vector<Node*>& expired);
+	void cascade(int level);
+	void insert(Node* pNode);
+	static void link(Node& list, Node* pNode);
+	static void unlink(Node* pNode);
+
+private:
+	const Poco::Timespan _tick;
+	Node _slots[LEVELS][SLOTS];
+	Poco::UInt64 _current = 0;
+	TimerId _nextId = 1;
+	std::unordered_map<TimerId, Node*> _timers;
+	Poco::Clock _epoch;
+	Poco::Thread _thread;
+	Poco::Event _stop;
+	bool _running = false;
+	mutable Poco::FastMutex _mutex;
+	Poco::Logger& _logger;
+};
+
+
+//
+// inlines
+//
+inline Poco::Timespan TimingWheel::tick() const
+{
+	return _tick;
+}
+
+
+inline void TimingWheel::link(Node& list, Node* pNode)
+{
+	pNode->pPrev = list.pPrev;
+	pNode->pNext = &list;
+	list.pPrev->pNext = pNode;
+	list.pPrev = pNode;
+}
+
+
+inline void TimingWheel::unlink(Node* pNode)
+{
+	pNode->pPrev->pNext = pNode->pNext;
+	pNode->pNext->pPrev = pNode->pPrev;
+	pNode->pPrev = pNode;
+	pNode->pNext = pNode;
+}
+
+
+#endif // TimingWheel_INCLUDED
@@ -0,0 +1,105 @@
+//
+// TrafficCapture.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "TrafficCapture.h"
+#include "Poco/BinaryWriter.h"
+#include "Poco/BinaryReader.h"
+#include "Poco/Exception.h"
+
+
+using namespace std::string_literals;
+
+
+const std::string TrafficCapture::MAGIC("AXT1");
+
+
+TrafficCapture::TrafficCapture(const std::string& path, bool captureBodies):
+	_stream(path, std::ios::out | std::ios::trunc | std::ios::binary),
+	_captureBodies(captureBodies)
+{
+	_stream.write(MAGIC.data(), MAGIC.size());
+	_stream.flush();
+}
+
+
+TrafficCapture::~TrafficCapture()
+{
+	try
+	{
+		_stream.close();
+	}
+	catch (...)
+	{
+	}
+}
+
+
+void TrafficCapture::write(const Request& request, const std::string& body)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	Poco::BinaryWriter writer(_stream, Poco::BinaryWriter::LITTLE_ENDIAN_BYTE_ORDER);
+	writer.write7BitEncoded(static_cast<Poco::UInt64>(request.offset));
+	writer << request.client << request.method << request.uri;
+	writer.write7BitEncoded(static_cast<Poco::UInt32>(request.headers.size()));
+	for (const auto& header: request.headers)
+	{
+		writer << header.first << header.second;
+	}
+	writer.write7BitEncoded(request.bodySize);
+	writer << static_cast<Poco::UInt8>(request.hasBody ? 1 : 0);
+	if (request.hasBody)
+	{
+		writer.writeRaw(body.data(), static_cast<std::streamsize>(body.size()));
+	}
+
+	// Keep the capture usable if the server is killed.
+	writer.flush();
+}
+
+
+void TrafficCapture::readHeader(std::istream& istr)
+{
+	std::string magic(MAGIC.size(), '\0');
+	istr.read(&magic[0], magic.size());
+	if (!istr || magic != MAGIC) throw Poco::DataFormatException("Not a traffic capture file"s);
+}
+
+
+bool TrafficCapture::read(std::istream& istr, Request& request)
+{
+	if (istr.peek() == std::char_traits<char>::eof()) return false;
+
+	Poco::BinaryReader reader(istr, Poco::BinaryReader::LITTLE_ENDIAN_BYTE_ORDER);
+	Poco::UInt64 offset;
+	reader.read7BitEncoded(offset);
+	request.offset = static_cast<Poco::Timestamp::TimeDiff>(offset);
+	reader >> request.client >> request.method >> request.uri;
+	Poco::UInt32 headerCount;
+	reader.read7BitEncoded(headerCount);
+	request.headers.clear();
+	for (Poco::UInt32 i = 0; i < headerCount && reader.good(); i++)
+	{
+		std::string name;
+		std::string value;
+		reader >> name >> value;
+		request.headers.emplace_back(name, value);
+	}
+	reader.read7BitEncoded(request.bodySize);
+	Poco::UInt8 hasBody = 0;
+	reader >> hasBody;
+	request.hasBody = hasBody != 0;
+	if (!reader.good()) throw Poco::DataFormatException("Truncated traffic capture record"s);
+
+	if (request.hasBody)
+	{
+		request.bodyOffset = istr.tellg();
+		istr.seekg(static_cast<std::streamoff>(request.bodySize), std::ios::cur);
+		if (!istr) throw Poco::DataFormatException("Truncated traffic capture record"s);
+	}
+	return true;
+}
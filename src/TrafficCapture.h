@@ -0,0 +1,107 @@
+//
+// TrafficCapture.h
+//
+// Definition of the TrafficCapture class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef TrafficCapture_INCLUDED
+#define TrafficCapture_INCLUDED
+
+
+#include "Poco/FileStream.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Mutex.h"
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+class TrafficCapture
+	/// TrafficCapture records the requests received by the server
+	/// to a capture file, which can be replayed with TrafficReplay.
+	///
+	/// For every request, the arrival time (relative to the start of
+	/// the capture), client address, method, URI, headers and body size
+	/// are recorded. Request bodies are only recorded if enabled.
+	///
+	/// A capture file starts with the magic "AXT1", followed by the
+	/// records. Numbers are 7-bit encoded, strings are prefixed with
+	/// their 7-bit encoded length (see Poco::BinaryWriter). Records are
+	/// written when a request has been received completely, so they
+	/// are not necessarily in the order of arrival.
+{
+public:
+	struct Request
+	{
+		Poco::Timestamp::TimeDiff offset = 0;
+			/// Arrival time in microseconds since the start of the capture.
+		std::string client;
+		std::string method;
+		std::string uri;
+		std::vector<std::pair<std::string, std::string>> headers;
+		Poco::UInt64 bodySize = 0;
+		bool hasBody = false;
+			/// True if the body has been captured.
+		std::streamoff bodyOffset = 0;
+			/// Position of the body in the capture file (set by read()).
+	};
+
+	TrafficCapture(const std::string& path, bool captureBodies);
+		/// Creates the TrafficCapture and creates (or truncates)
+		/// the capture file at the given path.
+
+	~TrafficCapture();
+		/// Destroys the TrafficCapture and closes the capture file.
+
+	bool captureBodies() const;
+		/// Returns true if request bodies are captured.
+
+	Poco::Timestamp::TimeDiff offset() const;
+		/// Returns the time in microseconds since the start of the capture.
+
+	void write(const Request& request, const std::string& body);
+		/// Appends the request to the capture file. The body is
+		/// only written if request.hasBody is true.
+
+	static void readHeader(std::istream& istr);
+		/// Reads and checks the file header of a capture file.
+		///
+		/// Throws a Poco::DataFormatException if istr does
+		/// not contain a capture file.
+
+	static bool read(std::istream& istr, Request& request);
+		/// Reads the next request from a capture file, skipping its body.
+		/// Returns false at the end of the file.
+		///
+		/// Throws a Poco::DataFormatException if the record is truncated.
+
+	static const std::string MAGIC;
+
+private:
+	Poco::FileOutputStream _stream;
+	bool _captureBodies;
+	Poco::Timestamp _start;
+	Poco::FastMutex _mutex;
+};
+
+
+//
+// inlines
+//
+inline bool TrafficCapture::captureBodies() const
+{
+	return _captureBodies;
+}
+
+
+inline Poco::Timestamp::TimeDiff TrafficCapture::offset() const
+{
+	return _start.elapsed();
+}
+
+
+#endif // TrafficCapture_INCLUDED
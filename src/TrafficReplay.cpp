@@ -0,0 +1,264 @@
+//
+// TrafficReplay.cpp
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#include "TrafficReplay.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/NullStream.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/Random.h"
+#include "Poco/String.h"
+#include "Poco/Logger.h"
+#include "Poco/Exception.h"
+#include <algorithm>
+#include <cmath>
+
+
+using namespace std::string_literals;
+
+
+namespace
+{
+	bool isReplayedHeader(const std::string& name)
+	{
+		// set by the client session, or describing the original connection
+		static const std::vector<std::string> skipped = {
+			"Host"s, "Content-Length"s, "Transfer-Encoding"s, "Connection"s, "Keep-Alive"s, "Expect"s
+		};
+		for (const auto& s: skipped)
+		{
+			if (Poco::icompare(name, s) == 0) return false;
+		}
+		return true;
+	}
+}
+
+
+TrafficReplay::TrafficReplay(const Poco::Util::AbstractConfiguration& config):
+	_path(config.getString("replay.file"s)),
+	_url(config.getString("replay.url"s, "http://localhost:"s + config.getString("http.port"s, "9980"s))),
+	_speed(config.getDouble("replay.speed"s, 1)),
+	_threadCount(config.getInt("replay.threads"s, 32))
+{
+	if (_speed < 0) throw Poco::InvalidArgumentException("replay.speed must not be negative"s);
+}
+
+
+TrafficReplay::~TrafficReplay()
+{
+}
+
+
+void TrafficReplay::run(std::ostream& ostr)
+{
+	_file.open(_path, std::ios::in | std::ios::binary);
+	TrafficCapture::readHeader(_file);
+
+	std::vector<TrafficCapture::Request> requests;
+	TrafficCapture::Request request;
+	Poco::UInt64 maxBodySize = 0;
+	while (TrafficCapture::read(_file, request))
+	{
+		if (!request.hasBody) maxBodySize = std::max(maxBodySize, request.bodySize);
+		requests.push_back(request);
+	}
+	_file.clear();
+
+	// Records are written in the order requests completed.
+	std::stable_sort(requests.begin(), requests.end(), [](const TrafficCapture::Request& a, const TrafficCapture::Request& b)
+		{
+			return a.offset < b.offset;
+		});
+
+	Poco::Random rnd;
+	rnd.seed();
+	_filler.resize(static_cast<std::size_t>(maxBodySize));
+	for (auto& c: _filler) c = rnd.nextChar();
+
+	const double captured = requests.empty() ? 0 : requests.back().offset/1000000.0;
+	ostr << "Replaying " << requests.size() << " requests (" << captured << " s) from " << _path << " to " << _url.toString();
+	if (_speed > 0) ostr << " at " << _speed << "x speed\n\n"; else ostr << " as fast as possible\n\n";
+
+	_stopped = false;
+	for (int i = 0; i < std::max(_threadCount, 1); i++)
+	{
+		_threads.push_back(std::make_unique<Poco::Thread>("TrafficReplay"s));
+		_threads.back()->start(*this);
+	}
+
+	Poco::Timestamp start;
+	Poco::Timestamp::TimeDiff maxLag = 0;
+	for (const auto& r: requests)
+	{
+		if (_speed > 0)
+		{
+			const Poco::Timestamp due = start + static_cast<Poco::Timestamp::TimeDiff>(r.offset/_speed);
+			Poco::Timestamp now;
+			if (due > now)
+				Poco::Thread::sleep(static_cast<long>((due - now)/1000));
+			else
+				maxLag = std::max(maxLag, now - due);
+		}
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_queue.push_back(&r);
+		_queueCondition.signal();
+	}
+
+	{
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		while (!_queue.empty() || _active > 0) _idleCondition.wait(_mutex);
+	}
+	const Poco::Timestamp::TimeDiff elapsed = start.elapsed();
+	_stopped = true;
+	_queueCondition.broadcast();
+	for (auto& pThread: _threads)
+	{
+		pThread->join();
+	}
+	_threads.clear();
+
+	const double seconds = elapsed/1000000.0;
+	Poco::UInt64 total = 0;
+	for (auto n: _statusClasses) total += n;
+	ostr << "Requests:  " << total << " in " << Poco::NumberFormatter::format(seconds, 1) << " s ("
+		<< Poco::NumberFormatter::format(seconds > 0 ? total/seconds : 0.0, 1) << " requests/s, "
+		<< Poco::NumberFormatter::format(seconds > 0 ? _bytes/seconds/(1024*1024) : 0.0, 1) << " MB/s sent)\n";
+	ostr << "Responses: 2xx " << _statusClasses[2] << ", 3xx " << _statusClasses[3] << ", 4xx " << _statusClasses[4]
+		<< ", 5xx " << _statusClasses[5] << ", failed " << _statusClasses[0] << "\n";
+	const Poco::Timestamp::TimeDiff max = _latencies.empty() ? 0 : *std::max_element(_latencies.begin(), _latencies.end());
+	ostr << "Latency:   p50 " << Poco::NumberFormatter::format(percentile(_latencies, 0.5)/1000.0, 1)
+		<< " ms, p99 " << Poco::NumberFormatter::format(percentile(_latencies, 0.99)/1000.0, 1)
+		<< " ms, max " << Poco::NumberFormatter::format(max/1000.0, 1) << " ms\n";
+	if (_speed > 0)
+	{
+		ostr << "Max lag behind schedule: " << Poco::NumberFormatter::format(maxLag/1000.0, 1) << " ms\n";
+	}
+	ostr << std::flush;
+}
+
+
+void TrafficReplay::run()
+{
+	while (true)
+	{
+		const TrafficCapture::Request* pRequest = nullptr;
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+
+			while (_queue.empty() && !_stopped) _queueCondition.tryWait(_mutex, 1000);
+			if (_queue.empty()) return;
+			pRequest = _queue.front();
+			_queue.pop_front();
+			_active++;
+		}
+		send(*pRequest);
+		{
+			Poco::FastMutex::ScopedLock lock(_mutex);
+			_active--;
+			_idleCondition.broadcast();
+		}
+	}
+}
+
+
+void TrafficReplay::send(const TrafficCapture::Request& request)
+{
+	Connection& conn = connection(request.client);
+	Poco::FastMutex::ScopedLock connectionLock(conn.mutex);
+
+	if (!conn.pSession)
+	{
+		conn.pSession = std::make_unique<Poco::Net::HTTPClientSession>(_url.getHost(), _url.getPort());
+		conn.pSession->setKeepAlive(true);
+		conn.pSession->setTimeout(Poco::Timespan(30, 0));
+	}
+
+	try
+	{
+		Poco::Net::HTTPRequest httpRequest(request.method, request.uri, Poco::Net::HTTPMessage::HTTP_1_1);
+		for (const auto& header: request.headers)
+		{
+			if (isReplayedHeader(header.first)) httpRequest.add(header.first, header.second);
+		}
+		const std::string data = body(request);
+		if (!data.empty() || request.method == Poco::Net::HTTPRequest::HTTP_POST)
+		{
+			httpRequest.setContentLength64(static_cast<Poco::Int64>(data.size()));
+		}
+		httpRequest.setKeepAlive(true);
+
+		Poco::Stopwatch stopwatch;
+		stopwatch.start();
+		std::ostream& ostr = conn.pSession->sendRequest(httpRequest);
+		ostr.write(data.data(), data.size());
+		Poco::Net::HTTPResponse response;
+		std::istream& istr = conn.pSession->receiveResponse(response);
+		Poco::NullOutputStream nullStream;
+		Poco::StreamCopier::copyStream(istr, nullStream);
+		stopwatch.stop();
+
+		const int statusClass = std::min(std::max(static_cast<int>(response.getStatus())/100, 1), 5);
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_statusClasses[statusClass]++;
+		_latencies.push_back(stopwatch.elapsed());
+		_bytes += data.size();
+	}
+	catch (Poco::Exception& exc)
+	{
+		Poco::Logger::get("TrafficReplay"s).debug("%s %s failed: %s"s, request.method, request.uri, exc.displayText());
+		conn.pSession.reset();
+
+		Poco::FastMutex::ScopedLock lock(_mutex);
+		_statusClasses[0]++;
+	}
+}
+
+
+std::string TrafficReplay::body(const TrafficCapture::Request& request)
+{
+	if (request.hasBody)
+	{
+		std::string data(static_cast<std::size_t>(request.bodySize), '\0');
+		Poco::FastMutex::ScopedLock lock(_fileMutex);
+		_file.seekg(request.bodyOffset);
+		_file.read(&data[0], data.size());
+		if (!_file)
+		{
+			_file.clear();
+			throw Poco::DataFormatException("Truncated request body in capture file"s);
+		}
+		return data;
+	}
+	else
+	{
+		return _filler.substr(0, static_cast<std::size_t>(request.bodySize));
+	}
+}
+
+
+TrafficReplay::Connection& TrafficReplay::connection(const std::string& client)
+{
+	Poco::FastMutex::ScopedLock lock(_mutex);
+
+	auto& pConnection = _connections[client];
+	if (!pConnection) pConnection = std::make_unique<Connection>();
+	return *pConnection;
+}
+
+
+Poco::Timestamp::TimeDiff TrafficReplay::percentile(std::vector<Poco::Timestamp::TimeDiff>& latencies, double p)
+{
+	if (latencies.empty()) return 0;
+
+	std::size_t n = static_cast<std::size_t>(std::ceil(p*latencies.size()));
+	if (n > 0) n--;
+	std::nth_element(latencies.begin(), latencies.begin() + n, latencies.end());
+	return latencies[n];
+}
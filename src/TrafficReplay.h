@@ -0,0 +1,96 @@
+//
+// TrafficReplay.h
+//
+// Definition of the TrafficReplay class.
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#ifndef TrafficReplay_INCLUDED
+#define TrafficReplay_INCLUDED
+
+
+#include "TrafficCapture.h"
+#include "Poco/Util/AbstractConfiguration.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/Mutex.h"
+#include "Poco/Condition.h"
+#include "Poco/FileStream.h"
+#include "Poco/URI.h"
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+class TrafficReplay: public Poco::Runnable
+	/// TrafficReplay sends the requests recorded in a capture
+	/// file (see TrafficCapture) to a server, with the recorded
+	/// timing or faster, and reports latency and throughput.
+	///
+	/// Requests recorded from the same client connection are sent
+	/// over the same connection, one after the other. Request bodies
+	/// not contained in the capture file are replaced with random
+	/// data of the recorded size.
+	///
+	/// The replay is configured with the following properties:
+	///   - replay.file: capture file to replay
+	///   - replay.url: server URL (default: http://localhost:<http.port>)
+	///   - replay.speed: speed-up factor, 0 to send requests as fast as possible (default: 1)
+	///   - replay.threads: number of sending threads (default: 32)
+{
+public:
+	explicit TrafficReplay(const Poco::Util::AbstractConfiguration& config);
+		/// Creates the TrafficReplay.
+
+	~TrafficReplay();
+		/// Destroys the TrafficReplay.
+
+	void run(std::ostream& ostr);
+		/// Replays the capture file and writes the results to ostr.
+
+protected:
+	struct Connection
+	{
+		std::unique_ptr<Poco::Net::HTTPClientSession> pSession;
+		Poco::FastMutex mutex;
+	};
+
+	void run();
+	void send(const TrafficCapture::Request& request);
+	std::string body(const TrafficCapture::Request& request);
+	Connection& connection(const std::string& client);
+	static Poco::Timestamp::TimeDiff percentile(std::vector<Poco::Timestamp::TimeDiff>& latencies, double p);
+
+private:
+	std::string _path;
+	Poco::URI _url;
+	double _speed;
+	int _threadCount;
+
+	Poco::FileInputStream _file;
+	Poco::FastMutex _fileMutex;
+	std::string _filler;
+
+	std::map<std::string, std::unique_ptr<Connection>> _connections;
+	std::deque<const TrafficCapture::Request*> _queue;
+	std::vector<std::unique_ptr<Poco::Thread>> _threads;
+	std::atomic<bool> _stopped{true};
+	std::vector<Poco::Timestamp::TimeDiff> _latencies;
+	Poco::UInt64 _statusClasses[6] = {0, 0, 0, 0, 0, 0};
+		/// Responses by status class; index 0 counts failed requests.
+	Poco::UInt64 _bytes = 0;
+	Poco::FastMutex _mutex;
+	Poco::Condition _queueCondition;
+	Poco::Condition _idleCondition;
+	std::size_t _active = 0;
+};
+
+
+#endif // TrafficReplay_INCLUDED